@@ -0,0 +1,289 @@
+#include "alloc_tracker.h"
+#include <system/debug_log.h>
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace
+{
+	// in front of every block, padded so the block is aligned as malloc aligned the header
+	struct BlockHeader
+	{
+		size_t size;
+		uint16_t magic;
+		uint8_t tag;
+		uint8_t phase;
+	};
+	const size_t kHeaderBytes = 16;
+	static_assert(sizeof(BlockHeader) <= kHeaderBytes, "BlockHeader must fit its padding");
+
+	// marks a block the tracker allocated, so a stray pointer is not taken off the counters
+	const uint16_t kBlockMagic = 0xa10c;
+
+	const char* kTagNames[ALLOC_TAG_COUNT] = { "general", "table", "game", "resources", "audio", "scores" };
+
+	// everything here is zeroed before any constructor runs, so allocations made during
+	// static initialisation are counted like the rest
+	struct Counters
+	{
+		std::atomic<size_t> allocations;
+		std::atomic<size_t> allocated_bytes;
+		std::atomic<size_t> frees;
+		std::atomic<size_t> live_count;
+		std::atomic<size_t> live_bytes;
+		std::atomic<size_t> peak_bytes;
+	};
+	Counters tag_counters[ALLOC_TAG_COUNT];
+
+	struct LiveCounters
+	{
+		std::atomic<size_t> count;
+		std::atomic<size_t> bytes;
+	};
+	LiveCounters phase_counters[AllocTracker::kMaxPhases][ALLOC_TAG_COUNT];
+
+	struct FrameCounters
+	{
+		std::atomic<size_t> allocations;
+		std::atomic<size_t> bytes;
+	};
+	FrameCounters frame_counters[ALLOC_TAG_COUNT];
+
+	std::atomic<int> current_phase;
+	std::atomic<size_t> bad_frees;
+
+	thread_local AllocTag thread_tag = ALLOC_GENERAL;
+	thread_local bool frame_thread = false;
+}
+
+//
+// SetPhase
+//
+void AllocTracker::SetPhase(int phase)
+{
+	if (phase >= 0 && phase < kMaxPhases)
+		current_phase.store(phase, std::memory_order_relaxed);
+}
+
+//
+// SetFrameThread
+//
+void AllocTracker::SetFrameThread()
+{
+	frame_thread = true;
+}
+
+//
+// BeginFrame
+//
+void AllocTracker::BeginFrame()
+{
+	for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++)
+	{
+		frame_counters[tag].allocations.store(0, std::memory_order_relaxed);
+		frame_counters[tag].bytes.store(0, std::memory_order_relaxed);
+	}
+}
+
+//
+// Tag
+//
+AllocStats AllocTracker::Tag(AllocTag tag)
+{
+	const Counters& counters = tag_counters[tag];
+	AllocStats stats;
+	stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+	stats.allocated_bytes = counters.allocated_bytes.load(std::memory_order_relaxed);
+	stats.frees = counters.frees.load(std::memory_order_relaxed);
+	stats.live_count = counters.live_count.load(std::memory_order_relaxed);
+	stats.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+	stats.peak_bytes = counters.peak_bytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+//
+// Phase
+//
+AllocStats AllocTracker::Phase(int phase, AllocTag tag)
+{
+	AllocStats stats = {};
+	if (phase >= 0 && phase < kMaxPhases)
+	{
+		stats.live_count = phase_counters[phase][tag].count.load(std::memory_order_relaxed);
+		stats.live_bytes = phase_counters[phase][tag].bytes.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+//
+// Frame
+//
+AllocStats AllocTracker::Frame(AllocTag tag)
+{
+	AllocStats stats = {};
+	stats.allocations = frame_counters[tag].allocations.load(std::memory_order_relaxed);
+	stats.allocated_bytes = frame_counters[tag].bytes.load(std::memory_order_relaxed);
+	return stats;
+}
+
+//
+// BadFrees
+//
+size_t AllocTracker::BadFrees()
+{
+	return bad_frees.load(std::memory_order_relaxed);
+}
+
+//
+// TagName
+//
+const char* AllocTracker::TagName(AllocTag tag)
+{
+	return kTagNames[tag];
+}
+
+//
+// Allocate
+//
+void* AllocTracker::Allocate(size_t size)
+{
+	BlockHeader* header = (BlockHeader*)malloc(kHeaderBytes + size);
+	if (!header)
+		return NULL;
+
+	AllocTag tag = thread_tag;
+	int phase = current_phase.load(std::memory_order_relaxed);
+	header->size = size;
+	header->magic = kBlockMagic;
+	header->tag = (uint8_t)tag;
+	header->phase = (uint8_t)phase;
+
+	// the counters are only ever read for reports, so they need no ordering with each other
+	Counters& counters = tag_counters[tag];
+	counters.allocations.fetch_add(1, std::memory_order_relaxed);
+	counters.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	counters.live_count.fetch_add(1, std::memory_order_relaxed);
+	size_t live = counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	size_t peak = counters.peak_bytes.load(std::memory_order_relaxed);
+	while (live > peak && !counters.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		;
+
+	phase_counters[phase][tag].count.fetch_add(1, std::memory_order_relaxed);
+	phase_counters[phase][tag].bytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (frame_thread)
+	{
+		frame_counters[tag].allocations.fetch_add(1, std::memory_order_relaxed);
+		frame_counters[tag].bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	return (char*)header + kHeaderBytes;
+}
+
+//
+// Free
+//
+void AllocTracker::Free(void* memory)
+{
+	if (!memory)
+		return;
+
+	// a double free, or a block that never came from Allocate, is reported and left alone
+	// rather than handed to free, which would take the heap down with it
+	BlockHeader* header = (BlockHeader*)((char*)memory - kHeaderBytes);
+	if (header->magic != kBlockMagic)
+	{
+		bad_frees.fetch_add(1, std::memory_order_relaxed);
+		gef::DebugOut("AllocTracker: bad free of %p, freed twice or not allocated here\n", memory);
+		return;
+	}
+	header->magic = 0;
+
+	Counters& counters = tag_counters[header->tag];
+	counters.frees.fetch_add(1, std::memory_order_relaxed);
+	counters.live_count.fetch_sub(1, std::memory_order_relaxed);
+	counters.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+	phase_counters[header->phase][header->tag].count.fetch_sub(1, std::memory_order_relaxed);
+	phase_counters[header->phase][header->tag].bytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+	free(header);
+}
+
+//
+// AllocTagScope
+//
+AllocTagScope::AllocTagScope(AllocTag tag) :
+	previous_(thread_tag)
+{
+	thread_tag = tag;
+}
+
+//
+// ~AllocTagScope
+//
+AllocTagScope::~AllocTagScope()
+{
+	thread_tag = previous_;
+}
+
+#if !defined(ALLOC_TRACKER_DISABLED)
+
+void* operator new(size_t size)
+{
+	void* memory = AllocTracker::Allocate(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = AllocTracker::Allocate(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return AllocTracker::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return AllocTracker::Allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	AllocTracker::Free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	AllocTracker::Free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	AllocTracker::Free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	AllocTracker::Free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	AllocTracker::Free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	AllocTracker::Free(memory);
+}
+
+#endif
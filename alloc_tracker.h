@@ -0,0 +1,79 @@
+#ifndef _ALLOC_TRACKER_H
+#define _ALLOC_TRACKER_H
+
+#include <stddef.h>
+
+// What an allocation was made for. A thread's allocations take the tag of the innermost
+// AllocTagScope open on it, or ALLOC_GENERAL outside any.
+enum AllocTag
+{
+	ALLOC_GENERAL,
+	ALLOC_TABLE,		// the table, built once and kept for every game
+	ALLOC_GAME,			// one game, its balls, replay and ghosts
+	ALLOC_RESOURCES,	// scenes, textures and samples the resource manager loads
+	ALLOC_AUDIO,
+	ALLOC_SCORES,
+	ALLOC_TAG_COUNT
+};
+
+struct AllocStats
+{
+	size_t allocations;
+	size_t allocated_bytes;
+	size_t frees;
+	size_t live_count;
+	size_t live_bytes;
+	size_t peak_bytes;
+};
+
+// Counts everything that goes through operator new and delete, by tag, by the phase that was
+// current when it was allocated, and over the frame so far. Every block carries a small header
+// with its size, tag and phase, so a free is taken off the counters it was added to whichever
+// thread makes it. Box2D goes to the physics pool rather than operator new, see PhysicsPool.
+// Define ALLOC_TRACKER_DISABLED to leave operator new and delete alone.
+class AllocTracker
+{
+public:
+	/// @brief Counts allocations from now on against a phase, on every thread.
+	/// @param[in] phase	Less than kMaxPhases.
+	static void SetPhase(int phase);
+
+	/// @brief Counts the calling thread's allocations in the frame counters.
+	static void SetFrameThread();
+
+	/// @brief Zeroes the frame counters.
+	static void BeginFrame();
+
+	/// @return Everything allocated with a tag
+	static AllocStats Tag(AllocTag tag);
+
+	/// @return The live_count and live_bytes of allocations made with a tag while a phase was current
+	static AllocStats Phase(int phase, AllocTag tag);
+
+	/// @return The allocations and allocated_bytes of a tag on frame threads since BeginFrame
+	static AllocStats Frame(AllocTag tag);
+
+	/// @return How many frees were of blocks not allocated here, or already freed
+	static size_t BadFrees();
+
+	static const char* TagName(AllocTag tag);
+
+	static const int kMaxPhases = 16;
+
+	/// @brief What operator new and delete call.
+	static void* Allocate(size_t size);
+	static void Free(void* memory);
+};
+
+// Tags the calling thread's allocations until it goes out of scope.
+class AllocTagScope
+{
+public:
+	AllocTagScope(AllocTag tag);
+	~AllocTagScope();
+
+private:
+	AllocTag previous_;
+};
+
+#endif // _ALLOC_TRACKER_H
@@ -0,0 +1,114 @@
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace
+{
+	// block headers are padded so the first allocation in a block is aligned to at least this
+	const size_t kHeaderAlignment = 16;
+}
+
+//
+// Arena
+//
+Arena::Arena(size_t block_size) :
+	block_size_(block_size),
+	first_(NULL),
+	current_(NULL),
+	used_(0),
+	peak_(0),
+	reserved_(0)
+{
+}
+
+//
+// ~Arena
+//
+Arena::~Arena()
+{
+	while (first_)
+	{
+		Block* next = first_->next;
+		free(first_);
+		first_ = next;
+	}
+}
+
+//
+// Allocate
+//
+void* Arena::Allocate(size_t size, size_t alignment)
+{
+	const size_t header = (sizeof(Block) + kHeaderAlignment - 1) & ~(kHeaderAlignment - 1);
+
+	for (;;)
+	{
+		// the rest of a block too small for this is left unused
+		if (current_)
+		{
+			uintptr_t base = (uintptr_t)current_ + header;
+			uintptr_t start = (base + current_->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			size_t end = (size_t)(start - base) + size;
+			if (end <= current_->size)
+			{
+				used_ += end - current_->used;
+				current_->used = end;
+				if (used_ > peak_)
+					peak_ = used_;
+				return (void*)start;
+			}
+		}
+
+		size_t blockSize = size + alignment > block_size_ ? size + alignment : block_size_;
+		Block* block = NewBlock(blockSize);
+		if (!block)
+			return NULL;
+
+		if (current_)
+			current_->next = block;
+		else
+			first_ = block;
+		current_ = block;
+	}
+}
+
+//
+// Reset
+//
+void Arena::Reset()
+{
+	if (!first_)
+		return;
+
+	// the first block covers a normal game, anything past it was a one off
+	Block* block = first_->next;
+	while (block)
+	{
+		Block* next = block->next;
+		reserved_ -= block->size;
+		free(block);
+		block = next;
+	}
+
+	first_->next = NULL;
+	first_->used = 0;
+	current_ = first_;
+	used_ = 0;
+}
+
+//
+// NewBlock
+//
+Arena::Block* Arena::NewBlock(size_t size)
+{
+	const size_t header = (sizeof(Block) + kHeaderAlignment - 1) & ~(kHeaderAlignment - 1);
+	Block* block = (Block*)malloc(header + size);
+	if (!block)
+		return NULL;
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	reserved_ += size;
+	return block;
+}
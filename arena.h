@@ -0,0 +1,60 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+// A monotonic allocator for memory that lives exactly as long as one game. Allocating bumps a
+// pointer through large blocks and nothing is ever freed on its own; Reset hands everything
+// back at once and keeps the first block for the next game. Objects placed in an arena must
+// not need their destructors run.
+class Arena
+{
+public:
+	/// @param[in] block_size	Bytes in each block, requests larger than this get a block of their own.
+	explicit Arena(size_t block_size);
+
+	/// @brief Default destructor. Frees every block.
+	~Arena();
+
+	/// @brief Allocates memory that stays valid until the next Reset.
+	/// @return NULL if the system is out of memory
+	/// @param[in] alignment	Must be a power of two.
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	template <typename T>
+	inline T* AllocateArray(size_t count) { return (T*)Allocate(count * sizeof(T), alignof(T)); }
+
+	/// @brief Releases every allocation, keeping the first block.
+	void Reset();
+
+	/// @brief Get the bytes allocated since the last Reset.
+	inline size_t used_bytes() const { return used_; }
+
+	/// @brief Get the most bytes ever allocated between two resets.
+	inline size_t peak_bytes() const { return peak_; }
+
+	/// @brief Get the bytes currently held in blocks, used or not.
+	inline size_t reserved_bytes() const { return reserved_; }
+
+private:
+	struct Block
+	{
+		Block* next;
+		size_t size;
+		size_t used;
+	};
+
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+
+	Block* NewBlock(size_t size);
+
+	size_t block_size_;
+	Block* first_;
+	Block* current_;
+	size_t used_;
+	size_t peak_;
+	size_t reserved_;
+};
+
+#endif // _ARENA_H
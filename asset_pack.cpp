@@ -0,0 +1,188 @@
+#include "asset_pack.h"
+#include <cstring>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define ASSET_PACK_MMAP
+#endif
+
+//
+// AssetPack
+//
+AssetPack::AssetPack() :
+	data_(NULL),
+	size_(0),
+	entries_(NULL),
+	entry_count_(0),
+	mapping_(NULL),
+	file_(NULL)
+{
+}
+
+//
+// ~AssetPack
+//
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+//
+// Open
+//
+bool AssetPack::Open(const char* filename)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	file_ = file;
+	mapping_ = mapping;
+	size_ = (size_t)fileSize.QuadPart;
+	data_ = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#elif defined(ASSET_PACK_MMAP)
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	mapping_ = mapped;
+	size_ = (size_t)fileStat.st_size;
+	data_ = (const unsigned char*)mapped;
+#else
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (fileSize > 0)
+	{
+		buffer_.resize((size_t)fileSize);
+		if (fread(&buffer_[0], 1, buffer_.size(), file) == buffer_.size())
+		{
+			size_ = buffer_.size();
+			data_ = &buffer_[0];
+		}
+	}
+	fclose(file);
+#endif
+
+	if (!data_)
+	{
+		Close();
+		return false;
+	}
+
+	// validate the header and index before handing out any pointers
+	const AssetPackHeader* header = (const AssetPackHeader*)data_;
+	if (size_ < sizeof(AssetPackHeader) || header->magic != kAssetPackMagic || header->version != kAssetPackVersion ||
+		sizeof(AssetPackHeader) + (size_t)header->entry_count * sizeof(AssetPackEntry) > size_)
+	{
+		Close();
+		return false;
+	}
+
+	entries_ = (const AssetPackEntry*)(data_ + sizeof(AssetPackHeader));
+	entry_count_ = header->entry_count;
+
+	for (unsigned int i = 0; i < entry_count_; i++)
+	{
+		if ((size_t)entries_[i].offset + entries_[i].size > size_)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//
+// Close
+//
+void AssetPack::Close()
+{
+#if defined(_WIN32)
+	if (data_)
+		UnmapViewOfFile(data_);
+	if (mapping_)
+		CloseHandle((HANDLE)mapping_);
+	if (file_)
+		CloseHandle((HANDLE)file_);
+#elif defined(ASSET_PACK_MMAP)
+	if (mapping_)
+		munmap(mapping_, size_);
+#endif
+	std::vector<unsigned char>().swap(buffer_);
+
+	data_ = NULL;
+	size_ = 0;
+	entries_ = NULL;
+	entry_count_ = 0;
+	mapping_ = NULL;
+	file_ = NULL;
+}
+
+//
+// Find
+//
+const void* AssetPack::Find(const char* name, size_t* size) const
+{
+	if (!entries_ || !name)
+		return NULL;
+
+	// the packer sorts the index by name
+	int low = 0, high = (int)entry_count_ - 1;
+	while (low <= high)
+	{
+		int mid = (low + high) / 2;
+		int compare = strncmp(name, entries_[mid].name, kAssetPackMaxName);
+		if (compare == 0)
+		{
+			if (size)
+				*size = entries_[mid].size;
+			return data_ + entries_[mid].offset;
+		}
+
+		if (compare < 0)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,49 @@
+#ifndef _ASSET_PACK_H
+#define _ASSET_PACK_H
+
+#include "asset_pack_format.h"
+#include <cstddef>
+#include <vector>
+
+// Media files baked into one archive by tools/asset_packer. The font descriptor, baked .tex
+// textures and sample WAVs are read from it. Scenes, PNGs and Ogg samples go through gef
+// loaders that only take a filename, and music is streamed from its file, so those stay loose.
+class AssetPack
+{
+public:
+	/// @brief Constructor.
+	AssetPack();
+
+	/// @brief Default destructor. Unmaps the pack.
+	~AssetPack();
+
+	/// @brief Maps a pack built by tools/asset_packer.
+	/// @return true if the pack was mapped and its header is valid
+	/// @param[in] filename		The pack file.
+	bool Open(const char* filename);
+
+	/// @brief Unmaps the pack. Pointers returned by Find are invalid afterwards.
+	void Close();
+
+	/// @brief Finds an entry by the filename it was packed from.
+	/// @return A pointer to the entry data inside the mapping, or NULL if it is not packed
+	/// @param[in] name			The asset filename.
+	/// @param[out] size		The size of the entry data in bytes. May be NULL.
+	const void* Find(const char* name, size_t* size) const;
+
+	/// @brief Is a pack mapped.
+	inline bool is_open() const { return data_ != NULL; }
+
+private:
+	const unsigned char* data_;
+	size_t size_;
+	const AssetPackEntry* entries_;
+	unsigned int entry_count_;
+
+	// platforms without file mapping read the pack once into this buffer
+	std::vector<unsigned char> buffer_;
+	void* mapping_;
+	void* file_;
+};
+
+#endif // _ASSET_PACK_H
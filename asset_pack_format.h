@@ -0,0 +1,33 @@
+#ifndef _ASSET_PACK_FORMAT_H
+#define _ASSET_PACK_FORMAT_H
+
+// Layout of the baked asset pack, shared by the runtime reader and tools/asset_packer.
+//
+// [AssetPackHeader][AssetPackEntry x entry_count][entry data ...]
+//
+// Entries are sorted by name so the reader can binary search the index, and every entry's
+// data starts on a kAssetPackAlignment boundary so it can be used in place from a mapping.
+
+#include <stdint.h>
+
+static const uint32_t kAssetPackMagic = 0x314b5041;	// "APK1"
+static const uint32_t kAssetPackVersion = 1;
+static const uint32_t kAssetPackAlignment = 16;
+static const int kAssetPackMaxName = 56;
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t data_offset;
+};
+
+struct AssetPackEntry
+{
+	char name[kAssetPackMaxName];
+	uint32_t offset;
+	uint32_t size;
+};
+
+#endif // _ASSET_PACK_FORMAT_H
@@ -0,0 +1,219 @@
+#include "async_texture_loader.h"
+#include "load_texture.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
+#include <graphics/image_data.h>
+#include <graphics/texture.h>
+#include <system/debug_log.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+//
+// TextureHandle
+//
+TextureHandle::TextureHandle(const char* filename, const gef::Texture* placeholder) :
+	filename_(filename),
+	placeholder_(placeholder),
+	texture_(NULL),
+	image_data_(NULL),
+	size_bytes_(0),
+	failed_(false),
+	pending_(true),
+	released_(false)
+{
+}
+
+//
+// ~TextureHandle
+//
+TextureHandle::~TextureHandle()
+{
+	delete image_data_;
+	image_data_ = NULL;
+	delete texture_;
+	texture_ = NULL;
+}
+
+//
+// AsyncTextureLoader
+//
+AsyncTextureLoader::AsyncTextureLoader(gef::Platform& platform, int thread_count) :
+	platform_(platform),
+	placeholder_(NULL),
+	quit_(false),
+	pending_count_(0)
+{
+	// 1x1 transparent texture drawn until the real one is uploaded
+	UInt8* pixel = new UInt8[4];
+	memset(pixel, 0, 4);
+	gef::ImageData placeholder_data;
+	placeholder_data.set_width(1);
+	placeholder_data.set_height(1);
+	placeholder_data.set_image(pixel);
+	placeholder_ = gef::Texture::Create(platform_, placeholder_data);
+
+	for (int i = 0; i < thread_count; i++)
+	{
+		workers_.push_back(std::thread(&AsyncTextureLoader::WorkerThread, this));
+	}
+}
+
+//
+// ~AsyncTextureLoader
+//
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	condition_.notify_all();
+
+	for (size_t i = 0; i < workers_.size(); i++)
+	{
+		workers_[i].join();
+	}
+	workers_.clear();
+
+	for (size_t i = 0; i < handles_.size(); i++)
+	{
+		delete handles_[i];
+	}
+	handles_.clear();
+
+	delete placeholder_;
+	placeholder_ = NULL;
+}
+
+//
+// Load
+//
+TextureHandle* AsyncTextureLoader::Load(const char* png_filename)
+{
+	TextureHandle* handle = new TextureHandle(png_filename, placeholder_);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		handles_.push_back(handle);
+		decode_queue_.push_back(handle);
+		pending_count_++;
+	}
+	condition_.notify_one();
+
+	return handle;
+}
+
+//
+// Release
+//
+void AsyncTextureLoader::Release(TextureHandle* handle)
+{
+	if (!handle)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (handle->pending_)
+	{
+		// still owned by a worker or the upload queue, Update frees it
+		handle->released_ = true;
+		return;
+	}
+
+	handles_.erase(std::remove(handles_.begin(), handles_.end(), handle), handles_.end());
+	delete handle;
+}
+
+//
+// Update
+//
+void AsyncTextureLoader::Update(float budget_ms)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (;;)
+	{
+		TextureHandle* handle = NULL;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (upload_queue_.empty())
+				break;
+			handle = upload_queue_.front();
+			upload_queue_.pop_front();
+		}
+
+		if (!handle->released_ && handle->image_data_ && handle->image_data_->image() != NULL)
+		{
+			PROFILE_SCOPE("gef::Texture::Create");
+			handle->texture_ = gef::Texture::Create(platform_, *handle->image_data_);
+			handle->size_bytes_ = handle->image_data_->width() * handle->image_data_->height() * 4;
+		}
+		handle->failed_ = handle->texture_ == NULL;
+		delete handle->image_data_;
+		handle->image_data_ = NULL;
+
+		if (handle->failed_ && !handle->released_)
+		{
+			gef::DebugOut("Texture %s failed to load\n", handle->filename().c_str());
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			handle->pending_ = false;
+			pending_count_--;
+			if (handle->released_)
+			{
+				handles_.erase(std::remove(handles_.begin(), handles_.end(), handle), handles_.end());
+				delete handle;
+			}
+		}
+
+		float elapsed_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (elapsed_ms >= budget_ms)
+			break;
+	}
+}
+
+//
+// WorkerThread
+//
+// Decode queued PNGs off the main thread
+//
+void AsyncTextureLoader::WorkerThread()
+{
+	Profiler::SetThreadName("texture decode");
+	AllocTagScope alloc_scope(ALLOC_RESOURCES);
+
+	for (;;)
+	{
+		TextureHandle* handle = NULL;
+		bool released = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (!quit_ && decode_queue_.empty())
+			{
+				condition_.wait(lock);
+			}
+			if (quit_)
+				return;
+
+			handle = decode_queue_.front();
+			decode_queue_.pop_front();
+			released = handle->released_;
+		}
+
+		// skip the decode if the texture was released while queued
+		gef::ImageData* image_data = new gef::ImageData();
+		if (!released)
+		{
+			PROFILE_SCOPE("LoadImageData");
+			LoadImageData(handle->filename().c_str(), platform_, *image_data);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			handle->image_data_ = image_data;
+			upload_queue_.push_back(handle);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef _ASYNC_TEXTURE_LOADER_H
+#define _ASYNC_TEXTURE_LOADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// FRAMEWORK FORWARD DECLARATIONS
+namespace gef
+{
+	class Platform;
+	class Texture;
+	class ImageData;
+}
+
+class TextureHandle
+{
+public:
+	/// @brief Get the texture to draw with.
+	/// @return The loaded texture, or the loader's placeholder until it is ready
+	inline const gef::Texture* texture() const { return texture_ ? texture_ : placeholder_; }
+
+	/// @brief Has the texture been uploaded.
+	/// @return true once the texture is ready
+	inline bool ready() const { return texture_ != NULL; }
+
+	/// @brief Did the PNG fail to decode.
+	/// @return true if the handle will never become ready
+	inline bool failed() const { return failed_; }
+
+	/// @brief Get the filename the texture was requested with.
+	inline const std::string& filename() const { return filename_; }
+
+	/// @brief Get the size of the uploaded texture data.
+	/// @return The size in bytes, 0 until the texture is ready
+	inline size_t size_bytes() const { return size_bytes_; }
+
+private:
+	friend class AsyncTextureLoader;
+
+	TextureHandle(const char* filename, const gef::Texture* placeholder);
+	~TextureHandle();
+
+	std::string filename_;
+	const gef::Texture* placeholder_;
+	gef::Texture* texture_;
+	gef::ImageData* image_data_;
+	size_t size_bytes_;
+	bool failed_;
+	bool pending_;
+	bool released_;
+};
+
+class AsyncTextureLoader
+{
+public:
+	/// @brief Constructor.
+	/// @param[in] platform		The platform textures are created on.
+	/// @param[in] thread_count	The number of background decode threads.
+	AsyncTextureLoader(gef::Platform& platform, int thread_count = 2);
+
+	/// @brief Default destructor. Waits for outstanding decodes and frees every handle.
+	~AsyncTextureLoader();
+
+	/// @brief Queues a PNG for decoding on a background thread.
+	/// @return A handle that resolves to a placeholder until the texture is ready
+	/// @param[in] png_filename	The PNG file to load.
+	TextureHandle* Load(const char* png_filename);
+
+	/// @brief Frees a handle and its texture.
+	/// @param[in] handle		The handle returned by Load.
+	void Release(TextureHandle* handle);
+
+	/// @brief Uploads decoded images to the GPU. Call once per frame on the main thread.
+	/// @param[in] budget_ms	Upload time allowed this frame. At least one texture is uploaded if any are waiting.
+	void Update(float budget_ms);
+
+	/// @brief Get the number of textures decoded or uploading.
+	inline int pending_count() const { return pending_count_; }
+
+private:
+	void WorkerThread();
+
+	gef::Platform& platform_;
+	gef::Texture* placeholder_;
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::deque<TextureHandle*> decode_queue_;
+	std::deque<TextureHandle*> upload_queue_;
+	std::vector<TextureHandle*> handles_;
+	bool quit_;
+
+	std::atomic<int> pending_count_;
+};
+
+#endif // _ASYNC_TEXTURE_LOADER_H
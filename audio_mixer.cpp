@@ -0,0 +1,454 @@
+#include "audio_mixer.h"
+#include "asset_pack.h"
+#include "wav_file.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define AUDIO_MIXER_SSE
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_MIXER_NEON
+#endif
+
+namespace
+{
+	// target += source * gain, four samples at a time
+	void MixScaled(float* target, const float* source, int count, float gain)
+	{
+		int i = 0;
+#if defined(AUDIO_MIXER_SSE)
+		const __m128 scale = _mm_set1_ps(gain);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 mixed = _mm_add_ps(_mm_loadu_ps(target + i), _mm_mul_ps(_mm_loadu_ps(source + i), scale));
+			_mm_storeu_ps(target + i, mixed);
+		}
+#elif defined(AUDIO_MIXER_NEON)
+		for (; i + 4 <= count; i += 4)
+		{
+			vst1q_f32(target + i, vmlaq_n_f32(vld1q_f32(target + i), vld1q_f32(source + i), gain));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			target[i] += source[i] * gain;
+		}
+	}
+
+	std::string WavFilename(const char* filename)
+	{
+		std::string wav = filename;
+		size_t dot = wav.find_last_of('.');
+		if (dot != std::string::npos)
+			wav.erase(dot);
+		return wav + ".wav";
+	}
+}
+
+//
+// AudioMixer
+//
+AudioMixer::AudioMixer(int voice_count, NativeVoiceBackend* native, int sample_rate) :
+	native_(native),
+	sample_rate_(sample_rate),
+	pack_(NULL),
+	start_counter_(0),
+	music_(NULL),
+	triggers_coalesced_(0),
+	voices_stolen_(0),
+	triggers_dropped_(0)
+{
+	Voice idle;
+	memset(&idle, 0, sizeof(idle));
+	idle.native_voice = -1;
+	voices_.resize(voice_count, idle);
+
+	for (int i = 0; i < BUS_COUNT; i++)
+	{
+		bus_gain_[i] = 1.f;
+	}
+}
+
+//
+// ~AudioMixer
+//
+AudioMixer::~AudioMixer()
+{
+	StopAll();
+
+	for (size_t i = 0; i < samples_.size(); i++)
+	{
+		delete samples_[i];
+	}
+	samples_.clear();
+}
+
+//
+// SetSamplePack
+//
+void AudioMixer::SetSamplePack(const AssetPack* pack)
+{
+	pack_ = pack;
+}
+
+//
+// LoadSample
+//
+int AudioMixer::LoadSample(const char* filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (size_t i = 0; i < samples_.size(); i++)
+		{
+			if (samples_[i]->filename == filename)
+				return (int)i;
+		}
+	}
+
+	Sample* sample = new Sample();
+	sample->filename = filename;
+	sample->frame_count = 0;
+	sample->native_sample = -1;
+	sample->duration = 0.f;
+
+	if (!LoadWav(WavFilename(filename).c_str(), *sample) && native_)
+	{
+		sample->native_sample = native_->LoadSample(filename, sample->duration);
+	}
+
+	if (sample->frame_count == 0 && sample->native_sample == -1)
+	{
+		delete sample;
+		return -1;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	samples_.push_back(sample);
+	return (int)samples_.size() - 1;
+}
+
+//
+// LoadWav
+//
+// Convert to stereo float at the output rate once, so mixing is a plain scaled add
+//
+bool AudioMixer::LoadWav(const char* filename, Sample& sample)
+{
+	WavFormat format;
+	std::vector<short> source;
+	bool loaded = false;
+
+	// from the asset pack, straight out of the mapping
+	size_t size = 0;
+	const unsigned char* data = pack_ ? (const unsigned char*)pack_->Find(filename, &size) : NULL;
+	if (data)
+	{
+		loaded = ParseWavHeader(data, size, format);
+		if (loaded)
+		{
+			source.resize(format.data_size / sizeof(short));
+			loaded = !source.empty();
+			if (loaded)
+				memcpy(&source[0], data + format.data_offset, source.size() * sizeof(short));
+		}
+	}
+	else
+	{
+		// or from the loose file
+		FILE* file = fopen(filename, "rb");
+		if (!file)
+			return false;
+
+		loaded = ReadWavHeader(file, format);
+		if (loaded)
+		{
+			source.resize(format.data_size / sizeof(short));
+			loaded = !source.empty() && fread(&source[0], sizeof(short), source.size(), file) == source.size();
+		}
+		fclose(file);
+	}
+
+	if (!loaded)
+		return false;
+
+	const unsigned int sourceFrames = (unsigned int)source.size() / format.channels;
+	const double step = (double)format.sample_rate / sample_rate_;
+	unsigned int frames = (unsigned int)(sourceFrames / step);
+	frames += frames & 1;
+
+	sample.pcm.assign(frames * 2, 0.f);
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		double position = i * step;
+		unsigned int index = (unsigned int)position;
+		if (index >= sourceFrames)
+			break;
+
+		unsigned int next = std::min(index + 1, sourceFrames - 1);
+		float blend = (float)(position - index);
+		for (int c = 0; c < 2; c++)
+		{
+			int channel = std::min(c, format.channels - 1);
+			float s0 = source[index * format.channels + channel];
+			float s1 = source[next * format.channels + channel];
+			sample.pcm[i * 2 + c] = (s0 + (s1 - s0) * blend) / 32768.f;
+		}
+	}
+
+	sample.frame_count = frames;
+	sample.duration = (float)frames / sample_rate_;
+	return true;
+}
+
+//
+// PlaySample
+//
+void AudioMixer::PlaySample(int sample, int priority, unsigned int handle)
+{
+	if (sample < 0)
+		return;
+
+	for (size_t i = 0; i < triggers_.size(); i++)
+	{
+		if (triggers_[i].sample == sample)
+		{
+			triggers_[i].priority = std::max(triggers_[i].priority, priority);
+			triggers_coalesced_++;
+			return;
+		}
+	}
+
+	Trigger trigger;
+	trigger.sample = sample;
+	trigger.priority = priority;
+	trigger.handle = handle;
+	triggers_.push_back(trigger);
+}
+
+//
+// StopHandle
+//
+void AudioMixer::StopHandle(unsigned int handle)
+{
+	if (handle == 0)
+		return;
+
+	// not started yet
+	for (size_t i = 0; i < triggers_.size(); i++)
+	{
+		if (triggers_[i].handle == handle)
+		{
+			triggers_.erase(triggers_.begin() + i);
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		if (voices_[i].active && voices_[i].handle == handle)
+			StopVoice(voices_[i]);
+	}
+}
+
+//
+// StopAll
+//
+void AudioMixer::StopAll()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		StopVoice(voices_[i]);
+	}
+	triggers_.clear();
+}
+
+//
+// SetBusGain
+//
+void AudioMixer::SetBusGain(AUDIO_BUS bus, float gain)
+{
+	if (bus_gain_[bus] == gain)
+		return;
+	bus_gain_[bus] = gain;
+
+	// software voices pick the gain up in the mix, native ones have to be told
+	if (bus == BUS_SFX && native_)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (size_t i = 0; i < voices_.size(); i++)
+		{
+			if (voices_[i].active && voices_[i].native_voice != -1)
+				native_->SetVoiceGain(voices_[i].native_voice, gain);
+		}
+	}
+}
+
+//
+// SetMusic
+//
+void AudioMixer::SetMusic(AudioSource* music)
+{
+	music_ = music;
+}
+
+//
+// Update
+//
+void AudioMixer::Update(float frame_time)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		Voice& voice = voices_[i];
+		if (voice.active && voice.native_voice != -1)
+		{
+			voice.native_time_left -= frame_time;
+			if (voice.native_time_left <= 0.f)
+			{
+				voice.active = false;
+				voice.native_voice = -1;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < triggers_.size(); i++)
+	{
+		const Trigger& trigger = triggers_[i];
+		if (trigger.sample >= (int)samples_.size())
+			continue;
+
+		int index = FindVoice(trigger.priority);
+		if (index == -1)
+		{
+			triggers_dropped_++;
+			continue;
+		}
+
+		Voice& voice = voices_[index];
+		if (voice.active)
+		{
+			StopVoice(voice);
+			voices_stolen_++;
+		}
+
+		const Sample& sample = *samples_[trigger.sample];
+		voice.sample = trigger.sample;
+		voice.priority = trigger.priority;
+		voice.handle = trigger.handle;
+		voice.started = start_counter_++;
+		voice.frame = 0;
+		voice.native_voice = -1;
+
+		if (sample.frame_count == 0)
+		{
+			voice.native_voice = native_->PlaySample(sample.native_sample);
+			if (voice.native_voice == -1)
+				continue;
+			native_->SetVoiceGain(voice.native_voice, bus_gain_[BUS_SFX]);
+			voice.native_time_left = sample.duration;
+		}
+		voice.active = true;
+	}
+	triggers_.clear();
+}
+
+//
+// FindVoice
+//
+// A free voice, or the oldest of the lowest priority voices no more important than the trigger
+//
+int AudioMixer::FindVoice(int priority)
+{
+	int victim = -1;
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		const Voice& voice = voices_[i];
+		if (!voice.active)
+			return (int)i;
+		if (voice.priority > priority)
+			continue;
+
+		if (victim == -1 || voice.priority < voices_[victim].priority ||
+			(voice.priority == voices_[victim].priority && voice.started < voices_[victim].started))
+		{
+			victim = (int)i;
+		}
+	}
+	return victim;
+}
+
+//
+// StopVoice
+//
+void AudioMixer::StopVoice(Voice& voice)
+{
+	if (voice.active && voice.native_voice != -1 && native_)
+		native_->StopVoice(voice.native_voice);
+
+	voice.active = false;
+	voice.native_voice = -1;
+}
+
+//
+// Render
+//
+void AudioMixer::Render(float* samples, int frame_count, int sample_rate)
+{
+	memset(samples, 0, frame_count * 2 * sizeof(float));
+
+	AudioSource* music = music_;
+	if (music)
+	{
+		music_block_.resize(frame_count * 2);
+		music->Render(&music_block_[0], frame_count, sample_rate);
+		MixScaled(samples, &music_block_[0], frame_count * 2, bus_gain_[BUS_MUSIC]);
+	}
+
+	const float sfxGain = bus_gain_[BUS_SFX];
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		Voice& voice = voices_[i];
+		if (!voice.active || voice.native_voice != -1)
+			continue;
+
+		const Sample& sample = *samples_[voice.sample];
+		unsigned int frames = std::min((unsigned int)frame_count, sample.frame_count - voice.frame);
+		MixScaled(samples, &sample.pcm[voice.frame * 2], frames * 2, sfxGain);
+
+		voice.frame += frames;
+		if (voice.frame >= sample.frame_count)
+			voice.active = false;
+	}
+}
+
+//
+// sample_bytes
+//
+size_t AudioMixer::sample_bytes(int sample) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (sample < 0 || sample >= (int)samples_.size())
+		return 0;
+	return samples_[sample]->pcm.size() * sizeof(float);
+}
+
+//
+// active_voice_count
+//
+int AudioMixer::active_voice_count() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	int count = 0;
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		if (voices_[i].active)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,149 @@
+#ifndef _AUDIO_MIXER_H
+#define _AUDIO_MIXER_H
+
+#include "audio_output.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+enum AUDIO_BUS { BUS_SFX, BUS_MUSIC, BUS_COUNT };
+
+class AssetPack;
+
+// Plays samples through the platform audio when the mixer cannot decode them itself
+class NativeVoiceBackend
+{
+public:
+	virtual ~NativeVoiceBackend() {}
+
+	/// @brief Loads a sample into the platform audio.
+	/// @return The native sample index, or -1 if it failed to load
+	/// @param[out] duration	The length of the sample in seconds.
+	virtual int LoadSample(const char* filename, float& duration) = 0;
+
+	/// @return The native voice the sample is playing on, or -1
+	virtual int PlaySample(int sample) = 0;
+	virtual void StopVoice(int voice) = 0;
+	virtual void SetVoiceGain(int voice, float gain) = 0;
+};
+
+// Mixes a fixed pool of sample voices and the music bus into the output
+class AudioMixer : public AudioSource
+{
+public:
+	/// @brief Constructor.
+	/// @param[in] voice_count	The number of sample voices that can play at once.
+	/// @param[in] native		Fallback for samples that are not PCM WAV, may be NULL.
+	/// @param[in] sample_rate	The rate samples are converted to on load, the output rate.
+	AudioMixer(int voice_count = 8, NativeVoiceBackend* native = NULL, int sample_rate = AudioOutput::kSampleRate);
+
+	/// @brief Default destructor. Frees every sample.
+	~AudioMixer();
+
+	/// @brief Sets the pack searched for sample WAVs before the loose files.
+	/// @param[in] pack			The pack, not owned, NULL to search only loose files.
+	void SetSamplePack(const AssetPack* pack);
+
+	/// @brief Loads a sample. A .wav next to the file is preferred so it can be mixed in software.
+	/// @return The sample index, or -1 if it failed to load
+	int LoadSample(const char* filename);
+
+	/// @brief Requests a sample to play. Triggers are started by the next Update, and repeated
+	/// triggers of one sample before then play a single voice. Call on the thread that calls Update.
+	/// @param[in] sample		The sample index returned by LoadSample.
+	/// @param[in] priority		Higher priority triggers steal voices from lower ones when the pool is full.
+	/// @param[in] handle		Caller's id for the voice, for StopHandle. 0 for none.
+	void PlaySample(int sample, int priority = 0, unsigned int handle = 0);
+
+	/// @brief Stops the voice started for a handle, if it is still playing.
+	void StopHandle(unsigned int handle);
+
+	/// @brief Stops every sample voice.
+	void StopAll();
+
+	/// @brief Sets the gain of a bus. Voices are only touched when the gain changes.
+	/// @param[in] gain			The gain, from 0 to 1.
+	void SetBusGain(AUDIO_BUS bus, float gain);
+
+	/// @brief Sets the source mixed into the music bus.
+	/// @param[in] music		The music source, not owned, may be NULL.
+	void SetMusic(AudioSource* music);
+
+	/// @brief Starts the queued triggers and retires finished native voices. Call regularly.
+	/// @param[in] frame_time	Time since the last Update in seconds.
+	void Update(float frame_time);
+
+	void Render(float* samples, int frame_count, int sample_rate);
+
+	/// @brief Get the size of a sample.
+	/// @return The size in bytes of the converted PCM, 0 for native samples
+	size_t sample_bytes(int sample) const;
+
+	/// @brief Get the number of voices playing.
+	int active_voice_count() const;
+
+	/// @brief Get the number of triggers merged into another in the same frame.
+	inline unsigned int triggers_coalesced() const { return triggers_coalesced_; }
+
+	/// @brief Get the number of voices cut short for a higher priority trigger.
+	inline unsigned int voices_stolen() const { return voices_stolen_; }
+
+	/// @brief Get the number of triggers dropped because every voice had a higher priority.
+	inline unsigned int triggers_dropped() const { return triggers_dropped_; }
+
+private:
+	struct Sample
+	{
+		std::string filename;
+		// interleaved stereo at the output rate, padded to an even frame count
+		std::vector<float> pcm;
+		unsigned int frame_count;
+		int native_sample;
+		float duration;
+	};
+
+	struct Voice
+	{
+		int sample;
+		int priority;
+		unsigned int handle;
+		unsigned int started;
+		bool active;
+		unsigned int frame;
+		int native_voice;
+		float native_time_left;
+	};
+
+	struct Trigger
+	{
+		int sample;
+		int priority;
+		unsigned int handle;
+	};
+
+	bool LoadWav(const char* filename, Sample& sample);
+	int FindVoice(int priority);
+	void StopVoice(Voice& voice);
+
+	NativeVoiceBackend* native_;
+	int sample_rate_;
+	const AssetPack* pack_;
+
+	// guards samples_ and voices_ between the game thread and the output thread
+	mutable std::mutex mutex_;
+	std::vector<Sample*> samples_;
+	std::vector<Voice> voices_;
+	unsigned int start_counter_;
+
+	std::vector<Trigger> triggers_;
+	std::atomic<float> bus_gain_[BUS_COUNT];
+	std::atomic<AudioSource*> music_;
+	std::vector<float> music_block_;
+
+	unsigned int triggers_coalesced_;
+	unsigned int voices_stolen_;
+	unsigned int triggers_dropped_;
+};
+
+#endif // _AUDIO_MIXER_H
@@ -0,0 +1,211 @@
+#include "audio_output.h"
+#include "profiler.h"
+#include <chrono>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmsystem.h>
+#elif defined(SN_TARGET_PSP2)
+#include <audioout.h>
+#endif
+
+namespace
+{
+	// enough queued blocks to ride out a long frame on the game thread
+	const int kQueuedBlocks = 4;
+
+	void ConvertBlock(const float* source, short* target, int sample_count)
+	{
+		for (int i = 0; i < sample_count; i++)
+		{
+			float sample = source[i];
+			sample = sample > 1.f ? 1.f : (sample < -1.f ? -1.f : sample);
+			target[i] = (short)(sample * 32767.f);
+		}
+	}
+
+#if defined(_WIN32)
+	struct WaveDevice
+	{
+		HWAVEOUT wave_out;
+		HANDLE block_done;
+	};
+#endif
+}
+
+//
+// AudioOutput
+//
+AudioOutput::AudioOutput(AudioSource* source) :
+	source_(source),
+	device_(NULL),
+	quit_(false),
+	render_us_(0.f),
+	blocks_rendered_(0)
+{
+}
+
+//
+// ~AudioOutput
+//
+AudioOutput::~AudioOutput()
+{
+	Close();
+}
+
+//
+// Open
+//
+bool AudioOutput::Open()
+{
+	Close();
+
+#if defined(_WIN32)
+	WAVEFORMATEX format;
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = kSampleRate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+	format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+	format.cbSize = 0;
+
+	WaveDevice* device = new WaveDevice;
+	device->block_done = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (waveOutOpen(&device->wave_out, WAVE_MAPPER, &format, (DWORD_PTR)device->block_done, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+	{
+		CloseHandle(device->block_done);
+		delete device;
+		return false;
+	}
+	device_ = device;
+#elif defined(SN_TARGET_PSP2)
+	int port = sceAudioOutOpenPort(SCE_AUDIO_OUT_PORT_TYPE_BGM, kBlockFrames, kSampleRate, SCE_AUDIO_OUT_MODE_STEREO);
+	if (port < 0)
+		return false;
+	device_ = (void*)(size_t)(port + 1);
+#else
+	// null output, blocks are rendered on time and thrown away
+	device_ = this;
+#endif
+
+	quit_ = false;
+	blocks_rendered_ = 0;
+	thread_ = std::thread(&AudioOutput::OutputThread, this);
+	return true;
+}
+
+//
+// Close
+//
+void AudioOutput::Close()
+{
+	if (thread_.joinable())
+	{
+		quit_ = true;
+		thread_.join();
+	}
+
+	if (!device_)
+		return;
+
+#if defined(_WIN32)
+	WaveDevice* device = (WaveDevice*)device_;
+	waveOutClose(device->wave_out);
+	CloseHandle(device->block_done);
+	delete device;
+#elif defined(SN_TARGET_PSP2)
+	sceAudioOutReleasePort((int)(size_t)device_ - 1);
+#endif
+	device_ = NULL;
+}
+
+//
+// OutputThread
+//
+// Render a block whenever the device has room for one
+//
+void AudioOutput::OutputThread()
+{
+	Profiler::SetThreadName("audio output");
+
+	std::vector<float> mix(kBlockFrames * 2);
+	std::vector<short> blocks(kQueuedBlocks * kBlockFrames * 2);
+
+#if defined(_WIN32)
+	WaveDevice* device = (WaveDevice*)device_;
+	WAVEHDR headers[kQueuedBlocks];
+	for (int i = 0; i < kQueuedBlocks; i++)
+	{
+		ZeroMemory(&headers[i], sizeof(WAVEHDR));
+		headers[i].lpData = (LPSTR)&blocks[i * kBlockFrames * 2];
+		headers[i].dwBufferLength = kBlockFrames * 2 * sizeof(short);
+		waveOutPrepareHeader(device->wave_out, &headers[i], sizeof(WAVEHDR));
+		headers[i].dwFlags |= WHDR_DONE;
+	}
+
+	while (!quit_)
+	{
+		for (int i = 0; i < kQueuedBlocks; i++)
+		{
+			if (headers[i].dwFlags & WHDR_DONE)
+			{
+				RenderBlock(&mix[0]);
+				ConvertBlock(&mix[0], (short*)headers[i].lpData, kBlockFrames * 2);
+				headers[i].dwFlags &= ~WHDR_DONE;
+				waveOutWrite(device->wave_out, &headers[i], sizeof(WAVEHDR));
+			}
+		}
+		WaitForSingleObject(device->block_done, 100);
+	}
+
+	waveOutReset(device->wave_out);
+	for (int i = 0; i < kQueuedBlocks; i++)
+	{
+		waveOutUnprepareHeader(device->wave_out, &headers[i], sizeof(WAVEHDR));
+	}
+#elif defined(SN_TARGET_PSP2)
+	int port = (int)(size_t)device_ - 1;
+	for (int block = 0; !quit_; block = (block + 1) % kQueuedBlocks)
+	{
+		short* output = &blocks[block * kBlockFrames * 2];
+		RenderBlock(&mix[0]);
+		ConvertBlock(&mix[0], output, kBlockFrames * 2);
+
+		// blocks until the previous block has been consumed
+		sceAudioOutOutput(port, output);
+	}
+	sceAudioOutOutput(port, NULL);
+#else
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration blockTime = std::chrono::microseconds(1000000LL * kBlockFrames / kSampleRate);
+	Clock::time_point due = Clock::now();
+	for (int block = 0; !quit_; block = (block + 1) % kQueuedBlocks)
+	{
+		RenderBlock(&mix[0]);
+		ConvertBlock(&mix[0], &blocks[block * kBlockFrames * 2], kBlockFrames * 2);
+
+		due += blockTime;
+		std::this_thread::sleep_until(due);
+	}
+#endif
+}
+
+//
+// RenderBlock
+//
+void AudioOutput::RenderBlock(float* mix)
+{
+	PROFILE_SCOPE("AudioOutput::RenderBlock");
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	source_->Render(mix, kBlockFrames, kSampleRate);
+
+	float renderUs = std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+	render_us_ = render_us_ + (renderUs - render_us_) * 0.05f;
+	blocks_rendered_++;
+}
@@ -0,0 +1,66 @@
+#ifndef _AUDIO_OUTPUT_H
+#define _AUDIO_OUTPUT_H
+
+#include <thread>
+#include <atomic>
+
+// Something the output thread pulls interleaved stereo float samples from
+class AudioSource
+{
+public:
+	virtual ~AudioSource() {}
+
+	/// @brief Fills a block of output. Called on the output thread, so must not block.
+	/// @param[out] samples		Interleaved stereo samples in the range -1 to 1.
+	/// @param[in] frame_count	The number of stereo frames to write.
+	/// @param[in] sample_rate	The output sample rate.
+	virtual void Render(float* samples, int frame_count, int sample_rate) = 0;
+};
+
+class AudioOutput
+{
+public:
+	/// @brief Constructor.
+	/// @param[in] source		The source rendered into every block, not owned.
+	AudioOutput(AudioSource* source);
+
+	/// @brief Default destructor. Closes the device.
+	~AudioOutput();
+
+	/// @brief Opens the platform device and starts the output thread.
+	/// Platforms without a device get a null output that renders in real time and discards the result.
+	/// @return false if the device could not be opened
+	bool Open();
+
+	/// @brief Stops the output thread and closes the device.
+	void Close();
+
+	/// @brief Get the output sample rate.
+	inline int sample_rate() const { return kSampleRate; }
+
+	/// @brief Get the number of frames rendered per block.
+	inline int block_frames() const { return kBlockFrames; }
+
+	/// @brief Get the smoothed time spent in the source's Render.
+	/// @return The time per block in microseconds
+	inline float render_us() const { return render_us_; }
+
+	/// @brief Get the number of blocks rendered since the output was opened.
+	inline unsigned int blocks_rendered() const { return blocks_rendered_; }
+
+	static const int kSampleRate = 48000;
+	static const int kBlockFrames = 512;
+
+private:
+	void OutputThread();
+	void RenderBlock(float* mix);
+
+	AudioSource* source_;
+	void* device_;
+	std::thread thread_;
+	std::atomic<bool> quit_;
+	std::atomic<float> render_us_;
+	std::atomic<unsigned int> blocks_rendered_;
+};
+
+#endif // _AUDIO_OUTPUT_H
@@ -0,0 +1,202 @@
+#include "audio_thread.h"
+#include "music_stream.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	// how often the mixer is updated, well inside one output block
+	const int kTickMicroseconds = 2000;
+}
+
+//
+// AudioThread
+//
+AudioThread::AudioThread(AudioMixer* mixer, MusicStream* music) :
+	mixer_(mixer),
+	music_(music),
+	quit_(false),
+	next_voice_(1),
+	dropped_commands_(0)
+{
+	for (int i = 0; i < BUS_COUNT; i++)
+	{
+		bus_gain_[i] = -1.f;
+	}
+
+	thread_ = std::thread(&AudioThread::ThreadMain, this);
+}
+
+//
+// ~AudioThread
+//
+AudioThread::~AudioThread()
+{
+	quit_ = true;
+	thread_.join();
+}
+
+//
+// PlaySample
+//
+VoiceHandle AudioThread::PlaySample(int sample, int priority)
+{
+	Command command;
+	memset(&command, 0, sizeof(command));
+	command.type = CMD_PLAY_SAMPLE;
+	command.sample = sample;
+	command.priority = priority;
+	command.voice = next_voice_;
+
+	if (!commands_.Push(command))
+	{
+		dropped_commands_++;
+		return 0;
+	}
+
+	// 0 is never handed out, so it can mean no voice
+	next_voice_ = next_voice_ + 1 ? next_voice_ + 1 : 1;
+	return command.voice;
+}
+
+//
+// StopVoice
+//
+void AudioThread::StopVoice(VoiceHandle voice)
+{
+	if (voice == 0)
+		return;
+
+	Command command;
+	memset(&command, 0, sizeof(command));
+	command.type = CMD_STOP_VOICE;
+	command.voice = voice;
+	Push(command);
+}
+
+//
+// StopAllSamples
+//
+void AudioThread::StopAllSamples()
+{
+	Command command;
+	memset(&command, 0, sizeof(command));
+	command.type = CMD_STOP_ALL;
+	Push(command);
+}
+
+//
+// SetBusGain
+//
+void AudioThread::SetBusGain(AUDIO_BUS bus, float gain)
+{
+	if (bus_gain_[bus] == gain)
+		return;
+
+	Command command;
+	memset(&command, 0, sizeof(command));
+	command.type = CMD_BUS_GAIN;
+	command.bus = bus;
+	command.gain = gain;
+	if (commands_.Push(command))
+		bus_gain_[bus] = gain;
+	else
+		dropped_commands_++;
+}
+
+//
+// PlayMusic
+//
+void AudioThread::PlayMusic(const char* filename, bool loop)
+{
+	Command command;
+	memset(&command, 0, sizeof(command));
+	command.type = CMD_PLAY_MUSIC;
+	command.filename = filename;
+	command.loop = loop;
+	Push(command);
+}
+
+//
+// StopMusic
+//
+void AudioThread::StopMusic()
+{
+	Command command;
+	memset(&command, 0, sizeof(command));
+	command.type = CMD_STOP_MUSIC;
+	Push(command);
+}
+
+//
+// Push
+//
+void AudioThread::Push(const Command& command)
+{
+	if (!commands_.Push(command))
+		dropped_commands_++;
+}
+
+//
+// Execute
+//
+void AudioThread::Execute(const Command& command)
+{
+	switch (command.type)
+	{
+	case CMD_PLAY_SAMPLE:
+		mixer_->PlaySample(command.sample, command.priority, command.voice);
+		break;
+	case CMD_STOP_VOICE:
+		mixer_->StopHandle(command.voice);
+		break;
+	case CMD_STOP_ALL:
+		mixer_->StopAll();
+		break;
+	case CMD_BUS_GAIN:
+		mixer_->SetBusGain(command.bus, command.gain);
+		break;
+	case CMD_PLAY_MUSIC:
+		music_->Play(command.filename, command.loop);
+		break;
+	case CMD_STOP_MUSIC:
+		music_->Stop();
+		break;
+	default:
+		break;
+	}
+}
+
+//
+// ThreadMain
+//
+void AudioThread::ThreadMain()
+{
+	Profiler::SetThreadName("audio");
+	AllocTagScope alloc_scope(ALLOC_AUDIO);
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point last = Clock::now();
+
+	for (;;)
+	{
+		// read quit first so commands pushed before shutdown are still run
+		bool quit = quit_;
+
+		Command command;
+		while (commands_.Pop(command))
+		{
+			Execute(command);
+		}
+
+		Clock::time_point now = Clock::now();
+		mixer_->Update(std::chrono::duration<float>(now - last).count());
+		last = now;
+
+		if (quit)
+			break;
+		std::this_thread::sleep_for(std::chrono::microseconds(kTickMicroseconds));
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef _AUDIO_THREAD_H
+#define _AUDIO_THREAD_H
+
+#include "audio_mixer.h"
+#include "spsc_queue.h"
+#include <thread>
+#include <atomic>
+
+class MusicStream;
+
+// Identifies a sample voice that was requested from the game thread. A handle whose
+// voice has finished, been stolen or been coalesced into another is simply ignored.
+typedef unsigned int VoiceHandle;
+
+// Runs the mixer and music control on their own thread, fed by a lock-free command ring,
+// so nothing the game thread does with audio can wait on the backend
+class AudioThread
+{
+public:
+	/// @brief Constructor. Starts the audio thread.
+	/// @param[in] mixer		The mixer the thread updates, not owned.
+	/// @param[in] music		The music stream the thread controls, not owned.
+	AudioThread(AudioMixer* mixer, MusicStream* music);
+
+	/// @brief Default destructor. Runs the commands still queued and stops the thread.
+	~AudioThread();
+
+	/// @brief Queues a sample to play.
+	/// @return A handle for StopVoice, 0 if the command ring was full
+	/// @param[in] sample		The sample index from AudioMixer::LoadSample.
+	/// @param[in] priority		Voice stealing priority, see AudioMixer::PlaySample.
+	VoiceHandle PlaySample(int sample, int priority = 0);
+
+	/// @brief Queues a stop for the voice a sample was started on.
+	void StopVoice(VoiceHandle voice);
+
+	/// @brief Queues a stop for every sample voice.
+	void StopAllSamples();
+
+	/// @brief Queues a bus gain change. Nothing is queued if the gain has not changed.
+	void SetBusGain(AUDIO_BUS bus, float gain);
+
+	/// @brief Queues a music track to start.
+	/// @param[in] filename		The track, which must stay valid until it is played.
+	/// @param[in] loop			Restart the track when it ends.
+	void PlayMusic(const char* filename, bool loop = true);
+
+	/// @brief Queues the music to stop.
+	void StopMusic();
+
+	/// @brief Get the number of commands lost to a full ring.
+	inline unsigned int dropped_commands() const { return dropped_commands_; }
+
+private:
+	enum COMMAND_TYPE { CMD_PLAY_SAMPLE, CMD_STOP_VOICE, CMD_STOP_ALL, CMD_BUS_GAIN, CMD_PLAY_MUSIC, CMD_STOP_MUSIC };
+
+	struct Command
+	{
+		COMMAND_TYPE type;
+		int sample;
+		int priority;
+		VoiceHandle voice;
+		AUDIO_BUS bus;
+		float gain;
+		const char* filename;
+		bool loop;
+	};
+
+	void Push(const Command& command);
+	void Execute(const Command& command);
+	void ThreadMain();
+
+	AudioMixer* mixer_;
+	MusicStream* music_;
+
+	SpscQueue<Command, 256> commands_;
+	std::thread thread_;
+	std::atomic<bool> quit_;
+
+	// game thread only
+	VoiceHandle next_voice_;
+	float bus_gain_[BUS_COUNT];
+	unsigned int dropped_commands_;
+};
+
+#endif // _AUDIO_THREAD_H
@@ -0,0 +1,31 @@
+#ifndef _BAKED_TEXTURE_FORMAT_H
+#define _BAKED_TEXTURE_FORMAT_H
+
+// Layout of a texture pre-decoded by tools/texture_baker, read by LoadImageData.
+//
+// [BakedTextureHeader][mip 0][mip 1]...
+//
+// Every level is tightly packed RGBA8 in the order gef::ImageData expects, each half the
+// size of the one before down to 1x1, so level 0 can be handed to the texture unchanged.
+
+#include <stdint.h>
+
+static const uint32_t kBakedTextureMagic = 0x31584554;	// "TEX1"
+static const uint32_t kBakedTextureVersion = 1;
+
+enum BAKED_TEXTURE_FORMAT
+{
+	BAKED_RGBA8 = 0,
+};
+
+struct BakedTextureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint32_t mip_count;
+};
+
+#endif // _BAKED_TEXTURE_FORMAT_H
@@ -0,0 +1,32 @@
+//
+// Stands in for Box2D's src/common/b2_settings.cpp in the box2d build, the one place Box2D
+// expects a game to plug in its own allocator and logging. Everything else Box2D builds
+// unchanged.
+//
+#define _CRT_SECURE_NO_WARNINGS
+#include "box2d/b2_settings.h"
+#include "physics_allocator.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+b2Version b2_version = {2, 4, 0};
+
+// Memory allocators, routed to the pool of whichever world is being worked on.
+void* b2Alloc(int32 size)
+{
+	return PhysicsPool::Current()->Allocate((size_t)size);
+}
+
+void b2Free(void* mem)
+{
+	PhysicsPool::Free(mem);
+}
+
+// You can modify this to use your logging facility.
+void b2Log(const char* string, ...)
+{
+	va_list args;
+	va_start(args, string);
+	vprintf(string, args);
+	va_end(args);
+}
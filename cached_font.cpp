@@ -0,0 +1,271 @@
+#include "cached_font.h"
+#include "load_texture.h"
+#include "profiler.h"
+#include <graphics/sprite_renderer.h>
+#include <graphics/sprite.h>
+#include <graphics/texture.h>
+#include <system/debug_log.h>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+//
+// CachedFont
+//
+CachedFont::CachedFont(gef::Platform& platform) :
+	platform_(platform),
+	page_texture_(NULL),
+	texture_(NULL),
+	texture_width_(1.f),
+	texture_height_(1.f),
+	use_counter_(0),
+	layout_count_(0)
+{
+	memset(glyphs_, 0, sizeof(glyphs_));
+	page_region_.uv_position = gef::Vector2(0.f, 0.f);
+	page_region_.uv_width = 1.f;
+	page_region_.uv_height = 1.f;
+	for (int i = 0; i < kMaxRuns; i++)
+	{
+		runs_[i].text[0] = '\0';
+		runs_[i].quad_count = 0;
+		runs_[i].last_used = 0;
+	}
+}
+
+//
+// ~CachedFont
+//
+CachedFont::~CachedFont()
+{
+	delete page_texture_;
+	page_texture_ = NULL;
+	texture_ = NULL;
+}
+
+//
+// Load
+//
+// Read the BMFont text descriptor and the texture page it references
+//
+bool CachedFont::Load(const char* font_name, const TextureAtlas* atlas, const AssetPack* pack)
+{
+	std::string filename = std::string(font_name) + ".fnt";
+
+	// read the descriptor in place from the asset pack when it is packed
+	std::string fileContents;
+	size_t size = 0;
+	const char* data = pack ? (const char*)pack->Find(filename.c_str(), &size) : NULL;
+	if (!data)
+	{
+		std::ifstream fontFile(filename.c_str(), std::ifstream::binary);
+		if (!fontFile.good())
+		{
+			gef::DebugOut("Font file %s failed to load\n", filename.c_str());
+			return false;
+		}
+		fileContents.assign(std::istreambuf_iterator<char>(fontFile), std::istreambuf_iterator<char>());
+		data = fileContents.data();
+		size = fileContents.size();
+	}
+
+	std::string pageFile;
+	const char* end = data + size;
+	for (const char* lineStart = data; lineStart < end;)
+	{
+		const char* lineEnd = (const char*)memchr(lineStart, '\n', end - lineStart);
+		if (!lineEnd)
+			lineEnd = end;
+
+		// lines are short, copy each one so sscanf stops at the line end
+		char line[256];
+		size_t length = std::min((size_t)(lineEnd - lineStart), sizeof(line) - 1);
+		memcpy(line, lineStart, length);
+		line[length] = '\0';
+		lineStart = lineEnd + 1;
+
+		int id, x, y, width, height, xoffset, yoffset, xadvance, scaleW, scaleH;
+		char page[128];
+
+		if (sscanf(line, "char id=%d x=%d y=%d width=%d height=%d xoffset=%d yoffset=%d xadvance=%d",
+			&id, &x, &y, &width, &height, &xoffset, &yoffset, &xadvance) == 8)
+		{
+			if (id >= 0 && id < kMaxGlyphs)
+			{
+				Glyph& glyph = glyphs_[id];
+				glyph.x = (float)x;
+				glyph.y = (float)y;
+				glyph.width = (float)width;
+				glyph.height = (float)height;
+				glyph.x_offset = (float)xoffset;
+				glyph.y_offset = (float)yoffset;
+				glyph.x_advance = (float)xadvance;
+				glyph.valid = true;
+			}
+		}
+		else if (strncmp(line, "common ", 7) == 0)
+		{
+			const char* w = strstr(line, "scaleW=");
+			const char* h = strstr(line, "scaleH=");
+			if (w && h && sscanf(w, "scaleW=%d", &scaleW) == 1 && sscanf(h, "scaleH=%d", &scaleH) == 1)
+			{
+				texture_width_ = (float)scaleW;
+				texture_height_ = (float)scaleH;
+			}
+		}
+		else if (pageFile.empty() && sscanf(line, "page id=0 file=\"%127[^\"]\"", page) == 1)
+		{
+			pageFile = page;
+		}
+	}
+
+	if (pageFile.empty())
+		return false;
+
+	// prefer the page packed into the UI atlas so text shares its texture
+	int region = atlas ? atlas->FindRegion(pageFile.c_str()) : -1;
+	if (region != -1 && atlas->texture())
+	{
+		texture_ = atlas->texture();
+		page_region_ = atlas->region(region);
+	}
+	else
+	{
+		page_texture_ = CreateTextureFromPNG(pageFile.c_str(), platform_);
+		texture_ = page_texture_;
+	}
+
+	return texture_ != NULL;
+}
+
+//
+// RenderText
+//
+void CachedFont::RenderText(gef::SpriteRenderer* sprite_renderer, const gef::Vector4& pos, const float scale, const UInt32 colour, const gef::TextJustification justification, const char* text, ...)
+{
+	if (!texture_ || !sprite_renderer || !text)
+		return;
+
+	PROFILE_SCOPE("CachedFont::RenderText");
+
+	// format into a stack buffer so a cache hit never touches the heap
+	char buffer[kMaxRunLength + 1];
+	va_list args;
+	va_start(args, text);
+	vsnprintf(buffer, sizeof(buffer), text, args);
+	va_end(args);
+
+	// FNV-1a hash of the formatted string
+	UInt32 hash = 2166136261u;
+	for (const char* c = buffer; *c; ++c)
+	{
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+
+	GlyphRun* run = FindRun(buffer, hash, scale, justification);
+	if (!run)
+	{
+		// reuse the least recently drawn run
+		run = &runs_[0];
+		for (int i = 1; i < kMaxRuns; i++)
+		{
+			if (runs_[i].last_used < run->last_used)
+				run = &runs_[i];
+		}
+		LayoutRun(*run, buffer, hash, scale, justification);
+	}
+	run->last_used = ++use_counter_;
+
+	gef::Sprite glyph;
+	glyph.set_texture(texture_);
+	glyph.set_colour(colour);
+	for (int i = 0; i < run->quad_count; i++)
+	{
+		const GlyphQuad& quad = run->quads[i];
+		glyph.set_position(gef::Vector4(pos.x() + quad.centre.x, pos.y() + quad.centre.y, pos.z()));
+		glyph.set_width(quad.width);
+		glyph.set_height(quad.height);
+		glyph.set_uv_position(quad.uv_position);
+		glyph.set_uv_width(quad.uv_width);
+		glyph.set_uv_height(quad.uv_height);
+		sprite_renderer->DrawSprite(glyph);
+	}
+}
+
+//
+// GetStringLength
+//
+float CachedFont::GetStringLength(const char* text) const
+{
+	float length = 0.f;
+	for (const char* c = text; c && *c; ++c)
+	{
+		const Glyph& glyph = glyphs_[(unsigned char)*c];
+		if (glyph.valid)
+			length += glyph.x_advance;
+	}
+	return length;
+}
+
+//
+// FindRun
+//
+CachedFont::GlyphRun* CachedFont::FindRun(const char* text, UInt32 hash, float scale, gef::TextJustification justification)
+{
+	for (int i = 0; i < kMaxRuns; i++)
+	{
+		GlyphRun& run = runs_[i];
+		if (run.last_used != 0 && run.hash == hash && run.scale == scale && run.justification == justification && strcmp(run.text, text) == 0)
+			return &run;
+	}
+	return NULL;
+}
+
+//
+// LayoutRun
+//
+// Build the glyph quads for a string relative to the text origin
+//
+void CachedFont::LayoutRun(GlyphRun& run, const char* text, UInt32 hash, float scale, gef::TextJustification justification)
+{
+	run.hash = hash;
+	run.scale = scale;
+	run.justification = justification;
+	strncpy(run.text, text, kMaxRunLength);
+	run.text[kMaxRunLength] = '\0';
+	run.quad_count = 0;
+
+	float penX = 0.f;
+	if (justification == gef::TJ_CENTRE)
+		penX = -GetStringLength(run.text) * scale * 0.5f;
+	else if (justification == gef::TJ_RIGHT)
+		penX = -GetStringLength(run.text) * scale;
+
+	for (const char* c = run.text; *c; ++c)
+	{
+		const Glyph& glyph = glyphs_[(unsigned char)*c];
+		if (!glyph.valid)
+			continue;
+
+		if (glyph.width > 0.f && glyph.height > 0.f)
+		{
+			GlyphQuad& quad = run.quads[run.quad_count++];
+			quad.width = glyph.width * scale;
+			quad.height = glyph.height * scale;
+			quad.centre = gef::Vector2(penX + glyph.x_offset * scale + quad.width * 0.5f, glyph.y_offset * scale + quad.height * 0.5f);
+			quad.uv_position = gef::Vector2(
+				page_region_.uv_position.x + glyph.x / texture_width_ * page_region_.uv_width,
+				page_region_.uv_position.y + glyph.y / texture_height_ * page_region_.uv_height);
+			quad.uv_width = glyph.width / texture_width_ * page_region_.uv_width;
+			quad.uv_height = glyph.height / texture_height_ * page_region_.uv_height;
+		}
+
+		penX += glyph.x_advance * scale;
+	}
+
+	layout_count_++;
+}
@@ -0,0 +1,103 @@
+#ifndef _CACHED_FONT_H
+#define _CACHED_FONT_H
+
+#include <graphics/font.h>
+#include <maths/vector2.h>
+#include <maths/vector4.h>
+#include "texture_atlas.h"
+#include "asset_pack.h"
+
+// FRAMEWORK FORWARD DECLARATIONS
+namespace gef
+{
+	class Platform;
+	class SpriteRenderer;
+	class Texture;
+}
+
+class CachedFont
+{
+public:
+	/// @brief Constructor.
+	/// @param[in] platform		The platform the font is being created on.
+	CachedFont(gef::Platform& platform);
+
+	/// @brief Default destructor.
+	~CachedFont();
+
+	/// @brief Loads the glyph table and texture page of a BMFont text font.
+	/// @return true if the font was loaded
+	/// @param[in] font_name	The name of the font, without the .fnt extension.
+	/// @param[in] atlas		Atlas to take the texture page from. The page is loaded separately if NULL or not packed.
+	/// @param[in] pack			Asset pack to read the descriptor from. Falls back to the loose file if NULL or not packed.
+	bool Load(const char* font_name, const TextureAtlas* atlas = NULL, const AssetPack* pack = NULL);
+
+	/// @brief Renders formatted text, reusing the cached glyph layout when the string has been drawn before.
+	/// @param[in] sprite_renderer	The sprite renderer used to draw the glyphs.
+	/// @param[in] pos				The position of the text.
+	/// @param[in] scale			The scale applied to every glyph.
+	/// @param[in] colour			The colour of the text.
+	/// @param[in] justification	How the text is aligned to pos.
+	/// @param[in] text				printf style format string.
+	void RenderText(gef::SpriteRenderer* sprite_renderer, const gef::Vector4& pos, const float scale, const UInt32 colour, const gef::TextJustification justification, const char* text, ...);
+
+	/// @brief Get the length of a string in pixels at a scale of 1.
+	/// @return The string length
+	/// @param[in] text			The string to measure.
+	float GetStringLength(const char* text) const;
+
+	/// @brief Get the number of times a glyph run has been laid out.
+	/// @return The layout count
+	inline unsigned int layout_count() const { return layout_count_; }
+
+private:
+	static const int kMaxRunLength = 64;
+	static const int kMaxRuns = 64;
+	static const int kMaxGlyphs = 256;
+
+	struct Glyph
+	{
+		float x, y;
+		float width, height;
+		float x_offset, y_offset;
+		float x_advance;
+		bool valid;
+	};
+
+	struct GlyphQuad
+	{
+		gef::Vector2 centre;
+		float width, height;
+		gef::Vector2 uv_position;
+		float uv_width, uv_height;
+	};
+
+	struct GlyphRun
+	{
+		UInt32 hash;
+		float scale;
+		gef::TextJustification justification;
+		char text[kMaxRunLength + 1];
+		GlyphQuad quads[kMaxRunLength];
+		int quad_count;
+		unsigned int last_used;
+	};
+
+	GlyphRun* FindRun(const char* text, UInt32 hash, float scale, gef::TextJustification justification);
+	void LayoutRun(GlyphRun& run, const char* text, UInt32 hash, float scale, gef::TextJustification justification);
+
+	gef::Platform& platform_;
+	gef::Texture* page_texture_;
+	const gef::Texture* texture_;
+	AtlasRegion page_region_;
+
+	Glyph glyphs_[kMaxGlyphs];
+	float texture_width_;
+	float texture_height_;
+
+	GlyphRun runs_[kMaxRuns];
+	unsigned int use_counter_;
+	unsigned int layout_count_;
+};
+
+#endif // _CACHED_FONT_H
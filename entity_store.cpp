@@ -0,0 +1,240 @@
+#include "entity_store.h"
+#include <graphics/renderer_3d.h>
+
+namespace
+{
+	// fills a removed row with the last one
+	template <typename T>
+	void RemoveRow(std::vector<T>& column, int row)
+	{
+		column[row] = column.back();
+		column.pop_back();
+	}
+}
+
+//
+// EntityStore
+//
+EntityStore::EntityStore()
+{
+}
+
+//
+// Create
+//
+Entity EntityStore::Create(OBJECT_TYPE type)
+{
+	Entity entity;
+	if (!free_.empty())
+	{
+		entity = free_.back();
+		free_.pop_back();
+	}
+	else
+	{
+		entity = (Entity)rows_.size();
+		rows_.push_back(-1);
+	}
+	rows_[entity] = (int)entities_.size();
+
+	gef::Matrix44 transform;
+	transform.SetIdentity();
+	RenderMesh mesh = { NULL, NULL };
+	ScoreValue score = { 0, 0 };
+	FlipperState flipper;
+	flipper.joint = NULL;
+	flipper.pin = NULL;
+	flipper.rest.SetZero();
+	flipper.left = false;
+
+	entities_.push_back(entity);
+	types_.push_back(type);
+	components_.push_back(0);
+	transforms_.push_back(transform);
+	bodies_.push_back(NULL);
+	meshes_.push_back(mesh);
+	scores_.push_back(score);
+	hits_.push_back(0);
+	flippers_.push_back(flipper);
+	return entity;
+}
+
+//
+// Destroy
+//
+void EntityStore::Destroy(Entity entity)
+{
+	int row = Row(entity);
+	if (row < 0)
+		return;
+
+	rows_[entities_.back()] = row;
+	rows_[entity] = -1;
+	free_.push_back(entity);
+
+	RemoveRow(entities_, row);
+	RemoveRow(types_, row);
+	RemoveRow(components_, row);
+	RemoveRow(transforms_, row);
+	RemoveRow(bodies_, row);
+	RemoveRow(meshes_, row);
+	RemoveRow(scores_, row);
+	RemoveRow(hits_, row);
+	RemoveRow(flippers_, row);
+}
+
+//
+// Clear
+//
+void EntityStore::Clear()
+{
+	entities_.clear();
+	types_.clear();
+	components_.clear();
+	transforms_.clear();
+	bodies_.clear();
+	meshes_.clear();
+	scores_.clear();
+	hits_.clear();
+	flippers_.clear();
+	rows_.clear();
+	free_.clear();
+}
+
+//
+// Row
+//
+int EntityStore::Row(Entity entity) const
+{
+	return entity < rows_.size() ? rows_[entity] : -1;
+}
+
+//
+// AttachBody
+//
+void EntityStore::AttachBody(Entity entity, b2Body* body)
+{
+	int row = Row(entity);
+	bodies_[row] = body;
+	components_[row] |= COMPONENT_BODY;
+
+	// the id rather than the row, rows move when another entity is destroyed
+	body->SetUserData((void*)(uintptr_t)entity);
+
+	transforms_[row].RotationZ(body->GetAngle());
+	transforms_[row].SetTranslation(gef::Vector4(body->GetPosition().x, body->GetPosition().y, 0.0f));
+}
+
+//
+// AttachMesh
+//
+void EntityStore::AttachMesh(Entity entity, const gef::Mesh* mesh, const gef::Material* material)
+{
+	int row = Row(entity);
+	meshes_[row].mesh = mesh;
+	meshes_[row].material = material;
+	components_[row] |= COMPONENT_MESH;
+}
+
+//
+// AttachScore
+//
+void EntityStore::AttachScore(Entity entity, int points, int priority)
+{
+	int row = Row(entity);
+	scores_[row].points = points;
+	scores_[row].priority = priority;
+	components_[row] |= COMPONENT_SCORE;
+}
+
+//
+// AttachBarrier
+//
+void EntityStore::AttachBarrier(Entity entity)
+{
+	int row = Row(entity);
+	hits_[row] = 0;
+	components_[row] |= COMPONENT_BARRIER;
+}
+
+//
+// AttachFlipper
+//
+void EntityStore::AttachFlipper(Entity entity, b2RevoluteJoint* joint, b2Body* pin, bool left)
+{
+	int row = Row(entity);
+	flippers_[row].joint = joint;
+	flippers_[row].pin = pin;
+	flippers_[row].rest = bodies_[row] ? bodies_[row]->GetPosition() : b2Vec2(0.f, 0.f);
+	flippers_[row].left = left;
+	components_[row] |= COMPONENT_FLIPPER;
+}
+
+//
+// FromBody
+//
+Entity EntityStore::FromBody(const b2Body* body)
+{
+	return (Entity)(uintptr_t)body->GetUserData();
+}
+
+//
+// SyncTransforms
+//
+void EntityStore::SyncTransforms()
+{
+	for (size_t row = 0; row < bodies_.size(); row++)
+	{
+		// static bodies never move, their transform was set when they were attached
+		const b2Body* body = bodies_[row];
+		if (!body || body->GetType() == b2_staticBody)
+			continue;
+
+		gef::Matrix44& transform = transforms_[row];
+		transform.RotationZ(body->GetAngle());
+		transform.SetTranslation(gef::Vector4(body->GetPosition().x, body->GetPosition().y, 0.0f));
+	}
+}
+
+//
+// Draw
+//
+int EntityStore::Draw(gef::Renderer3D* renderer)
+{
+	// rows are created a kind at a time, so the override only changes between kinds
+	const gef::Material* material = NULL;
+	int draws = 0;
+	for (size_t row = 0; row < meshes_.size(); row++)
+	{
+		if (!meshes_[row].mesh || ((components_[row] & COMPONENT_BARRIER) && hits_[row]))
+			continue;
+
+		if (meshes_[row].material != material)
+		{
+			material = meshes_[row].material;
+			renderer->set_override_material(material);
+		}
+
+		instance_.set_mesh(meshes_[row].mesh);
+		instance_.set_transform(transforms_[row]);
+		renderer->DrawMesh(instance_);
+		draws++;
+	}
+	if (material)
+		renderer->set_override_material(NULL);
+	return draws;
+}
+
+//
+// Count
+//
+unsigned int EntityStore::Count(OBJECT_TYPE type) const
+{
+	unsigned int count = 0;
+	for (size_t row = 0; row < types_.size(); row++)
+	{
+		if (types_[row] == type)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,135 @@
+#ifndef _ENTITY_STORE_H
+#define _ENTITY_STORE_H
+
+#include <graphics/mesh_instance.h>
+#include <maths/matrix44.h>
+#include <box2d/Box2D.h>
+#include <stdint.h>
+#include <vector>
+
+namespace gef
+{
+	class Mesh;
+	class Material;
+	class Renderer3D;
+}
+
+// also the collision category of the entity's fixtures
+enum OBJECT_TYPE
+{
+	BALL = 0x0001,
+	FLIPPER = 0x0002,
+	BARRIER = 0x0004,
+	HITBARRIER = 0x0040,
+	BUMPER = 0x0008,
+	LOSETRIGGER = 0x0020,
+	BOARD = 0x0010,
+};
+
+// which optional components a row holds, every row has a type and a transform
+enum COMPONENT
+{
+	COMPONENT_BODY = 0x01,
+	COMPONENT_MESH = 0x02,
+	COMPONENT_SCORE = 0x04,
+	COMPONENT_BARRIER = 0x08,
+	COMPONENT_FLIPPER = 0x10,
+};
+
+typedef uint32_t Entity;
+
+struct RenderMesh
+{
+	const gef::Mesh* mesh;
+	// drawn as an override, NULL for the mesh's own materials
+	const gef::Material* material;
+};
+
+struct ScoreValue
+{
+	int points;
+	// voice priority of the contact sound
+	int priority;
+};
+
+struct FlipperState
+{
+	b2RevoluteJoint* joint;
+	b2Body* pin;
+	b2Vec2 rest;
+	bool left;
+};
+
+// Every table element, stored as one column per component. Rows are packed, destroying an
+// entity moves the last row into its place, so a system walks each column it needs from
+// start to end. Entities are stable ids that map to rows, and are what the elements' bodies
+// carry as user data. A new kind of element is a new combination of components rather than
+// a new class.
+class EntityStore
+{
+public:
+	EntityStore();
+
+	Entity Create(OBJECT_TYPE type);
+
+	/// @brief Removes an entity. Its body and joint are left for the caller to destroy.
+	void Destroy(Entity entity);
+
+	void Clear();
+
+	/// @return The row the entity is stored in, or -1 if it has been destroyed
+	int Row(Entity entity) const;
+
+	/// @brief Ties a body to the entity and sets the transform from it.
+	void AttachBody(Entity entity, b2Body* body);
+	void AttachMesh(Entity entity, const gef::Mesh* mesh, const gef::Material* material);
+	void AttachScore(Entity entity, int points, int priority);
+	void AttachBarrier(Entity entity);
+	void AttachFlipper(Entity entity, b2RevoluteJoint* joint, b2Body* pin, bool left);
+
+	/// @return The entity a body was attached to
+	static Entity FromBody(const b2Body* body);
+
+	/// @brief Copies the pose of every body that can move into its row's transform.
+	void SyncTransforms();
+
+	/// @brief Draws every row with a mesh, skipping barriers that have been hit.
+	/// @return The number of meshes drawn
+	int Draw(gef::Renderer3D* renderer);
+
+	/// @return The number of entities of a type
+	unsigned int Count(OBJECT_TYPE type) const;
+
+	inline unsigned int size() const { return (unsigned int)entities_.size(); }
+
+	inline Entity entity(int row) const { return entities_[row]; }
+	inline OBJECT_TYPE type(int row) const { return types_[row]; }
+	inline uint32_t components(int row) const { return components_[row]; }
+	inline const gef::Matrix44& transform(int row) const { return transforms_[row]; }
+	inline b2Body* body(int row) const { return bodies_[row]; }
+	inline const ScoreValue& score(int row) const { return scores_[row]; }
+	inline const FlipperState& flipper(int row) const { return flippers_[row]; }
+
+	inline bool hit(int row) const { return hits_[row] != 0; }
+	inline void set_hit(int row, bool hit) { hits_[row] = hit ? 1 : 0; }
+
+private:
+	std::vector<Entity> entities_;
+	std::vector<OBJECT_TYPE> types_;
+	std::vector<uint32_t> components_;
+	std::vector<gef::Matrix44> transforms_;
+	std::vector<b2Body*> bodies_;
+	std::vector<RenderMesh> meshes_;
+	std::vector<ScoreValue> scores_;
+	std::vector<uint8_t> hits_;
+	std::vector<FlipperState> flippers_;
+
+	// indexed by entity, -1 while the entity is free
+	std::vector<int> rows_;
+	std::vector<Entity> free_;
+
+	// the renderer draws mesh instances, each row is copied through this one
+	gef::MeshInstance instance_;
+};
+
+#endif // _ENTITY_STORE_H
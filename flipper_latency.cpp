@@ -0,0 +1,159 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "flipper_latency.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+	const char* kStageNames[LATENCY_STAGE_COUNT] = { "edge_to_step", "step_to_motion", "motion_to_render", "total" };
+
+	void AppendLine(std::vector<unsigned char>& csv, const char* format, ...)
+	{
+		char line[128];
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(line, sizeof(line), format, args);
+		va_end(args);
+		if (length > 0)
+			csv.insert(csv.end(), line, line + (length < (int)sizeof(line) ? length : (int)sizeof(line) - 1));
+	}
+}
+
+//
+// Add
+//
+void LatencyHistogram::Add(uint64_t us)
+{
+	uint64_t bucket = us / kBucketUs;
+	buckets[bucket < kBuckets ? bucket : kBuckets - 1]++;
+	count++;
+	total_us += us;
+	if (us > max_us)
+		max_us = (uint32_t)us;
+}
+
+//
+// Percentile
+//
+uint32_t LatencyHistogram::Percentile(float fraction) const
+{
+	uint32_t target = (uint32_t)(count * fraction + 0.5f);
+	uint32_t seen = 0;
+	for (int i = 0; i < kBuckets; i++)
+	{
+		seen += buckets[i];
+		if (seen >= target && seen > 0)
+		{
+			// no bucket edge is reported past the longest time actually seen
+			uint32_t edge = (i + 1) * kBucketUs;
+			return edge < max_us ? edge : max_us;
+		}
+	}
+	return max_us;
+}
+
+//
+// FlipperLatency
+//
+FlipperLatency::FlipperLatency()
+{
+	memset(probes_, 0, sizeof(probes_));
+	memset(stages_, 0, sizeof(stages_));
+}
+
+//
+// Edge
+//
+void FlipperLatency::Edge(bool left, uint64_t time_us)
+{
+	Probe& probe = probes_[left ? 0 : 1];
+	probe.state = PROBE_EDGE;
+	probe.edge_us = time_us;
+}
+
+//
+// Stepped
+//
+void FlipperLatency::Stepped(uint64_t time_us)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (probes_[i].state == PROBE_EDGE)
+		{
+			probes_[i].state = PROBE_STEPPED;
+			probes_[i].step_us = time_us;
+		}
+	}
+}
+
+//
+// Moved
+//
+void FlipperLatency::Moved(bool left, uint64_t time_us)
+{
+	Probe& probe = probes_[left ? 0 : 1];
+	if (probe.state == PROBE_STEPPED)
+	{
+		probe.state = PROBE_MOVED;
+		probe.moved_us = time_us;
+	}
+}
+
+//
+// Rendered
+//
+void FlipperLatency::Rendered(uint64_t time_us)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		Probe& probe = probes_[i];
+		if (probe.state != PROBE_MOVED)
+			continue;
+
+		stages_[LATENCY_EDGE_TO_STEP].Add(probe.step_us - probe.edge_us);
+		stages_[LATENCY_STEP_TO_MOTION].Add(probe.moved_us - probe.step_us);
+		stages_[LATENCY_MOTION_TO_RENDER].Add(time_us - probe.moved_us);
+		stages_[LATENCY_TOTAL].Add(time_us - probe.edge_us);
+		probe.state = PROBE_IDLE;
+	}
+}
+
+//
+// Export
+//
+void FlipperLatency::Export(std::vector<unsigned char>& csv) const
+{
+	csv.clear();
+	AppendLine(csv, "stage,count,mean_ms,p50_ms,p99_ms,max_ms\n");
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+	{
+		const LatencyHistogram& stage = stages_[i];
+		AppendLine(csv, "%s,%u,%.3f,%.1f,%.1f,%.3f\n", kStageNames[i], stage.count,
+			stage.count ? stage.total_us / 1000.0 / stage.count : 0.0,
+			stage.Percentile(0.5f) / 1000.f, stage.Percentile(0.99f) / 1000.f, stage.max_us / 1000.f);
+	}
+
+	// one row per bucket up to the last one used by any stage
+	int last = 0;
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+	{
+		for (int bucket = 0; bucket < LatencyHistogram::kBuckets; bucket++)
+		{
+			if (stages_[i].buckets[bucket] && bucket > last)
+				last = bucket;
+		}
+	}
+
+	AppendLine(csv, "\nbucket_ms");
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+		AppendLine(csv, ",%s", kStageNames[i]);
+	AppendLine(csv, "\n");
+	for (int bucket = 0; bucket <= last; bucket++)
+	{
+		AppendLine(csv, "%.1f", (bucket + 1) * LatencyHistogram::kBucketUs / 1000.f);
+		for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+			AppendLine(csv, ",%u", stages_[i].buckets[bucket]);
+		AppendLine(csv, "\n");
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef _FLIPPER_LATENCY_H
+#define _FLIPPER_LATENCY_H
+
+#include <stdint.h>
+#include <vector>
+
+enum LATENCY_STAGE
+{
+	LATENCY_EDGE_TO_STEP,		// button change captured until the physics step that applies the motor
+	LATENCY_STEP_TO_MOTION,		// that step until the first frame the flipper has moved
+	LATENCY_MOTION_TO_RENDER,	// that frame until its Render returns
+	LATENCY_TOTAL,				// button change captured until Render returns
+	LATENCY_STAGE_COUNT
+};
+
+// Times in 0.5ms buckets, the last bucket takes anything longer.
+struct LatencyHistogram
+{
+	static const int kBuckets = 128;
+	static const uint32_t kBucketUs = 500;
+
+	uint32_t buckets[kBuckets];
+	uint32_t count;
+	uint64_t total_us;
+	uint32_t max_us;
+
+	void Add(uint64_t us);
+
+	/// @return The upper edge of the bucket holding the given fraction of times, at most max_us
+	uint32_t Percentile(float fraction) const;
+};
+
+// Follows each flipper button change through to the screen. The game reports the times it
+// sees each milestone, and a change that is followed all the way adds one time to every
+// stage. A new change to the same flipper before that restarts it.
+class FlipperLatency
+{
+public:
+	FlipperLatency();
+
+	/// @brief A flipper was driven up or down by a button change captured at time_us.
+	void Edge(bool left, uint64_t time_us);
+
+	/// @brief The physics step applying every change so far has started.
+	void Stepped(uint64_t time_us);
+
+	/// @brief The flipper has moved the way its motor is driving it since the last frame.
+	void Moved(bool left, uint64_t time_us);
+
+	/// @brief The frame showing every movement so far has been rendered.
+	void Rendered(uint64_t time_us);
+
+	/// @brief Formats each stage's summary and histogram as CSV, to be written off the main thread.
+	/// @param[out] csv		Replaced with the file contents.
+	void Export(std::vector<unsigned char>& csv) const;
+
+	inline const LatencyHistogram& histogram(LATENCY_STAGE stage) const { return stages_[stage]; }
+
+private:
+	enum PROBE_STATE { PROBE_IDLE, PROBE_EDGE, PROBE_STEPPED, PROBE_MOVED };
+
+	struct Probe
+	{
+		PROBE_STATE state;
+		uint64_t edge_us;
+		uint64_t step_us;
+		uint64_t moved_us;
+	};
+
+	// left, then right
+	Probe probes_[2];
+	LatencyHistogram stages_[LATENCY_STAGE_COUNT];
+};
+
+#endif // _FLIPPER_LATENCY_H
@@ -0,0 +1,103 @@
+#include "frame_graph.h"
+#include "profiler.h"
+
+//
+// FrameGraph
+//
+FrameGraph::FrameGraph() :
+	jobs_(NULL)
+{
+}
+
+//
+// ~FrameGraph
+//
+FrameGraph::~FrameGraph()
+{
+	for (size_t i = 0; i < stages_.size(); i++)
+		delete stages_[i];
+}
+
+//
+// AddStage
+//
+int FrameGraph::AddStage(const char* name, JobFunction function, void* data, bool main_thread)
+{
+	Stage* stage = new Stage;
+	stage->name = name;
+	stage->function = function;
+	stage->data = data;
+	stage->main_thread = main_thread;
+	stage->dependency_count = 0;
+	stage->remaining.store(0);
+	stage->graph = this;
+	stage->job.function = RunStage;
+	stage->job.data = stage;
+	stage->job.counter = NULL;
+	stage->job.next = NULL;
+
+	stages_.push_back(stage);
+	return (int)stages_.size() - 1;
+}
+
+//
+// AddDependency
+//
+void FrameGraph::AddDependency(int before, int after)
+{
+	stages_[before]->dependents.push_back(after);
+	stages_[after]->dependency_count++;
+}
+
+//
+// Execute
+//
+void FrameGraph::Execute(JobSystem& jobs)
+{
+	jobs_ = &jobs;
+
+	// every count is set before any stage starts counting them down
+	for (size_t i = 0; i < stages_.size(); i++)
+		stages_[i]->remaining.store(stages_[i]->dependency_count, std::memory_order_relaxed);
+
+	for (size_t i = 0; i < stages_.size(); i++)
+	{
+		if (stages_[i]->dependency_count == 0)
+			Launch(stages_[i]);
+	}
+
+	jobs.Wait(&counter_);
+}
+
+//
+// RunStage
+//
+void FrameGraph::RunStage(void* data)
+{
+	Stage* stage = (Stage*)data;
+	FrameGraph* graph = stage->graph;
+	{
+		PROFILE_SCOPE(stage->name);
+		stage->function(stage->data);
+	}
+
+	// dependents are launched before this stage's job counts as done, so the counter
+	// can't reach zero while any stage is still to start
+	for (size_t i = 0; i < stage->dependents.size(); i++)
+	{
+		Stage* dependent = graph->stages_[stage->dependents[i]];
+		if (dependent->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			graph->Launch(dependent);
+	}
+}
+
+//
+// Launch
+//
+void FrameGraph::Launch(Stage* stage)
+{
+	if (stage->main_thread)
+		jobs_->RunOnMain(&stage->job, &counter_);
+	else
+		jobs_->Run(&stage->job, &counter_);
+}
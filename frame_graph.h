@@ -0,0 +1,61 @@
+#ifndef _FRAME_GRAPH_H
+#define _FRAME_GRAPH_H
+
+#include "job_system.h"
+#include <atomic>
+#include <vector>
+
+// The work of one frame as stages and the order some of them must keep. Built once, then
+// executed each frame: stages with nothing before them start at once, and each stage left
+// starts the moment the last one it waits on finishes, on whichever thread finished it or
+// steals it. Stages flagged main thread only are run by the thread calling Execute.
+class FrameGraph
+{
+public:
+	FrameGraph();
+
+	/// @brief Default destructor.
+	~FrameGraph();
+
+	/// @return The stage's index, to order it against others
+	int AddStage(const char* name, JobFunction function, void* data, bool main_thread = false);
+
+	/// @brief Makes a stage wait until another has finished. The order must not loop back on itself.
+	void AddDependency(int before, int after);
+
+	/// @brief Runs every stage once and returns when all have finished.
+	void Execute(JobSystem& jobs);
+
+	inline int stage_count() const { return (int)stages_.size(); }
+	inline const char* stage_name(int stage) const { return stages_[stage]->name; }
+
+private:
+	struct Stage
+	{
+		const char* name;
+		JobFunction function;
+		void* data;
+		bool main_thread;
+
+		std::vector<int> dependents;
+		int dependency_count;
+
+		// stages still to finish before this one can start, counted down during Execute
+		std::atomic<int> remaining;
+
+		FrameGraph* graph;
+		Job job;
+	};
+
+	FrameGraph(const FrameGraph&);
+	FrameGraph& operator=(const FrameGraph&);
+
+	static void RunStage(void* data);
+	void Launch(Stage* stage);
+
+	std::vector<Stage*> stages_;
+	JobSystem* jobs_;
+	JobCounter counter_;
+};
+
+#endif // _FRAME_GRAPH_H
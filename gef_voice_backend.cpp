@@ -0,0 +1,95 @@
+#include "gef_voice_backend.h"
+#include <audio/audio_manager.h>
+#include <system/platform.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// assumed length when the file is not an Ogg Vorbis stream we can measure
+	const float kDefaultDuration = 1.f;
+
+	// Length of an Ogg Vorbis file from the sample rate in its identification header
+	// and the granule position of its last page
+	float OggDuration(const char* filename)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (!file)
+			return kDefaultDuration;
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		std::vector<unsigned char> data(size > 0 ? (size_t)size : 0);
+		bool read = !data.empty() && fread(&data[0], 1, data.size(), file) == data.size();
+		fclose(file);
+
+		if (!read || data.size() < 58 || memcmp(&data[0], "OggS", 4) != 0)
+			return kDefaultDuration;
+
+		size_t packet = 27 + data[26];
+		if (packet + 16 > data.size() || data[packet] != 1 || memcmp(&data[packet + 1], "vorbis", 6) != 0)
+			return kDefaultDuration;
+		const unsigned char* rate = &data[packet + 12];
+		unsigned int sampleRate = rate[0] | (rate[1] << 8) | (rate[2] << 16) | ((unsigned int)rate[3] << 24);
+
+		for (size_t page = data.size() - 14; page > 0; page--)
+		{
+			if (memcmp(&data[page], "OggS", 4) == 0)
+			{
+				unsigned long long granule = 0;
+				for (int i = 7; i >= 0; i--)
+					granule = (granule << 8) | data[page + 6 + i];
+				return sampleRate ? (float)((double)granule / sampleRate) : kDefaultDuration;
+			}
+		}
+		return kDefaultDuration;
+	}
+}
+
+//
+// GefVoiceBackend
+//
+GefVoiceBackend::GefVoiceBackend(gef::Platform& platform, gef::AudioManager* audio_manager) :
+	platform_(platform),
+	audio_manager_(audio_manager)
+{
+}
+
+//
+// LoadSample
+//
+int GefVoiceBackend::LoadSample(const char* filename, float& duration)
+{
+	int sample = audio_manager_->LoadSample(filename, platform_);
+	duration = OggDuration(filename);
+	return sample;
+}
+
+//
+// PlaySample
+//
+int GefVoiceBackend::PlaySample(int sample)
+{
+	return audio_manager_->PlaySample(sample);
+}
+
+//
+// StopVoice
+//
+void GefVoiceBackend::StopVoice(int voice)
+{
+	audio_manager_->StopPlayingSampleVoice(voice);
+}
+
+//
+// SetVoiceGain
+//
+void GefVoiceBackend::SetVoiceGain(int voice, float gain)
+{
+	gef::VolumeInfo vol;
+	audio_manager_->GetSampleVoiceVolumeInfo(voice, vol);
+	vol.volume = gain * 100.f;
+	audio_manager_->SetSampleVoiceVolumeInfo(voice, vol);
+}
@@ -0,0 +1,29 @@
+#ifndef _GEF_VOICE_BACKEND_H
+#define _GEF_VOICE_BACKEND_H
+
+#include "audio_mixer.h"
+
+// FRAMEWORK FORWARD DECLARATIONS
+namespace gef
+{
+	class Platform;
+	class AudioManager;
+}
+
+// Plays the mixer's compressed samples through gef's audio manager
+class GefVoiceBackend : public NativeVoiceBackend
+{
+public:
+	GefVoiceBackend(gef::Platform& platform, gef::AudioManager* audio_manager);
+
+	int LoadSample(const char* filename, float& duration);
+	int PlaySample(int sample);
+	void StopVoice(int voice);
+	void SetVoiceGain(int voice, float gain);
+
+private:
+	gef::Platform& platform_;
+	gef::AudioManager* audio_manager_;
+};
+
+#endif // _GEF_VOICE_BACKEND_H
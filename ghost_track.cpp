@@ -0,0 +1,276 @@
+#include "ghost_track.h"
+#include "varint.h"
+#include <zlib.h>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// a replay is a few KB a minute, anything this size is not one
+	const long kMaxReplayBytes = 4 * 1024 * 1024;
+
+	// inflate's state and window come from the arena and go back with it
+	voidpf ArenaAlloc(voidpf opaque, uInt items, uInt size)
+	{
+		return ((Arena*)opaque)->Allocate((size_t)items * size);
+	}
+
+	void ArenaFree(voidpf, voidpf)
+	{
+	}
+}
+
+//
+// GhostTrack
+//
+GhostTrack::GhostTrack() :
+	blocks_(NULL),
+	packed_(NULL),
+	raw_(NULL),
+	stream_(NULL),
+	block_(0),
+	raw_size_(0),
+	read_(0),
+	record_step_(0),
+	ball_count_(0),
+	ended_(true)
+{
+	memset(&header_, 0, sizeof(header_));
+	memset(&previous_, 0, sizeof(previous_));
+	memset(&next_, 0, sizeof(next_));
+}
+
+//
+// Open
+//
+bool GhostTrack::Open(const char* filename, Arena& arena)
+{
+	Close();
+
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	unsigned char* packed = NULL;
+	bool read = size >= (long)sizeof(ReplayHeader) && size <= kMaxReplayBytes;
+	if (read)
+	{
+		packed = arena.AllocateArray<unsigned char>((size_t)size);
+		read = packed && fread(packed, 1, (size_t)size, file) == (size_t)size;
+	}
+	fclose(file);
+
+	if (read)
+		memcpy(&header_, packed, sizeof(header_));
+	if (!read || header_.magic != kReplayMagic || header_.version != kReplayVersion || header_.block_count == 0 ||
+		sizeof(ReplayHeader) + (size_t)header_.block_count * sizeof(ReplayBlockEntry) > (size_t)size)
+	{
+		Close();
+		return false;
+	}
+
+	blocks_ = arena.AllocateArray<ReplayBlockEntry>(header_.block_count);
+	if (!blocks_)
+	{
+		Close();
+		return false;
+	}
+	memcpy(blocks_, packed + sizeof(ReplayHeader), header_.block_count * sizeof(ReplayBlockEntry));
+
+	// one buffer big enough for the largest block, reused for every block after
+	uint32_t largest = 0;
+	for (uint32_t i = 0; i < header_.block_count; i++)
+	{
+		if ((size_t)blocks_[i].offset + blocks_[i].packed_size > (size_t)size || blocks_[i].raw_size == 0 ||
+			blocks_[i].raw_size > kReplayMaxBlockBytes)
+		{
+			Close();
+			return false;
+		}
+		if (blocks_[i].raw_size > largest)
+			largest = blocks_[i].raw_size;
+	}
+	raw_ = arena.AllocateArray<unsigned char>(largest);
+
+	z_stream* stream = arena.AllocateArray<z_stream>(1);
+	if (!raw_ || !stream)
+	{
+		Close();
+		return false;
+	}
+	memset(stream, 0, sizeof(z_stream));
+	stream->zalloc = ArenaAlloc;
+	stream->zfree = ArenaFree;
+	stream->opaque = &arena;
+	if (inflateInit(stream) != Z_OK)
+	{
+		Close();
+		return false;
+	}
+	packed_ = packed;
+	stream_ = stream;
+
+	Restart();
+	return true;
+}
+
+//
+// Close
+//
+void GhostTrack::Close()
+{
+	// everything was allocated from the arena, there is nothing here to free
+	stream_ = NULL;
+	blocks_ = NULL;
+	packed_ = NULL;
+	raw_ = NULL;
+	memset(&header_, 0, sizeof(header_));
+	ended_ = true;
+}
+
+//
+// Update
+//
+unsigned int GhostTrack::Update(uint32_t step, ReplayBall* balls)
+{
+	if (!is_open() || step >= header_.step_count)
+		return 0;
+
+	if (step < previous_.step)
+		Restart();
+
+	while (!ended_ && next_.step < step)
+	{
+		previous_ = next_;
+		ended_ = !ReadSample(next_);
+	}
+
+	// blend when the two samples hold the same balls, otherwise show whichever is current
+	const Sample& from = previous_;
+	const Sample& to = ended_ || next_.step > step ? previous_ : next_;
+	bool blend = !ended_ && next_.step > step && next_.step > previous_.step && next_.count == previous_.count && step > previous_.step;
+	float t = blend ? (float)(step - previous_.step) / (float)(next_.step - previous_.step) : 0.f;
+
+	for (unsigned int i = 0; i < to.count; i++)
+	{
+		const int32_t* a = blend ? &from.quantised[i * 3] : &to.quantised[i * 3];
+		const int32_t* b = blend ? &next_.quantised[i * 3] : a;
+		balls[i].x = (a[0] + (b[0] - a[0]) * t) / kReplayPositionScale;
+		balls[i].y = (a[1] + (b[1] - a[1]) * t) / kReplayPositionScale;
+		balls[i].angle = (a[2] + (b[2] - a[2]) * t) / kReplayAngleScale;
+	}
+	return to.count;
+}
+
+//
+// Restart
+//
+void GhostTrack::Restart()
+{
+	ball_count_ = 0;
+	memset(&previous_, 0, sizeof(previous_));
+	memset(&next_, 0, sizeof(next_));
+
+	ended_ = !InflateBlock(0) || !ReadSample(next_);
+	previous_ = next_;
+}
+
+//
+// InflateBlock
+//
+bool GhostTrack::InflateBlock(unsigned int block)
+{
+	const ReplayBlockEntry& entry = blocks_[block];
+	raw_size_ = 0;
+	read_ = 0;
+
+	if (entry.packed_size == entry.raw_size)
+	{
+		memcpy(&raw_[0], &packed_[entry.offset], entry.raw_size);
+	}
+	else
+	{
+		// reset keeps the window from the first block, so this allocates nothing
+		z_stream* stream = (z_stream*)stream_;
+		inflateReset(stream);
+		stream->next_in = (Bytef*)&packed_[entry.offset];
+		stream->avail_in = entry.packed_size;
+		stream->next_out = &raw_[0];
+		stream->avail_out = entry.raw_size;
+		if (inflate(stream, Z_FINISH) != Z_STREAM_END || stream->total_out != entry.raw_size)
+			return false;
+	}
+
+	block_ = block;
+	raw_size_ = entry.raw_size;
+	record_step_ = entry.first_step;
+	return true;
+}
+
+//
+// ReadSample
+//
+bool GhostTrack::ReadSample(Sample& sample)
+{
+	for (;;)
+	{
+		if (read_ >= raw_size_)
+		{
+			// the next block opens with a repeat of this block's last sample
+			if (block_ + 1 >= header_.block_count || !InflateBlock(block_ + 1))
+				return false;
+			continue;
+		}
+
+		const unsigned char* read = &raw_[read_];
+		const unsigned char* end = &raw_[0] + raw_size_;
+		uint32_t tag, value;
+		if (!ReadVarint(read, end, tag))
+			return false;
+		record_step_ += tag >> 2;
+
+		switch (tag & 3)
+		{
+		case REPLAY_INPUT:
+			// ghosts have no flippers of their own
+			if (read >= end)
+				return false;
+			read++;
+			read_ = read - &raw_[0];
+			continue;
+		case REPLAY_KEYFRAME:
+			if (read >= end)
+				return false;
+			read++;
+			if (!ReadVarint(read, end, ball_count_) || ball_count_ > kReplayMaxBalls)
+				return false;
+			for (unsigned int i = 0; i < ball_count_ * 3; i++)
+			{
+				if (!ReadVarint(read, end, value))
+					return false;
+				current_[i] = UnZigZag(value);
+			}
+			break;
+		case REPLAY_DELTA:
+			for (unsigned int i = 0; i < ball_count_ * 3; i++)
+			{
+				if (!ReadVarint(read, end, value))
+					return false;
+				current_[i] += UnZigZag(value);
+			}
+			break;
+		default:
+			return false;
+		}
+
+		read_ = read - &raw_[0];
+		sample.step = record_step_;
+		sample.count = ball_count_ < kMaxBalls ? ball_count_ : kMaxBalls;
+		memcpy(sample.quantised, current_, sample.count * 3 * sizeof(int32_t));
+		return true;
+	}
+}
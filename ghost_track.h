@@ -0,0 +1,76 @@
+#ifndef _GHOST_TRACK_H
+#define _GHOST_TRACK_H
+
+#include "replay.h"
+#include "arena.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Plays the balls of a recorded replay back as ghosts. Everything is sized when the replay is
+// opened; after that the track inflates one block at a time into the same buffer and reads
+// samples forward from it as play advances, so following a ghost never allocates and only
+// ever holds the two samples either side of the current step. The file, the buffer and the
+// inflate state all come from the arena given to Open, so a track has nothing of its own to
+// free and must be closed before that arena is reset.
+class GhostTrack
+{
+public:
+	GhostTrack();
+
+	/// @brief Reads a replay to play back.
+	/// @return false if the file is missing or damaged
+	/// @param[in] arena		Holds the replay until the track is closed.
+	bool Open(const char* filename, Arena& arena);
+
+	/// @brief Forgets the replay, its memory goes back with the arena.
+	void Close();
+
+	/// @brief Gets the ghost balls at a step. Steps normally only move forward, going back restarts the replay.
+	/// @return The number of balls written, 0 once the replay has ended
+	/// @param[in] step			The step of the live game.
+	/// @param[out] balls		Receives up to kMaxBalls transforms.
+	unsigned int Update(uint32_t step, ReplayBall* balls);
+
+	inline bool is_open() const { return stream_ != NULL; }
+
+	inline const ReplayHeader& header() const { return header_; }
+
+	// balls followed at once, any more in the replay are not drawn
+	static const unsigned int kMaxBalls = 8;
+
+private:
+	struct Sample
+	{
+		uint32_t step;
+		unsigned int count;
+		int32_t quantised[kMaxBalls * 3];
+	};
+
+	GhostTrack(const GhostTrack&);
+	GhostTrack& operator=(const GhostTrack&);
+
+	void Restart();
+	bool InflateBlock(unsigned int block);
+	bool ReadSample(Sample& sample);
+
+	ReplayHeader header_;
+	ReplayBlockEntry* blocks_;
+	const unsigned char* packed_;
+	unsigned char* raw_;
+
+	// the zlib inflate state, kept for the life of the replay so each block only resets it
+	void* stream_;
+
+	unsigned int block_;
+	size_t raw_size_;
+	size_t read_;
+	uint32_t record_step_;
+	uint32_t ball_count_;
+	int32_t current_[kReplayMaxBalls * 3];
+
+	Sample previous_;
+	Sample next_;
+	bool ended_;
+};
+
+#endif // _GHOST_TRACK_H
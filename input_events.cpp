@@ -0,0 +1,70 @@
+#include "input_events.h"
+#include <chrono>
+
+//
+// InputEventQueue
+//
+InputEventQueue::InputEventQueue() :
+	head_(0),
+	tail_(0),
+	buttons_(0),
+	dropped_(0)
+{
+}
+
+//
+// Capture
+//
+void InputEventQueue::Capture(uint32_t buttons_down, uint64_t time_us)
+{
+	uint32_t changed = buttons_down ^ buttons_;
+	buttons_ = buttons_down;
+
+	// lowest bit first, so buttons changing together always queue in the same order
+	while (changed)
+	{
+		uint32_t button = changed & (~changed + 1);
+		changed &= ~button;
+
+		if (tail_ - head_ == kCapacity)
+		{
+			dropped_++;
+			continue;
+		}
+
+		InputEvent& event = events_[tail_ % kCapacity];
+		event.button = button;
+		event.down = (buttons_down & button) != 0;
+		event.time_us = time_us;
+		tail_++;
+	}
+}
+
+//
+// Pop
+//
+bool InputEventQueue::Pop(InputEvent& event)
+{
+	if (head_ == tail_)
+		return false;
+
+	event = events_[head_ % kCapacity];
+	head_++;
+	return true;
+}
+
+//
+// Discard
+//
+void InputEventQueue::Discard()
+{
+	head_ = tail_;
+}
+
+//
+// Now
+//
+uint64_t InputEventQueue::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
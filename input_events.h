@@ -0,0 +1,56 @@
+#ifndef _INPUT_EVENTS_H
+#define _INPUT_EVENTS_H
+
+#include <stdint.h>
+
+// One button going down or up.
+struct InputEvent
+{
+	// a single gef_SONY_CTRL_ bit
+	uint32_t button;
+	bool down;
+
+	// when the change was captured, see InputEventQueue::Now
+	uint64_t time_us;
+};
+
+// Button changes found by comparing whole masks rather than matching values, so buttons
+// that change in the same poll are each seen. Queued in the order they were captured
+// until the game takes them.
+class InputEventQueue
+{
+public:
+	InputEventQueue();
+
+	/// @brief Queues an event for every button that differs from the last capture.
+	/// @param[in] buttons_down	Mask of the buttons held now.
+	/// @param[in] time_us		When the mask was read.
+	void Capture(uint32_t buttons_down, uint64_t time_us);
+
+	/// @brief Removes the oldest event.
+	/// @return false if there are no events
+	bool Pop(InputEvent& event);
+
+	/// @brief Drops every queued event. Buttons already held stay held and are not seen again until released.
+	void Discard();
+
+	/// @brief Get the mask of the buttons held at the last capture.
+	inline uint32_t buttons() const { return buttons_; }
+
+	/// @brief Get the number of events lost because the queue was full.
+	inline unsigned int dropped() const { return dropped_; }
+
+	/// @return Microseconds on the steady clock
+	static uint64_t Now();
+
+	static const unsigned int kCapacity = 64;
+
+private:
+	InputEvent events_[kCapacity];
+	unsigned int head_;
+	unsigned int tail_;
+	uint32_t buttons_;
+	unsigned int dropped_;
+};
+
+#endif // _INPUT_EVENTS_H
@@ -0,0 +1,277 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "job_system.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
+#include <stdio.h>
+
+namespace
+{
+	// rounds a worker with nothing to do yields for before it sleeps
+	const int kSpinRounds = 64;
+
+	// which system, and which of its deques, the running thread belongs to
+	thread_local JobSystem* thread_system = NULL;
+	thread_local unsigned int thread_index = 0;
+}
+
+//
+// WorkDeque
+//
+JobSystem::WorkDeque::WorkDeque() :
+	top_(0),
+	bottom_(0)
+{
+	for (int64_t i = 0; i < kCapacity; i++)
+		jobs_[i].store(NULL, std::memory_order_relaxed);
+}
+
+//
+// Push
+//
+bool JobSystem::WorkDeque::Push(Job* job)
+{
+	// owner only
+	int64_t bottom = bottom_.load(std::memory_order_relaxed);
+	int64_t top = top_.load(std::memory_order_acquire);
+	if (bottom - top >= kCapacity)
+		return false;
+
+	jobs_[bottom & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+	bottom_.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+
+//
+// Pop
+//
+Job* JobSystem::WorkDeque::Pop()
+{
+	// owner only, races thieves for the last job
+	int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(bottom, std::memory_order_seq_cst);
+	int64_t top = top_.load(std::memory_order_seq_cst);
+
+	if (top > bottom)
+	{
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	Job* job = jobs_[bottom & (kCapacity - 1)].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = NULL;
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+//
+// Steal
+//
+Job* JobSystem::WorkDeque::Steal()
+{
+	int64_t top = top_.load(std::memory_order_seq_cst);
+	int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+	if (top >= bottom)
+		return NULL;
+
+	Job* job = jobs_[top & (kCapacity - 1)].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return NULL;
+	return job;
+}
+
+//
+// JobSystem
+//
+JobSystem::JobSystem(unsigned int worker_count) :
+	main_jobs_(NULL),
+	quit_(false),
+	sleeping_(0),
+	pushes_(0),
+	steals_(0),
+	runs_(0)
+{
+	thread_system = this;
+	thread_index = 0;
+
+	for (unsigned int i = 0; i <= worker_count; i++)
+		deques_.push_back(new WorkDeque);
+	for (unsigned int i = 1; i <= worker_count; i++)
+		threads_.push_back(std::thread(&JobSystem::WorkerThread, this, i));
+}
+
+//
+// ~JobSystem
+//
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		quit_.store(true);
+	}
+	wake_.notify_all();
+	for (size_t i = 0; i < threads_.size(); i++)
+		threads_[i].join();
+
+	for (size_t i = 0; i < deques_.size(); i++)
+		delete deques_[i];
+
+	if (thread_system == this)
+		thread_system = NULL;
+}
+
+//
+// Run
+//
+void JobSystem::Run(Job* job, JobCounter* counter)
+{
+	job->counter = counter;
+	job->next = NULL;
+	if (counter)
+		counter->count_.fetch_add(1, std::memory_order_relaxed);
+
+	if (thread_system != this || !deques_[thread_index]->Push(job))
+	{
+		Execute(job);
+		return;
+	}
+	Wake();
+}
+
+//
+// RunOnMain
+//
+void JobSystem::RunOnMain(Job* job, JobCounter* counter)
+{
+	job->counter = counter;
+	if (counter)
+		counter->count_.fetch_add(1, std::memory_order_relaxed);
+
+	// thread 0 is busy with the frame, or waiting in Wait where it looks here, so no wake is needed
+	Job* head = main_jobs_.load(std::memory_order_relaxed);
+	do
+	{
+		job->next = head;
+	} while (!main_jobs_.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//
+// Wait
+//
+void JobSystem::Wait(const JobCounter* counter)
+{
+	bool member = thread_system == this;
+	while (!counter->done())
+	{
+		if (!member || !RunOne(thread_index))
+			std::this_thread::yield();
+	}
+}
+
+//
+// WorkerThread
+//
+void JobSystem::WorkerThread(unsigned int index)
+{
+	thread_system = this;
+	thread_index = index;
+
+	char name[32];
+	sprintf(name, "job worker %u", index);
+	Profiler::SetThreadName(name);
+
+	// workers only run frame stages, so what they allocate counts against the frame
+	AllocTracker::SetFrameThread();
+
+	int idle = 0;
+	while (!quit_.load(std::memory_order_relaxed))
+	{
+		// read before looking, so a job pushed after the deques were found empty is seen below
+		uint64_t pushes = pushes_.load(std::memory_order_seq_cst);
+		if (RunOne(index))
+		{
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < kSpinRounds)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// sleeping_ goes up before pushes_ is looked at again, and Wake bumps pushes_ before
+		// it looks at sleeping_, so either this sees the push or Wake sees the sleeper
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		sleeping_.fetch_add(1, std::memory_order_seq_cst);
+		wake_.wait(lock, [this, pushes]
+		{
+			return quit_.load(std::memory_order_relaxed) || pushes_.load(std::memory_order_seq_cst) != pushes;
+		});
+		sleeping_.fetch_sub(1, std::memory_order_relaxed);
+		idle = 0;
+	}
+}
+
+//
+// RunOne
+//
+bool JobSystem::RunOne(unsigned int index)
+{
+	Job* job = deques_[index]->Pop();
+
+	// only thread 0 pops the main thread jobs, so a job can't be taken and pushed again under it
+	if (!job && index == 0)
+	{
+		job = main_jobs_.load(std::memory_order_acquire);
+		while (job && !main_jobs_.compare_exchange_weak(job, job->next, std::memory_order_acquire, std::memory_order_acquire))
+			;
+	}
+
+	// steal from the next thread along first, so thieves spread out
+	unsigned int count = (unsigned int)deques_.size();
+	for (unsigned int i = 1; !job && i < count; i++)
+	{
+		job = deques_[(index + i) % count]->Steal();
+		if (job)
+			steals_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (!job)
+		return false;
+
+	Execute(job);
+	return true;
+}
+
+//
+// Execute
+//
+void JobSystem::Execute(Job* job)
+{
+	// the counter may be all that keeps the job alive, so it is the last thing touched
+	JobCounter* counter = job->counter;
+	job->function(job->data);
+	runs_.fetch_add(1, std::memory_order_relaxed);
+	if (counter)
+		counter->count_.fetch_sub(1, std::memory_order_release);
+}
+
+//
+// Wake
+//
+void JobSystem::Wake()
+{
+	pushes_.fetch_add(1, std::memory_order_seq_cst);
+	if (sleeping_.load(std::memory_order_seq_cst) > 0)
+	{
+		// taking the lock means a sleeper is either waiting already or yet to test pushes_
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+		}
+		wake_.notify_one();
+	}
+}
@@ -0,0 +1,118 @@
+#ifndef _JOB_SYSTEM_H
+#define _JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+typedef void (*JobFunction)(void* data);
+
+// Jobs still to finish. Running a job only ever decrements it, so finishing never waits, and
+// anyone after the result calls JobSystem::Wait, which runs other jobs until it reaches zero.
+class JobCounter
+{
+public:
+	JobCounter() : count_(0) {}
+
+	inline bool done() const { return count_.load(std::memory_order_acquire) == 0; }
+
+private:
+	JobCounter(const JobCounter&);
+	JobCounter& operator=(const JobCounter&);
+
+	std::atomic<int> count_;
+
+	friend class JobSystem;
+};
+
+// A unit of work. Owned by whoever runs it, and must stay alive until its counter says it has finished.
+struct Job
+{
+	JobFunction function;
+	void* data;
+
+	// set by the job system
+	JobCounter* counter;
+	Job* next;
+};
+
+// Work-stealing scheduler. Every thread taking part, the one that made the system included,
+// has a deque of its own that it pushes and pops at one end without locking; a thread with
+// nothing left steals from the other end of someone else's. Workers with nothing to steal
+// spin briefly and then block until more work is queued or the system is destroyed.
+class JobSystem
+{
+public:
+	/// @param[in] worker_count	Threads made besides the calling one, which becomes thread 0.
+	explicit JobSystem(unsigned int worker_count);
+
+	/// @brief Default destructor. Stops the workers, anything still queued is not run.
+	~JobSystem();
+
+	/// @brief Queues a job on the calling thread's deque.
+	/// Called from a thread outside the system, or with the deque full, the job runs at once instead.
+	void Run(Job* job, JobCounter* counter);
+
+	/// @brief Queues a job that only thread 0 runs. Can be called from any thread.
+	void RunOnMain(Job* job, JobCounter* counter);
+
+	/// @brief Runs queued jobs until the counter reaches zero.
+	void Wait(const JobCounter* counter);
+
+	/// @brief Get the number of threads taking part, thread 0 included.
+	inline unsigned int thread_count() const { return (unsigned int)deques_.size(); }
+
+	/// @brief Get the number of jobs taken from another thread's deque.
+	inline uint64_t steal_count() const { return steals_.load(std::memory_order_relaxed); }
+
+	/// @brief Get the number of jobs run.
+	inline uint64_t run_count() const { return runs_.load(std::memory_order_relaxed); }
+
+private:
+	// Chase-Lev deque of fixed size. The owner pushes and pops the bottom, thieves take the top.
+	class WorkDeque
+	{
+	public:
+		WorkDeque();
+		bool Push(Job* job);
+		Job* Pop();
+		Job* Steal();
+
+		static const int64_t kCapacity = 1024;
+
+	private:
+		std::atomic<int64_t> top_;
+		std::atomic<int64_t> bottom_;
+		std::atomic<Job*> jobs_[kCapacity];
+	};
+
+	JobSystem(const JobSystem&);
+	JobSystem& operator=(const JobSystem&);
+
+	void WorkerThread(unsigned int index);
+	bool RunOne(unsigned int index);
+	void Execute(Job* job);
+	void Wake();
+
+	std::vector<WorkDeque*> deques_;
+	std::vector<std::thread> threads_;
+
+	// jobs for thread 0 only, a stack any thread pushes and only thread 0 pops
+	std::atomic<Job*> main_jobs_;
+
+	std::atomic<bool> quit_;
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	std::atomic<int> sleeping_;
+
+	// counts every push, a worker sleeps only while it has not changed since it last looked for work
+	std::atomic<uint64_t> pushes_;
+
+	std::atomic<uint64_t> steals_;
+	std::atomic<uint64_t> runs_;
+};
+
+#endif // _JOB_SYSTEM_H
@@ -0,0 +1,274 @@
+#include "leaderboard.h"
+#include <cstring>
+
+namespace
+{
+	// a quarter of the nodes reach each next level, so 16 levels cover 4 billion entries
+	const int kMaxLevel = 16;
+	const uint32_t kNil = 0xffffffff;
+}
+
+//
+// Leaderboard
+//
+Leaderboard::Leaderboard()
+{
+	Clear();
+}
+
+//
+// Clear
+//
+void Leaderboard::Clear()
+{
+	entries_.clear();
+	link_start_.clear();
+	next_.clear();
+	span_.clear();
+
+	LeaderboardEntry head;
+	memset(&head, 0, sizeof(head));
+	AddNode(head, kMaxLevel);
+
+	level_ = 1;
+	size_ = 0;
+	next_sequence_ = 0;
+	random_ = 0x9e3779b9;
+}
+
+//
+// Insert
+//
+unsigned int Leaderboard::Insert(const char* name, unsigned int score)
+{
+	LeaderboardEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	strncpy(entry.name, name, sizeof(entry.name) - 1);
+	entry.score = score;
+	entry.sequence = next_sequence_;
+	return Insert(entry);
+}
+
+//
+// Insert
+//
+unsigned int Leaderboard::Insert(const LeaderboardEntry& entry)
+{
+	uint32_t update[kMaxLevel];
+	unsigned int rank[kMaxLevel];
+
+	// find the last node ranked before the entry on every level
+	uint32_t node = 0;
+	for (int level = level_ - 1; level >= 0; level--)
+	{
+		rank[level] = level == level_ - 1 ? 0 : rank[level + 1];
+		while (next(node, level) != kNil && RanksBefore(entries_[next(node, level)], entry))
+		{
+			rank[level] += span(node, level);
+			node = next(node, level);
+		}
+		update[level] = node;
+	}
+
+	int levels = RandomLevel();
+	if (levels > level_)
+	{
+		for (int level = level_; level < levels; level++)
+		{
+			rank[level] = 0;
+			update[level] = 0;
+			span(0, level) = size_;
+		}
+		level_ = levels;
+	}
+
+	uint32_t added = AddNode(entry, levels);
+	for (int level = 0; level < levels; level++)
+	{
+		next(added, level) = next(update[level], level);
+		next(update[level], level) = added;
+		span(added, level) = span(update[level], level) - (rank[0] - rank[level]);
+		span(update[level], level) = rank[0] - rank[level] + 1;
+	}
+	for (int level = levels; level < level_; level++)
+	{
+		span(update[level], level)++;
+	}
+
+	size_++;
+	if (entry.sequence >= next_sequence_)
+		next_sequence_ = entry.sequence + 1;
+	return rank[0];
+}
+
+//
+// BuildSorted
+//
+void Leaderboard::BuildSorted(const LeaderboardEntry* entries, unsigned int count)
+{
+	Clear();
+
+	// lay every array out once rather than growing it node by node
+	entries_.resize(count + 1);
+	link_start_.resize(count + 1);
+	memcpy(&entries_[1], entries, count * sizeof(LeaderboardEntry));
+
+	uint32_t links = kMaxLevel;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		link_start_[i + 1] = links;
+		links += SortedLevel(i);
+	}
+	next_.resize(links);
+	span_.resize(links);
+
+	uint32_t last[kMaxLevel];
+	unsigned int lastRank[kMaxLevel];
+	for (int level = 0; level < kMaxLevel; level++)
+	{
+		last[level] = 0;
+		lastRank[level] = 0;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		uint32_t added = i + 1;
+		int levels = SortedLevel(i);
+		if (levels > level_)
+			level_ = levels;
+
+		for (int level = 0; level < levels; level++)
+		{
+			next(last[level], level) = added;
+			span(last[level], level) = i + 1 - lastRank[level];
+			last[level] = added;
+			lastRank[level] = i + 1;
+		}
+
+		if (entries[i].sequence >= next_sequence_)
+			next_sequence_ = entries[i].sequence + 1;
+	}
+
+	for (int level = 0; level < level_; level++)
+	{
+		next(last[level], level) = kNil;
+		span(last[level], level) = count - lastRank[level];
+	}
+	size_ = count;
+}
+
+//
+// ReserveSequences
+//
+void Leaderboard::ReserveSequences(uint32_t next_sequence)
+{
+	if (next_sequence > next_sequence_)
+		next_sequence_ = next_sequence;
+}
+
+//
+// RankForScore
+//
+unsigned int Leaderboard::RankForScore(unsigned int score) const
+{
+	unsigned int rank = 0;
+	uint32_t node = 0;
+	for (int level = level_ - 1; level >= 0; level--)
+	{
+		while (next(node, level) != kNil && entries_[next(node, level)].score >= score)
+		{
+			rank += span(node, level);
+			node = next(node, level);
+		}
+	}
+	return rank;
+}
+
+//
+// GetRange
+//
+unsigned int Leaderboard::GetRange(unsigned int first, unsigned int count, std::vector<LeaderboardEntry>& entries) const
+{
+	entries.clear();
+	if (first >= size_)
+		return 0;
+
+	for (uint32_t node = NodeAtRank(first); node != kNil && entries.size() < count; node = next(node, 0))
+	{
+		entries.push_back(entries_[node]);
+	}
+	return (unsigned int)entries.size();
+}
+
+//
+// NodeAtRank
+//
+uint32_t Leaderboard::NodeAtRank(unsigned int rank) const
+{
+	// spans count from the head, which sits before rank 0
+	unsigned int traversed = 0;
+	uint32_t node = 0;
+	for (int level = level_ - 1; level >= 0; level--)
+	{
+		while (next(node, level) != kNil && traversed + span(node, level) <= rank + 1)
+		{
+			traversed += span(node, level);
+			node = next(node, level);
+		}
+		if (traversed == rank + 1)
+			return node;
+	}
+	return kNil;
+}
+
+//
+// AddNode
+//
+uint32_t Leaderboard::AddNode(const LeaderboardEntry& entry, int levels)
+{
+	uint32_t node = (uint32_t)entries_.size();
+	entries_.push_back(entry);
+	link_start_.push_back((uint32_t)next_.size());
+	next_.insert(next_.end(), levels, kNil);
+	span_.insert(span_.end(), levels, 0);
+	return node;
+}
+
+//
+// SortedLevel
+//
+// Gives every 4th node a second level, every 16th a third and so on, which is the
+// shape the random levels average out to
+//
+int Leaderboard::SortedLevel(unsigned int index)
+{
+	int levels = 1;
+	for (unsigned int position = index + 1; (position & 3) == 0 && levels < kMaxLevel; position >>= 2)
+		levels++;
+	return levels;
+}
+
+//
+// RandomLevel
+//
+// Each level is a quarter as likely as the one below
+//
+int Leaderboard::RandomLevel()
+{
+	random_ ^= random_ << 13;
+	random_ ^= random_ >> 17;
+	random_ ^= random_ << 5;
+
+	int levels = 1;
+	for (uint32_t bits = random_; (bits & 3) == 0 && levels < kMaxLevel; bits >>= 2)
+		levels++;
+	return levels;
+}
+
+//
+// RanksBefore
+//
+bool Leaderboard::RanksBefore(const LeaderboardEntry& a, const LeaderboardEntry& b)
+{
+	return a.score > b.score || (a.score == b.score && a.sequence < b.sequence);
+}
@@ -0,0 +1,88 @@
+#ifndef _LEADERBOARD_H
+#define _LEADERBOARD_H
+
+#include <stdint.h>
+#include <vector>
+
+struct LeaderboardEntry
+{
+	char name[12];
+	uint32_t score;
+	// order the entry was made in, earlier entries rank above later equal scores
+	uint32_t sequence;
+};
+
+// Every score ever recorded, ranked highest first in an indexed skip list, so inserting,
+// finding the rank of a score and reading any run of ranks are all O(log n).
+class Leaderboard
+{
+public:
+	Leaderboard();
+
+	/// @brief Removes every entry.
+	void Clear();
+
+	/// @brief Records a new score.
+	/// @return The 0 based rank the score was placed at
+	/// @param[in] name			The player's initials, truncated to fit.
+	/// @param[in] score		The score.
+	unsigned int Insert(const char* name, unsigned int score);
+
+	/// @brief Records an entry that already has a sequence number, such as one read back from disk.
+	/// @return The 0 based rank the entry was placed at
+	unsigned int Insert(const LeaderboardEntry& entry);
+
+	/// @brief Replaces the contents with entries already in rank order, in O(n).
+	/// @param[in] entries		The entries, highest rank first.
+	/// @param[in] count		The number of entries.
+	void BuildSorted(const LeaderboardEntry* entries, unsigned int count);
+
+	/// @brief Get the rank a new score would be placed at.
+	/// @return The number of entries scoring at least as much
+	unsigned int RankForScore(unsigned int score) const;
+
+	/// @brief Reads a run of consecutive ranks.
+	/// @return The number of entries read, fewer than count past the end of the table
+	/// @param[in] first		The 0 based rank to start at.
+	/// @param[in] count		The maximum number of entries to read.
+	/// @param[out] entries		Replaced with the entries read.
+	unsigned int GetRange(unsigned int first, unsigned int count, std::vector<LeaderboardEntry>& entries) const;
+
+	/// @brief Get the number of entries.
+	inline unsigned int size() const { return size_; }
+
+	/// @brief Get the sequence number the next Insert will use.
+	inline uint32_t next_sequence() const { return next_sequence_; }
+
+	/// @brief Raises the sequence number the next Insert will use, never lowering it.
+	/// @param[in] next_sequence	Sequence numbers below this are taken, even by entries no longer held.
+	void ReserveSequences(uint32_t next_sequence);
+
+private:
+	// node links live in two flat arrays, node i owning one slot per level it reaches from
+	// link_start_[i] up to where the next node's slots start
+	inline uint32_t& next(uint32_t node, int level) { return next_[link_start_[node] + level]; }
+	inline uint32_t next(uint32_t node, int level) const { return next_[link_start_[node] + level]; }
+	inline uint32_t& span(uint32_t node, int level) { return span_[link_start_[node] + level]; }
+	inline uint32_t span(uint32_t node, int level) const { return span_[link_start_[node] + level]; }
+
+	uint32_t AddNode(const LeaderboardEntry& entry, int levels);
+	uint32_t NodeAtRank(unsigned int rank) const;
+	int RandomLevel();
+	static int SortedLevel(unsigned int index);
+
+	static bool RanksBefore(const LeaderboardEntry& a, const LeaderboardEntry& b);
+
+	// node 0 is the head and its entry is unused
+	std::vector<LeaderboardEntry> entries_;
+	std::vector<uint32_t> link_start_;
+	std::vector<uint32_t> next_;
+	std::vector<uint32_t> span_;
+
+	int level_;
+	unsigned int size_;
+	uint32_t next_sequence_;
+	uint32_t random_;
+};
+
+#endif // _LEADERBOARD_H
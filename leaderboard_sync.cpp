@@ -0,0 +1,360 @@
+#include "leaderboard_sync.h"
+#include "leaderboard_sync_format.h"
+#include "net_socket.h"
+#include "profiler.h"
+#include "varint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// connecting and each send or receive, long enough for a busy venue network
+	const int kNetworkTimeoutMs = 2000;
+
+	// how long a batch waits for more entries to join it
+	const int kBatchDelayMs = 2000;
+
+	const unsigned int kInitialBackoffMs = 1000;
+	const unsigned int kMaxBackoffMs = 60000;
+
+	// [SpoolHeader][the batch being sent][the entries waiting], all as LeaderboardEntry
+	struct SpoolHeader
+	{
+		uint32_t magic;
+		// the batch keeps its session and number, so a resend of one the server did get is recognised
+		uint32_t session;
+		uint32_t batch;
+		uint32_t batch_count;
+		uint32_t pending_count;
+		// FNV-1a of the entries
+		uint32_t check;
+	};
+	const uint32_t kSpoolMagic = 0x3150424c;	// "LBP1"
+}
+
+//
+// LeaderboardSync
+//
+LeaderboardSync::LeaderboardSync(const char* host, unsigned short port, uint32_t table_id, const char* spool_filename) :
+	host_(host),
+	spool_filename_(spool_filename ? spool_filename : ""),
+	port_(port),
+	table_id_(table_id),
+	session_(0),
+	batch_number_(1),
+	quit_(false),
+	sent_entries_(0),
+	failed_attempts_(0),
+	dropped_entries_(0)
+{
+	// tables switched on together must still pick different sessions and retry times
+	uint64_t seed = (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	random_ = (uint32_t)(seed ^ (seed >> 32)) ^ (table_id * 2654435761u);
+	session_ = Jitter(0xffffffff) | 1;
+	ReadSpool();
+
+	thread_ = std::thread(&LeaderboardSync::SyncThread, this);
+}
+
+//
+// ~LeaderboardSync
+//
+LeaderboardSync::~LeaderboardSync()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	condition_.notify_all();
+	thread_.join();
+
+	WriteSpool();
+}
+
+//
+// CreateFromConfig
+//
+LeaderboardSync* LeaderboardSync::CreateFromConfig(const char* filename, const char* spool_filename)
+{
+	FILE* file = fopen(filename, "r");
+	if (!file)
+		return NULL;
+
+	char host[256];
+	unsigned int port = 0, tableId = 0;
+	bool valid = fscanf(file, "%255s %u %u", host, &port, &tableId) == 3 && port > 0 && port < 65536;
+	fclose(file);
+
+	return valid ? new LeaderboardSync(host, (unsigned short)port, tableId, spool_filename) : NULL;
+}
+
+//
+// Queue
+//
+void LeaderboardSync::Queue(const LeaderboardEntry& entry)
+{
+	bool wake;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (pending_.size() >= kMaxPendingEntries)
+		{
+			pending_.pop_front();
+			dropped_entries_++;
+		}
+		pending_.push_back(entry);
+
+		// the thread only waits on the first entry of a batch or for a batch to fill
+		wake = pending_.size() == 1 || pending_.size() == kMaxBatchEntries;
+	}
+	if (wake)
+		condition_.notify_all();
+}
+
+//
+// pending_entries
+//
+unsigned int LeaderboardSync::pending_entries()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return (unsigned int)(pending_.size() + batch_.size());
+}
+
+//
+// PackEntries
+//
+void LeaderboardSync::PackEntries(const std::vector<LeaderboardEntry>& entries, std::vector<unsigned char>& payload)
+{
+	payload.clear();
+	uint32_t previous = 0;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const LeaderboardEntry& entry = entries[i];
+		// sequences normally climb by one, but restart when the table is reset
+		WriteVarint(payload, ZigZag((int32_t)(entry.sequence - previous)));
+		WriteVarint(payload, entry.score);
+		previous = entry.sequence;
+
+		const char* nul = (const char*)memchr(entry.name, 0, sizeof(entry.name));
+		size_t length = nul ? (size_t)(nul - entry.name) : sizeof(entry.name) - 1;
+		payload.push_back((unsigned char)length);
+		payload.insert(payload.end(), entry.name, entry.name + length);
+	}
+}
+
+//
+// UnpackEntries
+//
+bool LeaderboardSync::UnpackEntries(const unsigned char* payload, size_t size, unsigned int count, std::vector<LeaderboardEntry>& entries)
+{
+	entries.clear();
+	const unsigned char* read = payload;
+	const unsigned char* end = payload + size;
+	uint32_t previous = 0;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		LeaderboardEntry entry;
+		memset(&entry, 0, sizeof(entry));
+
+		uint32_t delta;
+		if (!ReadVarint(read, end, delta) || !ReadVarint(read, end, entry.score) || read >= end)
+			return false;
+		entry.sequence = previous + (uint32_t)UnZigZag(delta);
+		previous = entry.sequence;
+
+		size_t length = *read++;
+		if (length >= sizeof(entry.name) || (size_t)(end - read) < length)
+			return false;
+		memcpy(entry.name, read, length);
+		read += length;
+
+		entries.push_back(entry);
+	}
+
+	return read == end;
+}
+
+//
+// PayloadCheck
+//
+uint32_t LeaderboardSync::PayloadCheck(const unsigned char* payload, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ payload[i]) * 16777619u;
+	return hash;
+}
+
+//
+// SendBatch
+//
+bool LeaderboardSync::SendBatch(uint32_t& status)
+{
+	std::vector<unsigned char> payload;
+	PackEntries(batch_, payload);
+
+	SyncBatchHeader header;
+	header.magic = kSyncMagic;
+	header.version = kSyncVersion;
+	header.table_id = table_id_;
+	header.session = session_;
+	header.batch = batch_number_;
+	header.entry_count = (uint32_t)batch_.size();
+	header.payload_size = (uint32_t)payload.size();
+	header.payload_check = PayloadCheck(payload.empty() ? NULL : &payload[0], payload.size());
+
+	TcpSocket socket;
+	if (!socket.Connect(host_.c_str(), port_, kNetworkTimeoutMs))
+		return false;
+
+	SyncBatchReply reply;
+	if (!socket.SendAll(&header, sizeof(header)) || !socket.SendAll(payload.empty() ? NULL : &payload[0], payload.size()) ||
+		!socket.ReceiveAll(&reply, sizeof(reply)))
+		return false;
+
+	if (reply.magic != kSyncMagic || reply.batch != batch_number_)
+		return false;
+
+	status = reply.status;
+	return true;
+}
+
+//
+// ReadSpool
+//
+void LeaderboardSync::ReadSpool()
+{
+	if (spool_filename_.empty())
+		return;
+
+	FILE* file = fopen(spool_filename_.c_str(), "rb");
+	if (!file)
+		return;
+
+	SpoolHeader header;
+	std::vector<LeaderboardEntry> entries;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == kSpoolMagic &&
+		header.batch_count <= kMaxBatchEntries && header.pending_count <= kMaxPendingEntries;
+	if (valid && header.batch_count + header.pending_count > 0)
+	{
+		entries.resize(header.batch_count + header.pending_count);
+		valid = fread(&entries[0], sizeof(LeaderboardEntry), entries.size(), file) == entries.size() &&
+			PayloadCheck((const unsigned char*)&entries[0], entries.size() * sizeof(LeaderboardEntry)) == header.check;
+	}
+	fclose(file);
+
+	// taken now, so a crash later cannot send the same entries again under a new session
+	remove(spool_filename_.c_str());
+	if (!valid || entries.empty())
+		return;
+
+	for (size_t i = 0; i < entries.size(); i++)
+		entries[i].name[sizeof(entries[i].name) - 1] = '\0';
+
+	if (header.batch_count > 0)
+	{
+		session_ = header.session;
+		batch_number_ = header.batch;
+		batch_.assign(entries.begin(), entries.begin() + header.batch_count);
+	}
+	pending_.assign(entries.begin() + header.batch_count, entries.end());
+}
+
+//
+// WriteSpool
+//
+void LeaderboardSync::WriteSpool()
+{
+	// the thread has stopped, so nothing else touches the queue
+	if (spool_filename_.empty() || (batch_.empty() && pending_.empty()))
+		return;
+
+	std::vector<LeaderboardEntry> entries(batch_);
+	entries.insert(entries.end(), pending_.begin(), pending_.end());
+
+	SpoolHeader header;
+	header.magic = kSpoolMagic;
+	header.session = session_;
+	header.batch = batch_number_;
+	header.batch_count = (uint32_t)batch_.size();
+	header.pending_count = (uint32_t)pending_.size();
+	header.check = PayloadCheck((const unsigned char*)&entries[0], entries.size() * sizeof(LeaderboardEntry));
+
+	FILE* file = fopen(spool_filename_.c_str(), "wb");
+	bool written = file && fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(&entries[0], sizeof(LeaderboardEntry), entries.size(), file) == entries.size();
+	if (file && fclose(file) != 0)
+		written = false;
+	if (!written)
+		dropped_entries_ += (unsigned int)entries.size();
+}
+
+//
+// Jitter
+//
+unsigned int LeaderboardSync::Jitter(unsigned int range)
+{
+	// xorshift, only ever called from one thread at a time
+	random_ ^= random_ << 13;
+	random_ ^= random_ >> 17;
+	random_ ^= random_ << 5;
+	return range ? random_ % range : 0;
+}
+
+//
+// SyncThread
+//
+void LeaderboardSync::SyncThread()
+{
+	Profiler::SetThreadName("leaderboard sync");
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	unsigned int backoffMs = kInitialBackoffMs;
+
+	// shutting down never waits on the network, whatever is left is spooled by the destructor
+	while (true)
+	{
+		condition_.wait(lock, [this] { return quit_ || !pending_.empty() || !batch_.empty(); });
+		if (quit_)
+			break;
+
+		if (batch_.empty())
+		{
+			// let scores from the next few games join this batch
+			condition_.wait_for(lock, std::chrono::milliseconds(kBatchDelayMs), [this] { return quit_ || pending_.size() >= kMaxBatchEntries; });
+			if (quit_)
+				break;
+
+			size_t count = std::min(pending_.size(), (size_t)kMaxBatchEntries);
+			batch_.assign(pending_.begin(), pending_.begin() + count);
+			pending_.erase(pending_.begin(), pending_.begin() + count);
+		}
+
+		lock.unlock();
+		uint32_t status = SYNC_BUSY;
+		bool replied = SendBatch(status);
+		lock.lock();
+
+		if (replied && status != SYNC_BUSY)
+		{
+			if (status == SYNC_REJECTED)
+				dropped_entries_ += (unsigned int)batch_.size();
+			else
+				sent_entries_ += (unsigned int)batch_.size();
+
+			batch_.clear();
+			batch_number_++;
+			backoffMs = kInitialBackoffMs;
+			continue;
+		}
+
+		failed_attempts_++;
+
+		// spread retries so a venue's tables do not all reconnect at once after an outage
+		unsigned int waitMs = backoffMs / 2 + Jitter(backoffMs / 2 + 1);
+		condition_.wait_for(lock, std::chrono::milliseconds(waitMs), [this] { return quit_; });
+		backoffMs = std::min(backoffMs * 2, kMaxBackoffMs);
+	}
+}
@@ -0,0 +1,100 @@
+#ifndef _LEADERBOARD_SYNC_H
+#define _LEADERBOARD_SYNC_H
+
+#include "leaderboard.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Uploads new leaderboard entries to a venue score server. Queue only copies the entry, a
+// background thread gathers entries into batches, packs them and sends one batch at a time,
+// backing off with jitter while the server is unreachable. A batch keeps its number until the
+// server acknowledges it, so a resend after a lost reply is recognised and not counted twice.
+// Anything unsent at shutdown is written to a spool file and queued again on the next start.
+class LeaderboardSync
+{
+public:
+	/// @brief Constructor. Starts the sync thread.
+	/// @param[in] host			The score server's host name or address.
+	/// @param[in] port			The score server's port.
+	/// @param[in] table_id		Identifies this table to the server.
+	/// @param[in] spool_filename	Where unsent entries are kept between runs, or NULL to lose them.
+	LeaderboardSync(const char* host, unsigned short port, uint32_t table_id, const char* spool_filename = NULL);
+
+	/// @brief Default destructor. Stops without another attempt, waiting only for a send
+	/// already under way, and spools anything unsent.
+	~LeaderboardSync();
+
+	/// @brief Reads the server from a text file of the form "host port table_id".
+	/// @return The sync client, or NULL if the file is missing or malformed
+	/// @param[in] filename			The config file.
+	/// @param[in] spool_filename	Where unsent entries are kept between runs, or NULL to lose them.
+	static LeaderboardSync* CreateFromConfig(const char* filename, const char* spool_filename = NULL);
+
+	/// @brief Queues an entry for upload. Returns immediately.
+	void Queue(const LeaderboardEntry& entry);
+
+	/// @brief Get the number of entries the server has acknowledged.
+	inline unsigned int sent_entries() const { return sent_entries_.load(std::memory_order_relaxed); }
+
+	/// @brief Get the number of entries waiting to be sent.
+	unsigned int pending_entries();
+
+	/// @brief Get the number of attempts that failed and were retried.
+	inline unsigned int failed_attempts() const { return failed_attempts_.load(std::memory_order_relaxed); }
+
+	/// @brief Get the number of entries discarded, because the queue overflowed or the server rejected them.
+	inline unsigned int dropped_entries() const { return dropped_entries_.load(std::memory_order_relaxed); }
+
+	/// @brief Packs entries into the batch payload.
+	static void PackEntries(const std::vector<LeaderboardEntry>& entries, std::vector<unsigned char>& payload);
+
+	/// @brief Unpacks a batch payload.
+	/// @return false if the payload does not hold exactly count entries
+	static bool UnpackEntries(const unsigned char* payload, size_t size, unsigned int count, std::vector<LeaderboardEntry>& entries);
+
+	/// @brief Get the check value sent with a payload.
+	static uint32_t PayloadCheck(const unsigned char* payload, size_t size);
+
+	// entries sent in one batch at most
+	static const unsigned int kMaxBatchEntries = 256;
+
+	// entries held while the server is unreachable, the oldest are dropped beyond this
+	static const unsigned int kMaxPendingEntries = 4096;
+
+private:
+	bool SendBatch(uint32_t& status);
+	void ReadSpool();
+	void WriteSpool();
+	unsigned int Jitter(unsigned int range);
+	void SyncThread();
+
+	std::string host_;
+	std::string spool_filename_;
+	unsigned short port_;
+	uint32_t table_id_;
+	uint32_t session_;
+	uint32_t batch_number_;
+	uint32_t random_;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::deque<LeaderboardEntry> pending_;
+	// the batch being sent, only touched by the sync thread
+	std::vector<LeaderboardEntry> batch_;
+	bool quit_;
+
+	// counted by the sync thread and Queue, read from anywhere
+	std::atomic<unsigned int> sent_entries_;
+	std::atomic<unsigned int> failed_attempts_;
+	std::atomic<unsigned int> dropped_entries_;
+};
+
+#endif // _LEADERBOARD_SYNC_H
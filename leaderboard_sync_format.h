@@ -0,0 +1,50 @@
+#ifndef _LEADERBOARD_SYNC_FORMAT_H
+#define _LEADERBOARD_SYNC_FORMAT_H
+
+// Wire format between LeaderboardSync and a venue score server.
+//
+// request:	[SyncBatchHeader][packed entries]
+// reply:	[SyncBatchReply]
+//
+// One batch per connection. Entries are packed by LeaderboardSync::PackEntries, each one a
+// varint sequence delta, a varint score and a length prefixed name, so a typical entry takes
+// 7 bytes on the wire rather than 20. Integers are little endian.
+
+#include <stdint.h>
+
+static const uint32_t kSyncMagic = 0x3153424c;	// "LBS1"
+static const uint32_t kSyncVersion = 1;
+
+// server side sanity limit on a single batch
+static const uint32_t kSyncMaxPayload = 64 * 1024;
+
+enum SYNC_STATUS
+{
+	SYNC_ACCEPTED = 0,
+	SYNC_DUPLICATE,		// already received, the reply to the first attempt was lost
+	SYNC_REJECTED,		// malformed, do not resend as is
+	SYNC_BUSY,			// try again later
+};
+
+struct SyncBatchHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t table_id;
+	// chosen at random each time the game starts, with batch numbering restarting at 1
+	uint32_t session;
+	uint32_t batch;
+	uint32_t entry_count;
+	uint32_t payload_size;
+	// FNV-1a of the payload
+	uint32_t payload_check;
+};
+
+struct SyncBatchReply
+{
+	uint32_t magic;
+	uint32_t batch;
+	uint32_t status;
+};
+
+#endif // _LEADERBOARD_SYNC_FORMAT_H
@@ -1,22 +1,174 @@
 #include "load_texture.h"
+#include "asset_pack.h"
+#include "baked_texture_format.h"
 
 #include <assets/png_loader.h>
 #include <graphics/image_data.h>
 #include <graphics/texture.h>
+#include <system/debug_log.h>
+#include <chrono>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
 
-gef::Texture* CreateTextureFromPNG(const char* png_filename, gef::Platform& platform)
+namespace
+{
+	const AssetPack* baked_texture_pack = NULL;
+
+	typedef std::chrono::steady_clock BenchClock;
+
+	// swap the extension for the baked container
+	std::string BakedFilename(const char* png_filename)
+	{
+		std::string tex_filename = png_filename;
+		size_t dot = tex_filename.find_last_of('.');
+		if (dot != std::string::npos)
+			tex_filename.erase(dot);
+		return tex_filename + ".tex";
+	}
+
+	float ElapsedMs(BenchClock::time_point start, BenchClock::time_point end)
+	{
+		return std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	bool ValidHeader(const BakedTextureHeader& header, size_t available)
+	{
+		return header.magic == kBakedTextureMagic && header.version == kBakedTextureVersion && header.format == BAKED_RGBA8 &&
+			header.width > 0 && header.height > 0 && (size_t)header.width * header.height * 4 <= available;
+	}
+
+	// hand level 0 to the image data, which takes ownership of the buffer
+	UInt8* AllocateLevel(const BakedTextureHeader& header, gef::ImageData& image_data)
+	{
+		UInt8* pixels = new UInt8[header.width * header.height * 4];
+		image_data.set_width(header.width);
+		image_data.set_height(header.height);
+		image_data.set_image(pixels);
+		return pixels;
+	}
+
+	// free whatever the image data holds, so a failed load leaves it empty
+	void ClearImage(gef::ImageData& image_data)
+	{
+		delete[] image_data.image();
+		image_data.set_image(NULL);
+		image_data.set_width(0);
+		image_data.set_height(0);
+	}
+
+	bool LoadBakedTexture(const std::string& tex_filename, gef::ImageData& image_data)
+	{
+		// from the asset pack, straight out of the mapping
+		size_t size = 0;
+		const unsigned char* data = baked_texture_pack ? (const unsigned char*)baked_texture_pack->Find(tex_filename.c_str(), &size) : NULL;
+		if (data && size >= sizeof(BakedTextureHeader))
+		{
+			BakedTextureHeader header;
+			memcpy(&header, data, sizeof(header));
+			if (!ValidHeader(header, size - sizeof(header)))
+				return false;
+
+			memcpy(AllocateLevel(header, image_data), data + sizeof(header), header.width * header.height * 4);
+			return true;
+		}
+
+		// or from a loose file next to the PNG
+		FILE* file = fopen(tex_filename.c_str(), "rb");
+		if (!file)
+			return false;
+
+		BakedTextureHeader header;
+		bool loaded = fread(&header, sizeof(header), 1, file) == 1 && ValidHeader(header, (size_t)-1);
+		if (loaded)
+		{
+			UInt8* pixels = AllocateLevel(header, image_data);
+			loaded = fread(pixels, 1, header.width * header.height * 4, file) == header.width * header.height * 4;
+		}
+		fclose(file);
+		if (!loaded)
+			ClearImage(image_data);
+		return loaded;
+	}
+}
+
+void SetBakedTexturePack(const AssetPack* pack)
+{
+	baked_texture_pack = pack;
+}
+
+bool LoadImageData(const char* png_filename, gef::Platform& platform, gef::ImageData& image_data)
 {
+	std::string tex_filename = BakedFilename(png_filename);
+
+	ClearImage(image_data);
+	if (LoadBakedTexture(tex_filename, image_data))
+		return true;
+
+	// load image data from PNG file, which leaves the image data empty if it fails
 	gef::PNGLoader png_loader;
+	png_loader.Load(png_filename, platform, image_data);
+
+	return image_data.image() != NULL;
+}
+
+gef::Texture* CreateTextureFromPNG(const char* png_filename, gef::Platform& platform)
+{
 	gef::ImageData image_data;
 	gef::Texture* texture = NULL;
 
-	// load image data from PNG file 
-	png_loader.Load(png_filename, platform, image_data);
-
 	// if the image data is valid, then create a texture from it
-	if (image_data.image() != NULL)
+	if (LoadImageData(png_filename, platform, image_data))
 		texture = gef::Texture::Create(platform, image_data);
 
 	return texture;
 }
+
+void BenchTextureLoads(const char* const* png_filenames, int count, gef::Platform& platform, int iterations)
+{
+	for (int i = 0; i < count; i++)
+	{
+		std::string tex_filename = BakedFilename(png_filenames[i]);
+		float pngDecodeMs = 0.f, pngUploadMs = 0.f, bakedReadMs = 0.f, bakedUploadMs = 0.f;
+		UInt32 width = 0, height = 0;
+		bool baked = true;
+
+		for (int n = 0; n < iterations; n++)
+		{
+			gef::ImageData png_data;
+			gef::PNGLoader png_loader;
+			BenchClock::time_point start = BenchClock::now();
+			png_loader.Load(png_filenames[i], platform, png_data);
+			BenchClock::time_point decoded = BenchClock::now();
+			gef::Texture* texture = png_data.image() ? gef::Texture::Create(platform, png_data) : NULL;
+			BenchClock::time_point uploaded = BenchClock::now();
+			delete texture;
+			pngDecodeMs += ElapsedMs(start, decoded);
+			pngUploadMs += ElapsedMs(decoded, uploaded);
+			width = png_data.width();
+			height = png_data.height();
+
+			gef::ImageData baked_data;
+			start = BenchClock::now();
+			baked = LoadBakedTexture(tex_filename, baked_data) && baked;
+			decoded = BenchClock::now();
+			texture = baked_data.image() ? gef::Texture::Create(platform, baked_data) : NULL;
+			uploaded = BenchClock::now();
+			delete texture;
+			bakedReadMs += ElapsedMs(start, decoded);
+			bakedUploadMs += ElapsedMs(decoded, uploaded);
+		}
+
+		if (baked)
+		{
+			gef::DebugOut("Texture %s %ux%u: png %.2f + %.2fms upload, baked %.2f + %.2fms upload\n", png_filenames[i], width, height,
+				pngDecodeMs / iterations, pngUploadMs / iterations, bakedReadMs / iterations, bakedUploadMs / iterations);
+		}
+		else
+		{
+			gef::DebugOut("Texture %s %ux%u: png %.2f + %.2fms upload, no baked .tex\n", png_filenames[i], width, height,
+				pngDecodeMs / iterations, pngUploadMs / iterations);
+		}
+	}
+}
@@ -3,10 +3,21 @@
 
 #include <system/platform.h>
 #include <graphics/texture.h>
+#include <graphics/image_data.h>
+
+class AssetPack;
 
 // FUNCTION PROTOTYPES
 gef::Texture* CreateTextureFromPNG(const char* png_filename, gef::Platform& platform);
 
-#endif // _LOAD_TEXTURE_H
+// Loads the pixels for a PNG, preferring the baked .tex made by tools/texture_baker
+bool LoadImageData(const char* png_filename, gef::Platform& platform, gef::ImageData& image_data);
 
+// Pack searched for baked textures before the loose files, NULL to search only loose files
+void SetBakedTexturePack(const AssetPack* pack);
 
+// Times decoding and uploading each PNG against its baked .tex, reporting through DebugOut.
+// The game runs it over every texture at startup when built with TEXTURE_LOAD_BENCH defined.
+void BenchTextureLoads(const char* const* png_filenames, int count, gef::Platform& platform, int iterations);
+
+#endif // _LOAD_TEXTURE_H
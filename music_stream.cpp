@@ -0,0 +1,263 @@
+#include "music_stream.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
+#include <system/debug_log.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+//
+// MusicStream
+//
+MusicStream::MusicStream() :
+	ring_(kRingFrames * 2, 0),
+	write_(0),
+	read_(0),
+	volume_(1.f),
+	source_rate_(0),
+	phase_(0.f),
+	loop_(true),
+	request_(0),
+	quit_(false),
+	file_(NULL),
+	chunk_(kChunkFrames * 2)
+{
+	thread_ = std::thread(&MusicStream::DecodeThread, this);
+}
+
+//
+// ~MusicStream
+//
+MusicStream::~MusicStream()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	condition_.notify_all();
+	thread_.join();
+}
+
+//
+// Play
+//
+void MusicStream::Play(const char* filename, bool loop)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		filename_ = filename;
+		loop_ = loop;
+		request_++;
+	}
+	condition_.notify_all();
+}
+
+//
+// Stop
+//
+void MusicStream::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		filename_.clear();
+		request_++;
+	}
+	condition_.notify_all();
+}
+
+//
+// Render
+//
+// Linear resample from the track rate to the output rate
+//
+void MusicStream::Render(float* samples, int frame_count, int sample_rate)
+{
+	std::unique_lock<std::mutex> lock(ring_mutex_, std::try_to_lock);
+	if (!lock.owns_lock() || source_rate_ == 0)
+	{
+		memset(samples, 0, frame_count * 2 * sizeof(float));
+		return;
+	}
+
+	const float step = (float)source_rate_ / sample_rate;
+	const float gain = volume_ / 32768.f;
+	const unsigned int mask = kRingFrames - 1;
+	unsigned int read = read_.load(std::memory_order_relaxed);
+	unsigned int write = write_.load(std::memory_order_acquire);
+
+	int frame = 0;
+	for (; frame < frame_count; frame++)
+	{
+		// a step over one can pass more frames than are decoded, read stops at write and
+		// the phase keeps the rest, to be skipped once the decoder has caught up
+		unsigned int whole = (unsigned int)phase_;
+		whole = std::min(whole, write - read);
+		read += whole;
+		phase_ -= whole;
+		if (phase_ >= 1.f || write - read < 2)
+			break;
+
+		const short* s0 = &ring_[(read & mask) * 2];
+		const short* s1 = &ring_[((read + 1) & mask) * 2];
+		samples[frame * 2] = (s0[0] + (s1[0] - s0[0]) * phase_) * gain;
+		samples[frame * 2 + 1] = (s0[1] + (s1[1] - s0[1]) * phase_) * gain;
+		phase_ += step;
+	}
+	read_.store(read, std::memory_order_release);
+
+	// the decoder fell behind or the track ended
+	if (frame < frame_count)
+		memset(&samples[frame * 2], 0, (frame_count - frame) * 2 * sizeof(float));
+}
+
+//
+// DecodeThread
+//
+void MusicStream::DecodeThread()
+{
+	Profiler::SetThreadName("music decode");
+	AllocTagScope alloc_scope(ALLOC_AUDIO);
+
+	unsigned int handled = 0;
+	WavFormat format;
+	bool loop = true;
+
+	for (;;)
+	{
+		std::string filename;
+		bool restart = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (file_)
+			{
+				// the ring is full, wait for the output to drain some of it
+				condition_.wait_for(lock, std::chrono::milliseconds(10), [&] { return quit_ || request_ != handled; });
+			}
+			else
+			{
+				condition_.wait(lock, [&] { return quit_ || request_ != handled; });
+			}
+
+			if (quit_)
+				break;
+
+			if (request_ != handled)
+			{
+				handled = request_;
+				filename = filename_;
+				loop = loop_;
+				restart = true;
+			}
+		}
+
+		if (restart)
+		{
+			if (file_)
+			{
+				fclose(file_);
+				file_ = NULL;
+			}
+
+			if (filename.empty() || !OpenTrack(filename, format))
+			{
+				ResetRing(0);
+				continue;
+			}
+			ResetRing(format.sample_rate);
+		}
+
+		// top the ring up, then go back to waiting
+		while (file_ && DecodeChunk(format, loop) > 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (quit_ || request_ != handled)
+				break;
+		}
+	}
+
+	if (file_)
+	{
+		fclose(file_);
+		file_ = NULL;
+	}
+}
+
+//
+// OpenTrack
+//
+bool MusicStream::OpenTrack(const std::string& filename, WavFormat& format)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		gef::DebugOut("MusicStream: %s not found\n", filename.c_str());
+		return false;
+	}
+
+	if (!ReadWavHeader(file, format))
+	{
+		gef::DebugOut("MusicStream: %s is not a 16 bit PCM WAV\n", filename.c_str());
+		fclose(file);
+		return false;
+	}
+
+	file_ = file;
+	return true;
+}
+
+//
+// ResetRing
+//
+void MusicStream::ResetRing(int sample_rate)
+{
+	std::lock_guard<std::mutex> lock(ring_mutex_);
+	read_ = 0;
+	write_ = 0;
+	phase_ = 0.f;
+	source_rate_ = sample_rate;
+}
+
+//
+// DecodeChunk
+//
+// Read up to one chunk of frames into the free space of the ring
+//
+unsigned int MusicStream::DecodeChunk(WavFormat& format, bool loop)
+{
+	unsigned int write = write_.load(std::memory_order_relaxed);
+	unsigned int space = kRingFrames - (write - read_.load(std::memory_order_acquire));
+	unsigned int frames = space < kChunkFrames ? space : kChunkFrames;
+	if (frames == 0)
+		return 0;
+
+	const long frameBytes = format.channels * sizeof(short);
+	long remaining = format.data_offset + format.data_size - ftell(file_);
+	frames = std::min(frames, (unsigned int)(remaining / frameBytes));
+
+	size_t decoded = frames ? fread(&chunk_[0], frameBytes, frames, file_) : 0;
+	const unsigned int mask = kRingFrames - 1;
+	for (size_t i = 0; i < decoded; i++)
+	{
+		short* target = &ring_[((write + i) & mask) * 2];
+		target[0] = chunk_[i * format.channels];
+		target[1] = chunk_[i * format.channels + format.channels - 1];
+	}
+	write_.store(write + (unsigned int)decoded, std::memory_order_release);
+
+	if (decoded < frames || remaining < frameBytes)
+	{
+		// end of the data chunk
+		if (loop)
+		{
+			fseek(file_, format.data_offset, SEEK_SET);
+		}
+		else
+		{
+			fclose(file_);
+			file_ = NULL;
+		}
+	}
+
+	return (unsigned int)decoded;
+}
@@ -0,0 +1,74 @@
+#ifndef _MUSIC_STREAM_H
+#define _MUSIC_STREAM_H
+
+#include "audio_output.h"
+#include "wav_file.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Plays a WAV track by decoding small chunks on a background thread into a ring buffer
+class MusicStream : public AudioSource
+{
+public:
+	/// @brief Default constructor. Starts the decode thread.
+	MusicStream();
+
+	/// @brief Default destructor. Stops the decode thread and closes the track.
+	~MusicStream();
+
+	/// @brief Starts a track. Returns immediately, the file is opened on the decode thread.
+	/// @param[in] filename		The PCM WAV file to stream.
+	/// @param[in] loop			Restart the track when it ends.
+	void Play(const char* filename, bool loop = true);
+
+	/// @brief Stops the current track.
+	void Stop();
+
+	/// @brief Sets the track volume.
+	/// @param[in] volume		The gain, from 0 to 1.
+	inline void set_volume(float volume) { volume_ = volume; }
+
+	/// @brief Get the size of the decode ring buffer.
+	/// @return The size in bytes
+	inline size_t buffer_bytes() const { return ring_.size() * sizeof(short); }
+
+	void Render(float* samples, int frame_count, int sample_rate);
+
+private:
+	void DecodeThread();
+	bool OpenTrack(const std::string& filename, WavFormat& format);
+	void ResetRing(int sample_rate);
+	unsigned int DecodeChunk(WavFormat& format, bool loop);
+
+	// stereo frames held between the decode thread and the output, a power of two
+	static const unsigned int kRingFrames = 32768;
+	static const unsigned int kChunkFrames = 4096;
+
+	std::vector<short> ring_;
+	std::atomic<unsigned int> write_;
+	std::atomic<unsigned int> read_;
+	std::atomic<float> volume_;
+
+	// held by the output while reading and by the decode thread while resetting,
+	// the output only ever tries to take it so it never waits on the disk
+	std::mutex ring_mutex_;
+	int source_rate_;
+	float phase_;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::string filename_;
+	bool loop_;
+	unsigned int request_;
+	bool quit_;
+
+	FILE* file_;
+	std::vector<short> chunk_;
+};
+
+#endif // _MUSIC_STREAM_H
@@ -0,0 +1,306 @@
+#include "net_socket.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define NET_SOCKETS
+typedef int socklen_t;
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#define NET_SOCKETS
+#endif
+
+#if defined(NET_SOCKETS)
+namespace
+{
+#if defined(_WIN32)
+	typedef SOCKET Socket;
+
+	// winsock counts startups, so one for the life of the program is enough
+	struct WinsockStartup
+	{
+		WinsockStartup() { WSADATA data; ok = WSAStartup(MAKEWORD(2, 2), &data) == 0; }
+		~WinsockStartup() { if (ok) WSACleanup(); }
+		bool ok;
+	};
+
+	bool StartNetwork()
+	{
+		static WinsockStartup startup;
+		return startup.ok;
+	}
+
+	void CloseSocket(Socket socket) { closesocket(socket); }
+
+	void SetBlocking(Socket socket, bool blocking)
+	{
+		u_long nonBlocking = blocking ? 0 : 1;
+		ioctlsocket(socket, FIONBIO, &nonBlocking);
+	}
+
+	bool ConnectPending() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+
+	const int kSendFlags = 0;
+#else
+	typedef int Socket;
+
+	bool StartNetwork() { return true; }
+
+	void CloseSocket(Socket socket) { close(socket); }
+
+	void SetBlocking(Socket socket, bool blocking)
+	{
+		int flags = fcntl(socket, F_GETFL, 0);
+		fcntl(socket, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+	}
+
+	bool ConnectPending() { return errno == EINPROGRESS; }
+
+	// a dropped connection should fail the send, not raise SIGPIPE
+#if defined(MSG_NOSIGNAL)
+	const int kSendFlags = MSG_NOSIGNAL;
+#else
+	const int kSendFlags = 0;
+#endif
+#endif
+
+	// waits for a socket to become readable or writable
+	bool WaitFor(Socket socket, bool write, int timeout_ms)
+	{
+		fd_set set;
+		FD_ZERO(&set);
+		FD_SET(socket, &set);
+
+		timeval timeout;
+		timeout.tv_sec = timeout_ms / 1000;
+		timeout.tv_usec = (timeout_ms % 1000) * 1000;
+		return select((int)socket + 1, write ? NULL : &set, write ? &set : NULL, NULL, &timeout) > 0;
+	}
+}
+#endif
+
+//
+// TcpSocket
+//
+TcpSocket::TcpSocket() :
+	handle_(kInvalid)
+{
+}
+
+//
+// ~TcpSocket
+//
+TcpSocket::~TcpSocket()
+{
+	Close();
+}
+
+//
+// Connect
+//
+bool TcpSocket::Connect(const char* host, unsigned short port, int timeout_ms)
+{
+	Close();
+
+#if defined(NET_SOCKETS)
+	if (!StartNetwork())
+		return false;
+
+	char service[8];
+	sprintf(service, "%u", (unsigned int)port);
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* address = NULL;
+	if (getaddrinfo(host, service, &hints, &address) != 0 || !address)
+		return false;
+
+	Socket socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+	if ((intptr_t)socket == kInvalid)
+	{
+		freeaddrinfo(address);
+		return false;
+	}
+
+	// connect without blocking so an unreachable server costs the timeout, not the OS default
+	SetBlocking(socket, false);
+	bool connected = connect(socket, address->ai_addr, (int)address->ai_addrlen) == 0;
+	freeaddrinfo(address);
+
+	if (!connected && ConnectPending() && WaitFor(socket, true, timeout_ms))
+	{
+		int error = 0;
+		socklen_t length = sizeof(error);
+		connected = getsockopt(socket, SOL_SOCKET, SO_ERROR, (char*)&error, &length) == 0 && error == 0;
+	}
+
+	if (!connected)
+	{
+		CloseSocket(socket);
+		return false;
+	}
+
+	SetBlocking(socket, true);
+	int noDelay = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
+	handle_ = (intptr_t)socket;
+	SetTimeout(timeout_ms);
+	return true;
+#else
+	return false;
+#endif
+}
+
+//
+// Listen
+//
+bool TcpSocket::Listen(unsigned short port, bool loopback_only)
+{
+	Close();
+
+#if defined(NET_SOCKETS)
+	if (!StartNetwork())
+		return false;
+
+	Socket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if ((intptr_t)socket == kInvalid)
+		return false;
+
+	int reuse = 1;
+	setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(loopback_only ? INADDR_LOOPBACK : INADDR_ANY);
+
+	if (bind(socket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(socket, SOMAXCONN) != 0)
+	{
+		CloseSocket(socket);
+		return false;
+	}
+
+	handle_ = (intptr_t)socket;
+	return true;
+#else
+	(void)port;
+	(void)loopback_only;
+	return false;
+#endif
+}
+
+//
+// Accept
+//
+bool TcpSocket::Accept(TcpSocket& client, int wait_ms, int timeout_ms)
+{
+	client.Close();
+
+#if defined(NET_SOCKETS)
+	if (!is_open() || !WaitFor((Socket)handle_, false, wait_ms))
+		return false;
+
+	Socket socket = accept((Socket)handle_, NULL, NULL);
+	if ((intptr_t)socket == kInvalid)
+		return false;
+
+	client.handle_ = (intptr_t)socket;
+	client.SetTimeout(timeout_ms);
+	return true;
+#else
+	(void)wait_ms;
+	(void)timeout_ms;
+	return false;
+#endif
+}
+
+//
+// SendAll
+//
+bool TcpSocket::SendAll(const void* data, size_t size)
+{
+#if defined(NET_SOCKETS)
+	const char* bytes = (const char*)data;
+	while (size > 0 && is_open())
+	{
+		int sent = send((Socket)handle_, bytes, (int)size, kSendFlags);
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= sent;
+	}
+	return size == 0;
+#else
+	(void)data;
+	return size == 0;
+#endif
+}
+
+//
+// ReceiveAll
+//
+bool TcpSocket::ReceiveAll(void* data, size_t size)
+{
+#if defined(NET_SOCKETS)
+	char* bytes = (char*)data;
+	while (size > 0 && is_open())
+	{
+		int received = recv((Socket)handle_, bytes, (int)size, 0);
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= received;
+	}
+	return size == 0;
+#else
+	(void)data;
+	return size == 0;
+#endif
+}
+
+//
+// Close
+//
+void TcpSocket::Close()
+{
+#if defined(NET_SOCKETS)
+	if (is_open())
+		CloseSocket((Socket)handle_);
+#endif
+	handle_ = kInvalid;
+}
+
+//
+// SetTimeout
+//
+void TcpSocket::SetTimeout(int timeout_ms)
+{
+#if defined(_WIN32)
+	DWORD timeout = (DWORD)timeout_ms;
+#elif defined(NET_SOCKETS)
+	timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+#endif
+#if defined(NET_SOCKETS)
+	setsockopt((Socket)handle_, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+	setsockopt((Socket)handle_, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+	(void)timeout_ms;
+#endif
+}
@@ -0,0 +1,56 @@
+#ifndef _NET_SOCKET_H
+#define _NET_SOCKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal blocking TCP socket with timeouts, enough for short request and reply exchanges.
+// On platforms without a socket implementation every call fails.
+class TcpSocket
+{
+public:
+	TcpSocket();
+
+	/// @brief Default destructor. Closes the socket.
+	~TcpSocket();
+
+	/// @brief Connects to a server.
+	/// @return true if connected within the timeout
+	/// @param[in] host			Host name or dotted address.
+	/// @param[in] port			The server port.
+	/// @param[in] timeout_ms	How long connecting, and each later send or receive, may take.
+	bool Connect(const char* host, unsigned short port, int timeout_ms);
+
+	/// @brief Starts listening for connections.
+	/// @param[in] port			The port to listen on.
+	/// @param[in] loopback_only	Accept connections from this machine only.
+	bool Listen(unsigned short port, bool loopback_only);
+
+	/// @brief Waits for a connection on a listening socket.
+	/// @return false if no connection arrived within the timeout
+	/// @param[out] client		Replaced with the connection.
+	/// @param[in] wait_ms		How long to wait.
+	/// @param[in] timeout_ms	How long each send or receive on the connection may take.
+	bool Accept(TcpSocket& client, int wait_ms, int timeout_ms);
+
+	/// @brief Sends the whole buffer.
+	bool SendAll(const void* data, size_t size);
+
+	/// @brief Receives exactly size bytes.
+	bool ReceiveAll(void* data, size_t size);
+
+	void Close();
+
+	inline bool is_open() const { return handle_ != kInvalid; }
+
+private:
+	TcpSocket(const TcpSocket&);
+	TcpSocket& operator=(const TcpSocket&);
+
+	void SetTimeout(int timeout_ms);
+
+	static const intptr_t kInvalid = -1;
+	intptr_t handle_;
+};
+
+#endif // _NET_SOCKET_H
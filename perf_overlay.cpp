@@ -0,0 +1,166 @@
+#include "perf_overlay.h"
+#include "cached_font.h"
+#include <graphics/sprite_renderer.h>
+#include <graphics/sprite.h>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const float kGraphHeight = 100.f;
+	const float kBarWidth = 2.f;
+
+	// the top of the graph, longer frames are cut off there
+	const float kGraphMs = 50.f;
+
+	const float kTextScale = 0.6f;
+	const float kLineHeight = 20.f;
+	const int kTextLines = 3;
+
+	const UInt32 kBackdropColour = 0xa0000000;
+	const UInt32 kTargetColour = 0x80ffffff;
+	const UInt32 kTextColour = 0xffffffff;
+
+	// a frame at 60Hz, then at 30Hz, then slower
+	const UInt32 kFastColour = 0xff00ff00;
+	const UInt32 kSlowColour = 0xff00ffff;
+	const UInt32 kStallColour = 0xff0000ff;
+	const float kFastMs = 1000.f / 60.f + 0.5f;
+	const float kSlowMs = 1000.f / 30.f + 0.5f;
+}
+
+//
+// PerfOverlay
+//
+PerfOverlay::PerfOverlay() :
+	visible_(false),
+	frame_count_(0),
+	next_(0),
+	sum_ms_(0.f),
+	summed_(0),
+	shown_ms_(0.f),
+	low_fps_(0.f),
+	lower_fps_(0.f),
+	worst_ms_(0.f)
+{
+	memset(frame_ms_, 0, sizeof(frame_ms_));
+	memset(&sum_, 0, sizeof(sum_));
+	memset(&shown_, 0, sizeof(shown_));
+}
+
+//
+// AddFrame
+//
+void PerfOverlay::AddFrame(float frame_time, const FrameCounters& counters)
+{
+	float ms = frame_time * 1000.f;
+	frame_ms_[next_] = ms;
+	next_ = (next_ + 1) % kLowFrames;
+	if (frame_count_ < kLowFrames)
+		frame_count_++;
+
+	sum_ms_ += ms;
+	sum_.physics_ms += counters.physics_ms;
+	sum_.contacts += counters.contacts;
+	sum_.awake_bodies += counters.awake_bodies;
+	sum_.mesh_draws += counters.mesh_draws;
+	sum_.allocations += counters.allocations;
+	sum_.physics_allocations += counters.physics_allocations;
+	if (++summed_ == kSummaryFrames)
+	{
+		Summarise();
+	}
+}
+
+//
+// Draw
+//
+void PerfOverlay::Draw(gef::SpriteRenderer* sprite_renderer, CachedFont* font, float x, float y) const
+{
+	if (!visible_ || !sprite_renderer)
+		return;
+
+	// sprites are positioned by their centre
+	float graphWidth = kGraphFrames * kBarWidth;
+	float textHeight = kTextLines * kLineHeight;
+	gef::Sprite sprite;
+	sprite.set_colour(kBackdropColour);
+	sprite.set_width(graphWidth + 8.f);
+	sprite.set_height(kGraphHeight + textHeight + 8.f);
+	sprite.set_position(gef::Vector4(x + graphWidth * 0.5f, y - (kGraphHeight + textHeight) * 0.5f, -0.8f));
+	sprite_renderer->DrawSprite(sprite);
+
+	// oldest frame on the left
+	float scale = kGraphHeight / kGraphMs;
+	sprite.set_width(kBarWidth);
+	int bars = frame_count_ < kGraphFrames ? frame_count_ : kGraphFrames;
+	for (int i = 0; i < bars; i++)
+	{
+		int frame = (next_ - bars + i + kLowFrames) % kLowFrames;
+		float ms = frame_ms_[frame];
+		float height = ms < kGraphMs ? ms * scale : kGraphHeight;
+		sprite.set_colour(ms <= kFastMs ? kFastColour : (ms <= kSlowMs ? kSlowColour : kStallColour));
+		sprite.set_height(height);
+		sprite.set_position(gef::Vector4(x + (i + 0.5f) * kBarWidth, y - height * 0.5f, -0.79f));
+		sprite_renderer->DrawSprite(sprite);
+	}
+
+	sprite.set_colour(kTargetColour);
+	sprite.set_width(graphWidth);
+	sprite.set_height(1.f);
+	sprite.set_position(gef::Vector4(x + graphWidth * 0.5f, y - kFastMs * scale, -0.78f));
+	sprite_renderer->DrawSprite(sprite);
+	sprite.set_position(gef::Vector4(x + graphWidth * 0.5f, y - kSlowMs * scale, -0.78f));
+	sprite_renderer->DrawSprite(sprite);
+
+	if (!font)
+		return;
+
+	float top = y - kGraphHeight - textHeight;
+	font->RenderText(sprite_renderer, gef::Vector4(x, top, -0.78f), kTextScale, kTextColour, gef::TJ_LEFT,
+		"%.1f fps %.1fms  1%% low %.1f  0.1%% low %.1f", shown_ms_ > 0.f ? 1000.f / shown_ms_ : 0.f, shown_ms_, low_fps_, lower_fps_);
+	font->RenderText(sprite_renderer, gef::Vector4(x, top + kLineHeight, -0.78f), kTextScale, kTextColour, gef::TJ_LEFT,
+		"physics %.2fms  contacts %i  awake %i", shown_.physics_ms, shown_.contacts, shown_.awake_bodies);
+	font->RenderText(sprite_renderer, gef::Vector4(x, top + kLineHeight * 2.f, -0.78f), kTextScale, kTextColour, gef::TJ_LEFT,
+		"meshes %i  allocs %u  b2Alloc %u  worst %.1fms", shown_.mesh_draws, shown_.allocations, shown_.physics_allocations, worst_ms_);
+}
+
+//
+// Summarise
+//
+void PerfOverlay::Summarise()
+{
+	// averages over the frames since the last refresh
+	shown_ms_ = sum_ms_ / summed_;
+	shown_.physics_ms = sum_.physics_ms / summed_;
+	shown_.contacts = sum_.contacts / summed_;
+	shown_.awake_bodies = sum_.awake_bodies / summed_;
+	shown_.mesh_draws = sum_.mesh_draws / summed_;
+	shown_.allocations = sum_.allocations / summed_;
+	shown_.physics_allocations = sum_.physics_allocations / summed_;
+	memset(&sum_, 0, sizeof(sum_));
+	sum_ms_ = 0.f;
+	summed_ = 0;
+
+	// the lows are the average frame rates of the slowest 1% and 0.1% of frames
+	float sorted[kLowFrames];
+	memcpy(sorted, frame_ms_, frame_count_ * sizeof(float));
+	int low = frame_count_ * 99 / 100;
+	int lower = frame_count_ * 999 / 1000;
+	std::nth_element(sorted, sorted + low, sorted + frame_count_);
+	std::nth_element(sorted + low, sorted + lower, sorted + frame_count_);
+	low_fps_ = AverageFps(sorted + low, sorted + frame_count_);
+	lower_fps_ = AverageFps(sorted + lower, sorted + frame_count_);
+	worst_ms_ = *std::max_element(sorted + lower, sorted + frame_count_);
+}
+
+//
+// AverageFps
+//
+float PerfOverlay::AverageFps(const float* begin, const float* end)
+{
+	float total_ms = 0.f;
+	for (const float* ms = begin; ms < end; ms++)
+		total_ms += *ms;
+	return total_ms > 0.f ? 1000.f * (end - begin) / total_ms : 0.f;
+}
@@ -0,0 +1,75 @@
+#ifndef _PERF_OVERLAY_H
+#define _PERF_OVERLAY_H
+
+// FRAMEWORK FORWARD DECLARATIONS
+namespace gef
+{
+	class SpriteRenderer;
+}
+
+class CachedFont;
+
+// What the game counted over one frame.
+struct FrameCounters
+{
+	float physics_ms;
+	int contacts;
+	int awake_bodies;
+	int mesh_draws;
+
+	// operator new calls on the frame threads, and Box2D's calls into the physics pool
+	unsigned int allocations;
+	unsigned int physics_allocations;
+};
+
+// Frame times and counters drawn over whatever state is showing, for finding out why a
+// cabinet is slow without a debugger. The graph has a bar per frame; the figures under it
+// are refreshed a few times a second so they can be read and the font cache keeps them.
+class PerfOverlay
+{
+public:
+	PerfOverlay();
+
+	/// @brief Adds a frame. Called every frame, shown or not, so the lows are ready when it is opened.
+	void AddFrame(float frame_time, const FrameCounters& counters);
+
+	/// @brief Draws the overlay, between the sprite renderer's Begin and End.
+	/// @param[in] x	Left edge.
+	/// @param[in] y	Bottom edge.
+	void Draw(gef::SpriteRenderer* sprite_renderer, CachedFont* font, float x, float y) const;
+
+	inline bool visible() const { return visible_; }
+	inline void set_visible(bool visible) { visible_ = visible; }
+
+	// frames shown in the graph, frames the lows are taken over, and frames between refreshes of the figures
+	static const int kGraphFrames = 120;
+	static const int kLowFrames = 1000;
+	static const int kSummaryFrames = 15;
+
+private:
+	void Summarise();
+
+	/// @return The frame rate over a run of frame times in milliseconds
+	static float AverageFps(const float* begin, const float* end);
+
+	bool visible_;
+
+	// the last kLowFrames frame times in milliseconds, next_ is the oldest once full
+	float frame_ms_[kLowFrames];
+	int frame_count_;
+	int next_;
+
+	// counters summed since the figures were last refreshed
+	FrameCounters sum_;
+	float sum_ms_;
+	int summed_;
+
+	// the figures on screen
+	FrameCounters shown_;
+	float shown_ms_;
+	float low_fps_;
+	float lower_fps_;
+	float worst_ms_;
+};
+
+#endif // _PERF_OVERLAY_H
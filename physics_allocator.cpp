@@ -0,0 +1,211 @@
+#include "physics_allocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	// in front of every block, so a block can find its way home from any thread
+	struct BlockHeader
+	{
+		PhysicsPool* pool;
+		uint32_t size_class;
+		uint32_t size;
+	};
+	const size_t kHeaderBytes = 16;
+	static_assert(sizeof(BlockHeader) <= kHeaderBytes, "BlockHeader must fit its padding");
+
+	// blocks too large for a size class go straight to the system
+	const uint32_t kLargeClass = 0xffffffff;
+
+	// a slab holds at least this much, or four blocks of the largest class
+	const size_t kSlabBytes = 64 * 1024;
+	const size_t kMinSlabBlocks = 4;
+
+	thread_local PhysicsPool* current_pool = NULL;
+
+	PhysicsPool& SharedPool()
+	{
+		static PhysicsPool pool;
+		return pool;
+	}
+
+	size_t ClassBytes(unsigned int size_class)
+	{
+		return PhysicsPool::kMinClassBytes << size_class;
+	}
+}
+
+//
+// PhysicsPool
+//
+PhysicsPool::PhysicsPool() :
+	slabs_(NULL)
+{
+	memset(free_, 0, sizeof(free_));
+	memset(&stats_, 0, sizeof(stats_));
+}
+
+//
+// ~PhysicsPool
+//
+PhysicsPool::~PhysicsPool()
+{
+	// blocks still out go with their slab, large blocks still out are left to the system
+	while (slabs_)
+	{
+		Slab* next = slabs_->next;
+		free(slabs_);
+		slabs_ = next;
+	}
+}
+
+//
+// Allocate
+//
+void* PhysicsPool::Allocate(size_t size)
+{
+	BlockHeader* header = NULL;
+
+	if (size > kMaxClassBytes)
+	{
+		header = (BlockHeader*)malloc(kHeaderBytes + size);
+		if (!header)
+			return NULL;
+		header->pool = this;
+		header->size_class = kLargeClass;
+		header->size = (uint32_t)size;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_.system_bytes += kHeaderBytes + size;
+		CountAllocation(size);
+	}
+	else
+	{
+		unsigned int sizeClass = 0;
+		while (ClassBytes(sizeClass) < size)
+			sizeClass++;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!free_[sizeClass] && !Refill(sizeClass))
+			return NULL;
+
+		header = (BlockHeader*)free_[sizeClass];
+		free_[sizeClass] = free_[sizeClass]->next;
+		header->pool = this;
+		header->size_class = sizeClass;
+		header->size = (uint32_t)size;
+		stats_.pooled++;
+		CountAllocation(size);
+	}
+	return (char*)header + kHeaderBytes;
+}
+
+//
+// Free
+//
+void PhysicsPool::Free(void* mem)
+{
+	if (!mem)
+		return;
+
+	BlockHeader* header = (BlockHeader*)((char*)mem - kHeaderBytes);
+	header->pool->Release(header, header->size_class, header->size);
+}
+
+//
+// stats
+//
+PhysicsPoolStats PhysicsPool::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+//
+// Current
+//
+PhysicsPool* PhysicsPool::Current()
+{
+	return current_pool ? current_pool : &SharedPool();
+}
+
+//
+// Release
+//
+void PhysicsPool::Release(void* block, unsigned int size_class, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_.frees++;
+	stats_.live_bytes -= size;
+
+	if (size_class == kLargeClass)
+	{
+		stats_.system_bytes -= kHeaderBytes + size;
+		free(block);
+		return;
+	}
+
+	FreeBlock* freeBlock = (FreeBlock*)block;
+	freeBlock->next = free_[size_class];
+	free_[size_class] = freeBlock;
+}
+
+//
+// CountAllocation
+//
+void PhysicsPool::CountAllocation(size_t size)
+{
+	// called with the lock held
+	stats_.allocations++;
+	stats_.live_bytes += size;
+	if (stats_.live_bytes > stats_.peak_bytes)
+		stats_.peak_bytes = stats_.live_bytes;
+}
+
+//
+// Refill
+//
+bool PhysicsPool::Refill(unsigned int size_class)
+{
+	// called with the lock held
+	size_t blockBytes = kHeaderBytes + ClassBytes(size_class);
+	size_t count = kSlabBytes / blockBytes;
+	if (count < kMinSlabBlocks)
+		count = kMinSlabBlocks;
+
+	size_t slabBytes = kHeaderBytes + count * blockBytes;
+	Slab* slab = (Slab*)malloc(slabBytes);
+	if (!slab)
+		return false;
+
+	slab->next = slabs_;
+	slabs_ = slab;
+	stats_.system_bytes += slabBytes;
+
+	// carve the slab up back to front, so blocks are handed out in address order
+	char* blocks = (char*)slab + kHeaderBytes;
+	for (size_t i = count; i > 0; i--)
+	{
+		FreeBlock* block = (FreeBlock*)(blocks + (i - 1) * blockBytes);
+		block->next = free_[size_class];
+		free_[size_class] = block;
+	}
+	return true;
+}
+
+//
+// PhysicsPoolScope
+//
+PhysicsPoolScope::PhysicsPoolScope(PhysicsPool* pool) :
+	previous_(current_pool)
+{
+	current_pool = pool;
+}
+
+//
+// ~PhysicsPoolScope
+//
+PhysicsPoolScope::~PhysicsPoolScope()
+{
+	current_pool = previous_;
+}
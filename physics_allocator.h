@@ -0,0 +1,89 @@
+#ifndef _PHYSICS_ALLOCATOR_H
+#define _PHYSICS_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+
+struct PhysicsPoolStats
+{
+	// calls since the pool was made, and how many of them a size class served
+	uint64_t allocations;
+	uint64_t frees;
+	uint64_t pooled;
+
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+
+	// taken from the system for slabs and for requests too large for any size class
+	uint64_t system_bytes;
+};
+
+// Size-class pools behind Box2D's b2Alloc and b2Free. Each world gets a pool of its own by
+// opening a PhysicsPoolScope around the calls that create bodies, fixtures and joints or step
+// the world, and anything Box2D allocates on that thread meanwhile comes from that pool.
+// Allocations outside any scope come from one shared pool. Every block records the pool it
+// came from, so b2Free may be called from anywhere. A pool locks only itself, so worlds on
+// different threads never wait on each other.
+class PhysicsPool
+{
+public:
+	PhysicsPool();
+
+	/// @brief Default destructor. Frees every slab, the world using the pool must be gone first.
+	~PhysicsPool();
+
+	void* Allocate(size_t size);
+
+	/// @brief Returns a block to the pool it came from.
+	static void Free(void* mem);
+
+	PhysicsPoolStats stats() const;
+
+	/// @return The pool b2Alloc uses on this thread
+	static PhysicsPool* Current();
+
+	// smallest and largest size classes, a class for each power of two between
+	static const size_t kMinClassBytes = 64;
+	static const size_t kMaxClassBytes = 16 * 1024;
+	static const unsigned int kClassCount = 9;
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	struct Slab
+	{
+		Slab* next;
+	};
+
+	PhysicsPool(const PhysicsPool&);
+	PhysicsPool& operator=(const PhysicsPool&);
+
+	void Release(void* block, unsigned int size_class, size_t size);
+	void CountAllocation(size_t size);
+	bool Refill(unsigned int size_class);
+
+	mutable std::mutex mutex_;
+	FreeBlock* free_[kClassCount];
+	Slab* slabs_;
+	PhysicsPoolStats stats_;
+};
+
+// Routes b2Alloc on the calling thread to a pool until it goes out of scope. Scopes nest.
+class PhysicsPoolScope
+{
+public:
+	explicit PhysicsPoolScope(PhysicsPool* pool);
+	~PhysicsPoolScope();
+
+private:
+	PhysicsPoolScope(const PhysicsPoolScope&);
+	PhysicsPoolScope& operator=(const PhysicsPoolScope&);
+
+	PhysicsPool* previous_;
+};
+
+#endif // _PHYSICS_ALLOCATOR_H
@@ -0,0 +1,197 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "profiler.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct TraceEvent
+	{
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> start_ns;
+		std::atomic<uint64_t> end_ns;
+	};
+
+	// written only by its own thread, events_written counts every event ever recorded
+	struct ThreadTrace
+	{
+		unsigned int id;
+		char name[32];
+		std::atomic<uint32_t> events_written;
+		TraceEvent events[Profiler::kEventsPerThread];
+	};
+
+	struct Registry
+	{
+		Registry() : count(0) {}
+		~Registry()
+		{
+			for (unsigned int i = 0; i < count; i++)
+				delete traces[i];
+		}
+
+		std::mutex mutex;
+		ThreadTrace* traces[Profiler::kMaxThreads];
+		unsigned int count;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadTrace* thread_trace = NULL;
+	thread_local bool thread_refused = false;
+
+	ThreadTrace* AttachThread()
+	{
+		if (thread_refused)
+			return NULL;
+
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		if (registry.count == Profiler::kMaxThreads)
+		{
+			thread_refused = true;
+			return NULL;
+		}
+
+		ThreadTrace* trace = new ThreadTrace;
+		trace->id = registry.count + 1;
+		sprintf(trace->name, "thread %u", trace->id);
+		trace->events_written.store(0);
+		registry.traces[registry.count++] = trace;
+		thread_trace = trace;
+		return trace;
+	}
+
+	struct CopiedEvent
+	{
+		unsigned int thread;
+		const char* name;
+		uint64_t start_ns;
+		uint64_t end_ns;
+	};
+}
+
+//
+// SetThreadName
+//
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadTrace* trace = thread_trace ? thread_trace : AttachThread();
+	if (!trace)
+		return;
+
+	std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+	strncpy(trace->name, name, sizeof(trace->name) - 1);
+	trace->name[sizeof(trace->name) - 1] = '\0';
+}
+
+//
+// Record
+//
+void Profiler::Record(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+	ThreadTrace* trace = thread_trace ? thread_trace : AttachThread();
+	if (!trace)
+		return;
+
+	// the count is published ahead of the slot being reused, so Dump can tell when it read a slot mid-write
+	uint32_t index = trace->events_written.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	TraceEvent& event = trace->events[index % kEventsPerThread];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start_ns.store(start_ns, std::memory_order_relaxed);
+	event.end_ns.store(end_ns, std::memory_order_relaxed);
+	trace->events_written.store(index + 1, std::memory_order_release);
+}
+
+//
+// Dump
+//
+bool Profiler::Dump(const char* filename)
+{
+	std::vector<CopiedEvent> events;
+	std::vector<std::pair<unsigned int, std::string> > names;
+
+	Registry& registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (unsigned int i = 0; i < registry.count; i++)
+		{
+			ThreadTrace* trace = registry.traces[i];
+			names.push_back(std::make_pair(trace->id, std::string(trace->name)));
+
+			uint32_t end = trace->events_written.load(std::memory_order_acquire);
+			uint32_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+			size_t first = events.size();
+			for (uint32_t index = begin; index < end; index++)
+			{
+				const TraceEvent& event = trace->events[index % kEventsPerThread];
+				CopiedEvent copy;
+				copy.thread = trace->id;
+				copy.name = event.name.load(std::memory_order_relaxed);
+				copy.start_ns = event.start_ns.load(std::memory_order_relaxed);
+				copy.end_ns = event.end_ns.load(std::memory_order_relaxed);
+				events.push_back(copy);
+			}
+
+			// the thread kept going meanwhile, drop any slot it may have started writing over
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint32_t after = trace->events_written.load(std::memory_order_relaxed);
+			uint32_t valid = after >= kEventsPerThread ? after - kEventsPerThread + 1 : 0;
+			if (valid > begin)
+			{
+				uint32_t skip = valid - begin < end - begin ? valid - begin : end - begin;
+				events.erase(events.begin() + first, events.begin() + first + skip);
+			}
+		}
+	}
+
+	FILE* file = fopen(filename, "w");
+	if (!file)
+		return false;
+
+	uint64_t base = events.empty() ? 0 : events[0].start_ns;
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		if (events[i].start_ns < base)
+			base = events[i].start_ns;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+			names[i].first, names[i].second.c_str());
+	}
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const CopiedEvent& event = events[i];
+		fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+			event.name, event.thread, (event.start_ns - base) / 1000.0, (event.end_ns - event.start_ns) / 1000.0);
+	}
+
+	// a metadata record closes the list, so every event above can end in a comma
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"pinball\"}}\n]}\n");
+
+	bool written = !ferror(file);
+	fclose(file);
+	return written;
+}
+
+//
+// Now
+//
+uint64_t Profiler::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
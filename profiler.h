@@ -0,0 +1,69 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <stdint.h>
+
+// Define PROFILER_DISABLED to compile every PROFILE_SCOPE out.
+#if !defined(PROFILER_DISABLED)
+#define PROFILER_ENABLED
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if defined(PROFILER_ENABLED)
+// Times the rest of the enclosing block. The name must outlive the program, a string literal.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+// Keeps the most recent scopes of every thread that times any. Each thread writes a ring of
+// its own and never locks or waits, older scopes are overwritten as it goes round. Dump can
+// be called at any time from any thread, and skips whatever is overwritten while it copies.
+class Profiler
+{
+public:
+	/// @brief Names the calling thread in the trace. The name is copied.
+	static void SetThreadName(const char* name);
+
+	/// @brief Records a finished scope on the calling thread.
+	static void Record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+	/// @brief Writes every thread's scopes as Chrome trace JSON, for chrome://tracing or Perfetto.
+	/// @return false if the file could not be written
+	static bool Dump(const char* filename);
+
+	/// @return Nanoseconds on the steady clock
+	static uint64_t Now();
+
+	// about seven seconds of a busy main thread, 192KB each
+	static const unsigned int kEventsPerThread = 8192;
+
+	// threads after this many record nothing
+	static const unsigned int kMaxThreads = 32;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) :
+		name_(name),
+		start_(Profiler::Now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		Profiler::Record(name_, start_, Profiler::Now());
+	}
+
+private:
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+	const char* name_;
+	uint64_t start_;
+};
+
+#endif // _PROFILER_H
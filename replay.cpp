@@ -0,0 +1,469 @@
+#include "replay.h"
+#include "varint.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	int32_t Quantise(float value, float scale)
+	{
+		return (int32_t)floorf(value * scale + 0.5f);
+	}
+
+	void QuantiseBall(const ReplayBall& ball, int32_t* quantised)
+	{
+		quantised[0] = Quantise(ball.x, kReplayPositionScale);
+		quantised[1] = Quantise(ball.y, kReplayPositionScale);
+		quantised[2] = Quantise(ball.angle, kReplayAngleScale);
+	}
+
+	ReplayBall Dequantise(const int32_t* quantised)
+	{
+		ReplayBall ball;
+		ball.x = quantised[0] / kReplayPositionScale;
+		ball.y = quantised[1] / kReplayPositionScale;
+		ball.angle = quantised[2] / kReplayAngleScale;
+		return ball;
+	}
+
+	bool SampleBefore(const ReplaySample& sample, uint32_t step)
+	{
+		return sample.step < step;
+	}
+
+	bool InputBefore(uint32_t step, const ReplayInput& input)
+	{
+		return step < input.step;
+	}
+
+	bool BlockBefore(uint32_t step, const ReplayBlockEntry& block)
+	{
+		return step < block.first_step;
+	}
+}
+
+//
+// ReplayWriter
+//
+ReplayWriter::ReplayWriter() :
+	recording_(false),
+	seed_(0),
+	last_step_(0),
+	next_sample_(0),
+	flippers_(0),
+	block_step_(0),
+	record_step_(0)
+{
+}
+
+//
+// Begin
+//
+void ReplayWriter::Begin(uint32_t seed)
+{
+	recording_ = true;
+	seed_ = seed;
+	last_step_ = 0;
+	next_sample_ = 0;
+	flippers_ = 0;
+
+	raw_.clear();
+	block_step_ = 0;
+	record_step_ = 0;
+	previous_.clear();
+	blocks_.clear();
+	packed_.clear();
+}
+
+//
+// RecordInput
+//
+void ReplayWriter::RecordInput(uint32_t step, uint8_t flippers)
+{
+	if (!recording_ || flippers == flippers_)
+		return;
+
+	// before the first keyframe the change is carried by the keyframe itself
+	flippers_ = flippers;
+	if (raw_.empty())
+		return;
+
+	WriteTag(step, REPLAY_INPUT);
+	raw_.push_back(flippers);
+	last_step_ = std::max(last_step_, step);
+}
+
+//
+// RecordBalls
+//
+void ReplayWriter::RecordBalls(uint32_t step, const ReplayBall* balls, unsigned int count)
+{
+	if (!SampleDue(step))
+		return;
+	count = std::min(count, (unsigned int)kReplayMaxBalls);
+	next_sample_ = step + kSampleSteps;
+	last_step_ = std::max(last_step_, step);
+
+	// a ball arriving or leaving breaks the delta chain
+	if (raw_.empty() || count * 3 != previous_.size())
+	{
+		WriteKeyframe(step, balls, count);
+		return;
+	}
+
+	WriteTag(step, REPLAY_DELTA);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		int32_t quantised[3];
+		QuantiseBall(balls[i], quantised);
+		for (int j = 0; j < 3; j++)
+		{
+			WriteVarint(raw_, ZigZag(quantised[j] - previous_[i * 3 + j]));
+			previous_[i * 3 + j] = quantised[j];
+		}
+	}
+
+	// the closing sample is repeated as the next block's keyframe, so a reader can
+	// always blend between two samples without inflating a second block
+	if (step >= block_step_ + kBlockSteps)
+	{
+		CloseBlock();
+		WriteKeyframe(step, balls, count);
+	}
+}
+
+//
+// Finish
+//
+void ReplayWriter::Finish(uint32_t final_step, const LeaderboardEntry& entry, std::vector<unsigned char>& file)
+{
+	if (!raw_.empty())
+		CloseBlock();
+	recording_ = false;
+
+	ReplayHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kReplayMagic;
+	header.version = kReplayVersion;
+	header.seed = seed_;
+	header.steps_per_second = 60;
+	header.step_count = std::max(last_step_, final_step) + 1;
+	header.block_count = (uint32_t)blocks_.size();
+	memcpy(header.name, entry.name, sizeof(header.name));
+	header.score = entry.score;
+	header.entry_sequence = entry.sequence;
+
+	// block offsets were kept relative to the packed data, which follows the index
+	uint32_t dataOffset = (uint32_t)(sizeof(ReplayHeader) + blocks_.size() * sizeof(ReplayBlockEntry));
+	std::vector<ReplayBlockEntry> index(blocks_);
+	for (size_t i = 0; i < index.size(); i++)
+		index[i].offset += dataOffset;
+
+	file.resize(dataOffset + packed_.size());
+	memcpy(&file[0], &header, sizeof(header));
+	if (!index.empty())
+		memcpy(&file[sizeof(header)], &index[0], index.size() * sizeof(ReplayBlockEntry));
+	if (!packed_.empty())
+		memcpy(&file[dataOffset], &packed_[0], packed_.size());
+}
+
+//
+// packed_bytes
+//
+size_t ReplayWriter::packed_bytes() const
+{
+	return packed_.size() + blocks_.size() * sizeof(ReplayBlockEntry) + sizeof(ReplayHeader);
+}
+
+//
+// WriteKeyframe
+//
+void ReplayWriter::WriteKeyframe(uint32_t step, const ReplayBall* balls, unsigned int count)
+{
+	if (raw_.empty())
+	{
+		block_step_ = step;
+		record_step_ = step;
+	}
+
+	WriteTag(step, REPLAY_KEYFRAME);
+	raw_.push_back(flippers_);
+	WriteVarint(raw_, count);
+
+	previous_.resize(count * 3);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		QuantiseBall(balls[i], &previous_[i * 3]);
+		for (int j = 0; j < 3; j++)
+			WriteVarint(raw_, ZigZag(previous_[i * 3 + j]));
+	}
+}
+
+//
+// WriteTag
+//
+void ReplayWriter::WriteTag(uint32_t step, REPLAY_RECORD record)
+{
+	WriteVarint(raw_, ((step - record_step_) << 2) | record);
+	record_step_ = step;
+}
+
+//
+// CloseBlock
+//
+void ReplayWriter::CloseBlock()
+{
+	ReplayBlockEntry block;
+	block.first_step = block_step_;
+	block.offset = (uint32_t)packed_.size();
+	block.raw_size = (uint32_t)raw_.size();
+
+	uLongf packedSize = compressBound((uLong)raw_.size());
+	packed_.resize(block.offset + packedSize);
+	bool packed = compress2(&packed_[block.offset], &packedSize, &raw_[0], (uLong)raw_.size(), Z_BEST_COMPRESSION) == Z_OK &&
+		packedSize < raw_.size();
+
+	// a block that does not shrink is stored as it is, which the reader spots by its size
+	if (packed)
+	{
+		packed_.resize(block.offset + packedSize);
+	}
+	else
+	{
+		packed_.resize(block.offset);
+		packed_.insert(packed_.end(), raw_.begin(), raw_.end());
+	}
+	block.packed_size = (uint32_t)(packed_.size() - block.offset);
+	blocks_.push_back(block);
+
+	raw_.clear();
+}
+
+//
+// ReplayReader
+//
+ReplayReader::ReplayReader() :
+	block_(-1)
+{
+	memset(&header_, 0, sizeof(header_));
+}
+
+//
+// Open
+//
+bool ReplayReader::Open(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	std::vector<unsigned char> data(size > 0 ? (size_t)size : 0);
+	bool read = !data.empty() && fread(&data[0], 1, data.size(), file) == data.size();
+	fclose(file);
+
+	return read && Open(&data[0], data.size());
+}
+
+//
+// Open
+//
+bool ReplayReader::Open(const unsigned char* data, size_t size)
+{
+	block_ = -1;
+	samples_.clear();
+	inputs_.clear();
+	blocks_.clear();
+
+	if (size < sizeof(ReplayHeader))
+		return false;
+	memcpy(&header_, data, sizeof(header_));
+	if (header_.magic != kReplayMagic || header_.version != kReplayVersion ||
+		sizeof(ReplayHeader) + (size_t)header_.block_count * sizeof(ReplayBlockEntry) > size)
+		return false;
+
+	blocks_.resize(header_.block_count);
+	if (!blocks_.empty())
+		memcpy(&blocks_[0], data + sizeof(ReplayHeader), blocks_.size() * sizeof(ReplayBlockEntry));
+
+	for (size_t i = 0; i < blocks_.size(); i++)
+	{
+		if ((size_t)blocks_[i].offset + blocks_[i].packed_size > size || blocks_[i].raw_size > kReplayMaxBlockBytes ||
+			(i > 0 && blocks_[i].first_step < blocks_[i - 1].first_step))
+			return false;
+	}
+
+	data_.assign(data, data + size);
+	return true;
+}
+
+//
+// GetBalls
+//
+bool ReplayReader::GetBalls(uint32_t step, std::vector<ReplayBall>& balls)
+{
+	balls.clear();
+	if (!Seek(step) || samples_.empty())
+		return false;
+
+	// the first sample at or after the step, blended with the one before it
+	std::vector<ReplaySample>::const_iterator next = std::lower_bound(samples_.begin(), samples_.end(), step, SampleBefore);
+	if (next == samples_.end())
+	{
+		// the last few steps after the final sample hold it
+		if (step >= header_.step_count)
+			return false;
+		balls = samples_.back().balls;
+		return true;
+	}
+
+	if (next->step == step || next == samples_.begin())
+	{
+		balls = next->balls;
+		return true;
+	}
+
+	const ReplaySample& previous = *(next - 1);
+	if (previous.balls.size() != next->balls.size())
+	{
+		balls = previous.balls;
+		return true;
+	}
+
+	float blend = (float)(step - previous.step) / (float)(next->step - previous.step);
+	balls.resize(next->balls.size());
+	for (size_t i = 0; i < balls.size(); i++)
+	{
+		balls[i].x = previous.balls[i].x + (next->balls[i].x - previous.balls[i].x) * blend;
+		balls[i].y = previous.balls[i].y + (next->balls[i].y - previous.balls[i].y) * blend;
+		balls[i].angle = previous.balls[i].angle + (next->balls[i].angle - previous.balls[i].angle) * blend;
+	}
+	return true;
+}
+
+//
+// GetFlippers
+//
+uint8_t ReplayReader::GetFlippers(uint32_t step)
+{
+	if (!Seek(step))
+		return 0;
+
+	std::vector<ReplayInput>::const_iterator after = std::upper_bound(inputs_.begin(), inputs_.end(), step, InputBefore);
+	return after == inputs_.begin() ? 0 : (after - 1)->flippers;
+}
+
+//
+// Seek
+//
+bool ReplayReader::Seek(uint32_t step)
+{
+	// the last block opening at or before the step
+	std::vector<ReplayBlockEntry>::const_iterator after = std::upper_bound(blocks_.begin(), blocks_.end(), step, BlockBefore);
+	if (after == blocks_.begin())
+		return false;
+
+	int block = (int)(after - blocks_.begin()) - 1;
+	return block == block_ || DecodeBlock(block);
+}
+
+//
+// DecodeBlock
+//
+bool ReplayReader::DecodeBlock(unsigned int block)
+{
+	block_ = -1;
+	samples_.clear();
+	inputs_.clear();
+
+	const ReplayBlockEntry& entry = blocks_[block];
+	std::vector<unsigned char> raw(entry.raw_size);
+	if (raw.empty())
+		return false;
+
+	if (entry.packed_size == entry.raw_size)
+	{
+		memcpy(&raw[0], &data_[entry.offset], raw.size());
+	}
+	else
+	{
+		uLongf rawSize = (uLongf)raw.size();
+		if (uncompress(&raw[0], &rawSize, &data_[entry.offset], entry.packed_size) != Z_OK || rawSize != raw.size())
+			return false;
+	}
+
+	const unsigned char* read = &raw[0];
+	const unsigned char* end = read + raw.size();
+	uint32_t step = entry.first_step;
+	uint8_t flippers = 0;
+	std::vector<int32_t> quantised;
+
+	while (read < end)
+	{
+		uint32_t tag;
+		if (!ReadVarint(read, end, tag))
+			return false;
+		step += tag >> 2;
+
+		switch (tag & 3)
+		{
+		case REPLAY_INPUT:
+		case REPLAY_KEYFRAME:
+		{
+			if (read >= end)
+				return false;
+			flippers = *read++;
+			ReplayInput input = { step, flippers };
+			inputs_.push_back(input);
+
+			if ((tag & 3) == REPLAY_INPUT)
+				break;
+
+			uint32_t count;
+			if (!ReadVarint(read, end, count) || count > kReplayMaxBalls)
+				return false;
+			quantised.resize(count * 3);
+			for (size_t i = 0; i < quantised.size(); i++)
+			{
+				uint32_t value;
+				if (!ReadVarint(read, end, value))
+					return false;
+				quantised[i] = UnZigZag(value);
+			}
+			break;
+		}
+		case REPLAY_DELTA:
+			if (samples_.empty())
+				return false;
+			for (size_t i = 0; i < quantised.size(); i++)
+			{
+				uint32_t value;
+				if (!ReadVarint(read, end, value))
+					return false;
+				quantised[i] += UnZigZag(value);
+			}
+			break;
+		default:
+			return false;
+		}
+
+		if ((tag & 3) != REPLAY_INPUT)
+		{
+			ReplaySample sample;
+			sample.step = step;
+			sample.flippers = flippers;
+			for (size_t i = 0; i + 2 < quantised.size(); i += 3)
+				sample.balls.push_back(Dequantise(&quantised[i]));
+			samples_.push_back(sample);
+		}
+	}
+
+	block_ = (int)block;
+	return true;
+}
@@ -0,0 +1,125 @@
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include "leaderboard.h"
+#include "replay_format.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct ReplayBall
+{
+	float x;
+	float y;
+	float angle;
+};
+
+struct ReplaySample
+{
+	uint32_t step;
+	uint8_t flippers;
+	std::vector<ReplayBall> balls;
+};
+
+struct ReplayInput
+{
+	uint32_t step;
+	uint8_t flippers;
+};
+
+// Records a game as flipper changes plus ball transforms every few steps, packing each block of
+// play as it closes so finishing a replay only has to join the blocks together.
+class ReplayWriter
+{
+public:
+	ReplayWriter();
+
+	/// @brief Starts a new recording, discarding the last.
+	/// @param[in] seed			The seed the game passed to std::srand.
+	void Begin(uint32_t seed);
+
+	/// @brief Records the flipper bits, stored only when they change.
+	void RecordInput(uint32_t step, uint8_t flippers);
+
+	/// @brief Check if RecordBalls wants the balls at this step.
+	inline bool SampleDue(uint32_t step) const { return recording_ && step >= next_sample_; }
+
+	/// @brief Records the ball transforms, when SampleDue.
+	void RecordBalls(uint32_t step, const ReplayBall* balls, unsigned int count);
+
+	/// @brief Stops recording and builds the replay file.
+	/// @param[in] final_step	The last step the game ran, which may be after the last sample.
+	/// @param[in] entry		The leaderboard entry the game earned.
+	/// @param[out] file		Replaced with the file's contents.
+	void Finish(uint32_t final_step, const LeaderboardEntry& entry, std::vector<unsigned char>& file);
+
+	/// @brief Get the number of bytes packed so far.
+	size_t packed_bytes() const;
+
+	inline bool recording() const { return recording_; }
+
+	// steps between ball samples, 15 a second at the game's 60 steps a second
+	static const uint32_t kSampleSteps = 4;
+
+	// steps per block, and so between keyframes a reader can seek to
+	static const uint32_t kBlockSteps = 600;
+
+private:
+	void WriteKeyframe(uint32_t step, const ReplayBall* balls, unsigned int count);
+	void WriteTag(uint32_t step, REPLAY_RECORD record);
+	void CloseBlock();
+
+	bool recording_;
+	uint32_t seed_;
+	uint32_t last_step_;
+	uint32_t next_sample_;
+	uint8_t flippers_;
+
+	// the open block, with the quantised balls the next delta is taken from
+	std::vector<unsigned char> raw_;
+	uint32_t block_step_;
+	uint32_t record_step_;
+	std::vector<int32_t> previous_;
+
+	std::vector<ReplayBlockEntry> blocks_;
+	std::vector<unsigned char> packed_;
+};
+
+// Reads a replay back, inflating one block at a time.
+class ReplayReader
+{
+public:
+	ReplayReader();
+
+	/// @brief Reads a replay file.
+	/// @return false if the file is missing or damaged
+	bool Open(const char* filename);
+
+	/// @brief Reads a replay already in memory.
+	bool Open(const unsigned char* data, size_t size);
+
+	/// @brief Gets the ball transforms at a step, blending the samples either side of it.
+	/// @return false past the end of the replay
+	/// @param[out] balls		Replaced with the transforms.
+	bool GetBalls(uint32_t step, std::vector<ReplayBall>& balls);
+
+	/// @brief Gets the flipper bits in force at a step.
+	uint8_t GetFlippers(uint32_t step);
+
+	inline const ReplayHeader& header() const { return header_; }
+
+private:
+	bool Seek(uint32_t step);
+	bool DecodeBlock(unsigned int block);
+
+	std::vector<unsigned char> data_;
+	ReplayHeader header_;
+	std::vector<ReplayBlockEntry> blocks_;
+
+	// the block currently inflated
+	int block_;
+	std::vector<ReplaySample> samples_;
+	std::vector<ReplayInput> inputs_;
+};
+
+#endif // _REPLAY_H
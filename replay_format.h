@@ -0,0 +1,62 @@
+#ifndef _REPLAY_FORMAT_H
+#define _REPLAY_FORMAT_H
+
+// Layout of a replay written by ReplayWriter.
+//
+// [ReplayHeader][ReplayBlockEntry x block_count][block 0][block 1]...
+//
+// Each block covers about ten seconds of play and is deflated on its own, so a reader can seek
+// to any point by inflating a single block. Inflated, a block is a run of records, each
+// starting with a varint tag of (steps since the previous record << 2) | REPLAY_RECORD:
+//
+// REPLAY_INPUT		the flipper bits, one byte
+// REPLAY_KEYFRAME	the flipper bits, a varint ball count, then zigzag varint x, y and angle per ball
+// REPLAY_DELTA		zigzag varint x, y and angle per ball, as differences from the last keyframe or delta
+//
+// Every block starts with a keyframe. Positions are stored in 1/256ths of a metre and angles
+// in 1/256ths of a radian. Integers are little endian.
+
+#include <stdint.h>
+
+static const uint32_t kReplayMagic = 0x314c5052;	// "RPL1"
+static const uint32_t kReplayVersion = 1;
+
+// readers refuse anything larger, so a damaged file cannot make them allocate without bound
+static const uint32_t kReplayMaxBalls = 64;
+static const uint32_t kReplayMaxBlockBytes = 1024 * 1024;
+
+static const float kReplayPositionScale = 256.f;
+static const float kReplayAngleScale = 256.f;
+
+enum REPLAY_RECORD
+{
+	REPLAY_INPUT = 0,
+	REPLAY_KEYFRAME,
+	REPLAY_DELTA,
+};
+
+struct ReplayHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	// the game's std::srand seed
+	uint32_t seed;
+	uint32_t steps_per_second;
+	uint32_t step_count;
+	uint32_t block_count;
+	// the leaderboard entry the replay belongs to
+	char name[12];
+	uint32_t score;
+	uint32_t entry_sequence;
+};
+
+struct ReplayBlockEntry
+{
+	// step of the block's opening keyframe
+	uint32_t first_step;
+	uint32_t offset;
+	uint32_t packed_size;
+	uint32_t raw_size;
+};
+
+#endif // _REPLAY_FORMAT_H
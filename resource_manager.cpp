@@ -0,0 +1,318 @@
+#include "resource_manager.h"
+#include "async_texture_loader.h"
+#include "audio_mixer.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
+#include <graphics/scene.h>
+#include <system/platform.h>
+#include <system/debug_log.h>
+#include <fstream>
+
+namespace
+{
+	size_t FileSize(const char* filename)
+	{
+		std::ifstream file(filename, std::ifstream::binary | std::ifstream::ate);
+		return file.good() ? (size_t)file.tellg() : 0;
+	}
+
+	bool ReadScene(gef::Scene* scene, gef::Platform* platform, std::string filename)
+	{
+		PROFILE_SCOPE("ReadScene");
+		AllocTagScope alloc_scope(ALLOC_RESOURCES);
+		return scene->ReadSceneFromFile(*platform, filename.c_str());
+	}
+}
+
+//
+// ResourceManager
+//
+ResourceManager::ResourceManager(gef::Platform& platform, AudioMixer* mixer, AsyncTextureLoader* texture_loader, size_t budget_bytes) :
+	platform_(platform),
+	mixer_(mixer),
+	texture_loader_(texture_loader),
+	budget_bytes_(budget_bytes),
+	resident_bytes_(0),
+	use_counter_(0),
+	disk_loads_(0)
+{
+}
+
+//
+// ~ResourceManager
+//
+ResourceManager::~ResourceManager()
+{
+	for (size_t i = 0; i < resources_.size(); i++)
+	{
+		Unload(*resources_[i]);
+		delete resources_[i];
+	}
+	resources_.clear();
+}
+
+//
+// AcquireTexture
+//
+TextureHandle* ResourceManager::AcquireTexture(const char* filename)
+{
+	Resource* resource = Load(RES_TEXTURE, filename);
+	resource->refs++;
+	return resource->texture;
+}
+
+//
+// AcquireScene
+//
+gef::Scene* ResourceManager::AcquireScene(const char* filename)
+{
+	Resource* resource = Load(RES_SCENE, filename);
+	resource->refs++;
+
+	// a prefetch still in flight is waited on rather than read twice
+	FinishScene(*resource);
+	return resource->scene;
+}
+
+//
+// AcquireSample
+//
+int ResourceManager::AcquireSample(const char* filename)
+{
+	Resource* resource = Load(RES_SAMPLE, filename);
+	resource->refs++;
+	return resource->sample;
+}
+
+//
+// Release
+//
+void ResourceManager::Release(const char* filename)
+{
+	Resource* resource = Find(filename);
+	if (resource && resource->refs > 0)
+	{
+		resource->refs--;
+		resource->last_used = ++use_counter_;
+	}
+}
+
+//
+// IsReady
+//
+bool ResourceManager::IsReady(const char* filename)
+{
+	Resource* resource = Find(filename);
+	if (!resource)
+		return false;
+
+	switch (resource->type)
+	{
+	case RES_TEXTURE:
+		return resource->texture && resource->texture->ready();
+	case RES_SCENE:
+		return resource->scene_ready;
+	default:
+		return true;
+	}
+}
+
+//
+// SetResidency
+//
+void ResourceManager::SetResidency(const ResourceDesc* current, int current_count, const ResourceDesc* next, int next_count)
+{
+	for (size_t i = 0; i < resources_.size(); i++)
+	{
+		resources_[i]->pinned = false;
+	}
+
+	for (int i = 0; i < current_count; i++)
+	{
+		Load(current[i].type, current[i].filename)->pinned = true;
+	}
+
+	// start loading the likely next state now so its transition finds everything resident
+	for (int i = 0; i < next_count; i++)
+	{
+		Load(next[i].type, next[i].filename)->pinned = true;
+	}
+
+	Trim();
+}
+
+//
+// Update
+//
+void ResourceManager::Update()
+{
+	resident_bytes_ = 0;
+	for (size_t i = 0; i < resources_.size(); i++)
+	{
+		Resource& resource = *resources_[i];
+
+		// finish prefetched scenes on the main thread once the file has been read
+		if (resource.type == RES_SCENE && !resource.scene_ready && resource.scene_read.valid() &&
+			resource.scene_read.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			FinishScene(resource);
+		}
+
+		if (resource.type == RES_TEXTURE && resource.texture)
+		{
+			resource.bytes = resource.texture->size_bytes();
+		}
+
+		resident_bytes_ += resource.bytes;
+	}
+
+	if (resident_bytes_ > budget_bytes_)
+	{
+		Trim();
+	}
+}
+
+//
+// Find
+//
+ResourceManager::Resource* ResourceManager::Find(const char* filename)
+{
+	for (size_t i = 0; i < resources_.size(); i++)
+	{
+		if (resources_[i]->filename == filename)
+			return resources_[i];
+	}
+	return NULL;
+}
+
+//
+// Load
+//
+// Return the resident resource, starting a load if it is not resident yet
+//
+ResourceManager::Resource* ResourceManager::Load(RESOURCE_TYPE type, const char* filename)
+{
+	Resource* resource = Find(filename);
+	if (resource)
+	{
+		resource->last_used = ++use_counter_;
+		return resource;
+	}
+
+	PROFILE_SCOPE("ResourceManager::Load");
+	AllocTagScope alloc_scope(ALLOC_RESOURCES);
+	resource = new Resource;
+	resource->filename = filename;
+	resource->type = type;
+	resource->refs = 0;
+	resource->pinned = false;
+	resource->last_used = ++use_counter_;
+	resource->bytes = 0;
+	resource->texture = NULL;
+	resource->scene = NULL;
+	resource->scene_ready = false;
+	resource->sample = -1;
+
+	switch (type)
+	{
+	case RES_TEXTURE:
+		resource->texture = texture_loader_->Load(filename);
+		break;
+	case RES_SCENE:
+		// the file is parsed in the background; GPU resources are created by FinishScene
+		resource->scene = new gef::Scene();
+		resource->bytes = FileSize(filename);
+		resource->scene_read = std::async(std::launch::async, ReadScene, resource->scene, &platform_, resource->filename).share();
+		break;
+	case RES_SAMPLE:
+		resource->sample = mixer_->LoadSample(filename);
+		resource->bytes = resource->sample != -1 && mixer_->sample_bytes(resource->sample) ? mixer_->sample_bytes(resource->sample) : FileSize(filename);
+		break;
+	default:
+		break;
+	}
+
+	disk_loads_++;
+	resources_.push_back(resource);
+	return resource;
+}
+
+//
+// FinishScene
+//
+void ResourceManager::FinishScene(Resource& resource)
+{
+	if (resource.type != RES_SCENE || resource.scene_ready || !resource.scene_read.valid())
+		return;
+
+	PROFILE_SCOPE("FinishScene");
+	AllocTagScope alloc_scope(ALLOC_RESOURCES);
+
+	if (resource.scene_read.get())
+	{
+		resource.scene->CreateMaterials(platform_);
+		resource.scene->CreateMeshes(platform_);
+	}
+	else
+	{
+		gef::DebugOut("Scene file %s failed to load\n", resource.filename.c_str());
+		delete resource.scene;
+		resource.scene = NULL;
+	}
+
+	resource.scene_read = std::shared_future<bool>();
+	resource.scene_ready = true;
+}
+
+//
+// Unload
+//
+void ResourceManager::Unload(Resource& resource)
+{
+	switch (resource.type)
+	{
+	case RES_TEXTURE:
+		texture_loader_->Release(resource.texture);
+		resource.texture = NULL;
+		break;
+	case RES_SCENE:
+		if (resource.scene_read.valid())
+			resource.scene_read.wait();
+		delete resource.scene;
+		resource.scene = NULL;
+		break;
+	case RES_SAMPLE:
+		// mixer sample indices are handed out for good, so samples stay resident
+	default:
+		break;
+	}
+}
+
+//
+// Trim
+//
+// Evict the least recently used unreferenced resources until under budget
+//
+void ResourceManager::Trim()
+{
+	while (resident_bytes_ > budget_bytes_)
+	{
+		int victim = -1;
+		for (size_t i = 0; i < resources_.size(); i++)
+		{
+			const Resource& resource = *resources_[i];
+			if (resource.refs > 0 || resource.pinned || resource.type == RES_SAMPLE)
+				continue;
+			if (victim == -1 || resource.last_used < resources_[victim]->last_used)
+				victim = (int)i;
+		}
+
+		if (victim == -1)
+			break;
+
+		resident_bytes_ -= resources_[victim]->bytes;
+		Unload(*resources_[victim]);
+		delete resources_[victim];
+		resources_.erase(resources_.begin() + victim);
+	}
+}
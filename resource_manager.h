@@ -0,0 +1,108 @@
+#ifndef _RESOURCE_MANAGER_H
+#define _RESOURCE_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <future>
+
+// FRAMEWORK FORWARD DECLARATIONS
+namespace gef
+{
+	class Platform;
+	class Scene;
+}
+
+class AsyncTextureLoader;
+class AudioMixer;
+class TextureHandle;
+
+enum RESOURCE_TYPE { RES_TEXTURE, RES_SCENE, RES_SAMPLE };
+
+struct ResourceDesc
+{
+	RESOURCE_TYPE type;
+	const char* filename;
+};
+
+class ResourceManager
+{
+public:
+	/// @brief Constructor.
+	/// @param[in] platform		The platform resources are created on.
+	/// @param[in] mixer		The mixer samples are loaded into.
+	/// @param[in] texture_loader	The loader used to decode textures in the background.
+	/// @param[in] budget_bytes	The size unreferenced resources are trimmed down to.
+	ResourceManager(gef::Platform& platform, AudioMixer* mixer, AsyncTextureLoader* texture_loader, size_t budget_bytes);
+
+	/// @brief Default destructor. Frees every resident resource.
+	~ResourceManager();
+
+	/// @brief Adds a reference to a texture, loading it if it is not resident.
+	/// @return The texture handle, which may still be resolving to a placeholder
+	TextureHandle* AcquireTexture(const char* filename);
+
+	/// @brief Adds a reference to a scene, loading it if it is not resident.
+	/// @return The scene with materials and meshes created, or NULL if it failed to load
+	gef::Scene* AcquireScene(const char* filename);
+
+	/// @brief Adds a reference to an audio sample, loading it if it is not resident.
+	/// @return The sample index, or -1 if it failed to load
+	int AcquireSample(const char* filename);
+
+	/// @brief Drops a reference. The resource stays resident until it is trimmed.
+	void Release(const char* filename);
+
+	/// @brief Checks, without waiting, whether a resource is resident and finished loading.
+	bool IsReady(const char* filename);
+
+	/// @brief Pins the resources a state uses and prefetches those of the state likely to follow.
+	/// @param[in] current		Resources of the state being entered.
+	/// @param[in] current_count	Number of entries in current.
+	/// @param[in] next			Resources of the likely next state.
+	/// @param[in] next_count	Number of entries in next.
+	void SetResidency(const ResourceDesc* current, int current_count, const ResourceDesc* next, int next_count);
+
+	/// @brief Finishes prefetched scenes and trims to the memory budget. Call once per frame.
+	void Update();
+
+	/// @brief Get the approximate size of everything resident.
+	inline size_t resident_bytes() const { return resident_bytes_; }
+
+	/// @brief Get the number of files read from disk since creation.
+	inline unsigned int disk_loads() const { return disk_loads_; }
+
+private:
+	struct Resource
+	{
+		std::string filename;
+		RESOURCE_TYPE type;
+		int refs;
+		bool pinned;
+		unsigned int last_used;
+		size_t bytes;
+
+		TextureHandle* texture;
+		gef::Scene* scene;
+		bool scene_ready;
+		std::shared_future<bool> scene_read;
+		int sample;
+	};
+
+	Resource* Find(const char* filename);
+	Resource* Load(RESOURCE_TYPE type, const char* filename);
+	void FinishScene(Resource& resource);
+	void Unload(Resource& resource);
+	void Trim();
+
+	gef::Platform& platform_;
+	AudioMixer* mixer_;
+	AsyncTextureLoader* texture_loader_;
+
+	std::vector<Resource*> resources_;
+	size_t budget_bytes_;
+	size_t resident_bytes_;
+	unsigned int use_counter_;
+	unsigned int disk_loads_;
+};
+
+#endif // _RESOURCE_MANAGER_H
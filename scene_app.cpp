@@ -9,6 +9,104 @@
 #include <input/sony_controller_input_manager.h>
 #include <graphics/sprite.h>
 #include "load_texture.h"
+#include <ctime>
+
+namespace
+{
+	const char* kAssetPackFile = "assets.pak";
+	const char* kScoresFile = "scores.dat";
+	const char* kLegacyScoresFile = "scores.txt";
+	const char* kSyncConfigFile = "leaderboard_sync.txt";
+	const char* kSyncSpoolFile = "leaderboard_sync.pending";
+	const char* kReplayFileFormat = "replay_%08u.rpl";
+	const char* kLatencyFile = "flipper_latency.csv";
+	const char* kTraceFile = "frame_trace.json";
+	const bool kSaveReplays = true;
+
+	// white at about a third opacity, so the real ball always reads first
+	const UInt32 kGhostColour = 0x55ffffff;
+
+	// holds everything one game allocates, three three-minute ghosts take about 60KB of it
+	const size_t kGameArenaBytes = 256 * 1024;
+	const unsigned int kLeaderboardRows = 10;
+	const char* kBoardSceneFile = "pinballFrame.scn";
+	const char* kSpaceBGFile = "spacedust.png";
+	const char* kSimpleBGFile = "simplebg.png";
+	// the mixer loads the decoded .wav next to each, the Ogg is only played natively without it
+	const char* kSoundFXFiles[3] = { "highSFX.ogg", "mediumSFX.ogg", "lowSFX.ogg" };
+	const char* kMusicFiles[3] = { "Beauty-Flow.wav", "EDM-Detection-Mode.wav", "Inspired.wav" };
+
+#if defined(TEXTURE_LOAD_BENCH)
+	// every texture the game loads, timed at startup
+	const char* kBenchTextureFiles[] = { "spacedust.png", "simplebg.png", "playstation-cross-dark-icon.png", "playstation-square-dark-icon.png",
+		"playstation-circle-dark-icon.png", "playstation-triangle-dark-icon.png", "logo.png", "comic_sans_0.png" };
+	const int kTextureBenchIterations = 10;
+#endif
+
+	// scoring contacts, the rarer the contact the more it deserves a voice
+	const int kBarrierPriority = 2;
+	const int kBumperPriority = 1;
+	const int kFlipperPriority = 0;
+	const int kSampleVoices = 8;
+
+	// points for each kind of contact
+	const int kBarrierPoints = 25;
+	const int kBumperPoints = 15;
+	const int kFlipperPoints = 10;
+
+	// the round bumpers, the three up the table kick harder than the pair beside the flippers
+	struct BumperDesc
+	{
+		float x, y;
+		float radius;
+		float restitution;
+	};
+	const BumperDesc kBumpers[] =
+	{
+		{ 0.f, 13.5f, 1.5f, 1.2f },
+		{ -4.5f, 10.f, 1.5f, 1.2f },
+		{ 4.5f, 10.f, 1.5f, 1.2f },
+		{ -8.f, -19.3f, 2.5f, 0.4f },
+		{ 8.f, -19.3f, 2.5f, 0.4f },
+	};
+
+	// resources each state needs resident, used to pin the current state and prefetch the next
+	const ResourceDesc kMenuResources[] = { { RES_TEXTURE, kSimpleBGFile } };
+	const ResourceDesc kGameResources[] = { { RES_SCENE, kBoardSceneFile }, { RES_TEXTURE, kSpaceBGFile } };
+	const ResourceDesc kGameOverResources[] = { { RES_TEXTURE, kSpaceBGFile }, { RES_TEXTURE, kSimpleBGFile } };
+
+	// roughly enough for the board scene and both backgrounds to stay resident together
+	const size_t kResourceBudget = 64 * 1024 * 1024;
+
+	// audio, music and texture decode keep threads of their own, so only a few cores go to frame jobs
+	const unsigned int kMaxJobWorkers = 3;
+
+	// pieces GameBuildStep builds the table in
+	const int kTableBuildSteps = 4;
+
+	// either button of a pair drives its flippers, and they stay up while either is held
+	const uint32_t kLeftFlipperButtons = gef_SONY_CTRL_SQUARE | gef_SONY_CTRL_L1;
+	const uint32_t kRightFlipperButtons = gef_SONY_CTRL_CIRCLE | gef_SONY_CTRL_R1;
+	const float kFlipperSpeed = 1000.f;
+
+	// joint angle change, in radians, that counts as a flipper having moved
+	const float kFlipperMotionAngle = 0.001f;
+}
+
+// in GAMESTATE order
+const SceneApp::StateDesc SceneApp::kStates[] =
+{
+	{ "INIT", kMenuResources, 1, MENU, &SceneApp::IntervalUpdate, &SceneApp::IntervalRender },
+	{ "MENU", kMenuResources, 1, INGAME, &SceneApp::FrontendUpdate, &SceneApp::FrontendRender },
+	{ "OPTIONS", kMenuResources, 1, MENU, &SceneApp::OptionsUpdate, &SceneApp::OptionsRender },
+	{ "CREDITS", kMenuResources, 1, MENU, &SceneApp::CreditsUpdate, &SceneApp::CreditsRender },
+	{ "INGAME", kGameResources, 2, GAMEOVER, &SceneApp::GameUpdate, &SceneApp::GameRender },
+	{ "PAUSE", kGameResources, 2, INGAME, &SceneApp::GameUpdate, &SceneApp::GameRender },
+	{ "GAMEOVER", kGameOverResources, 2, LEADERBOARD, &SceneApp::IntervalUpdate, &SceneApp::IntervalRender },
+	{ "NEWSCORE", kGameOverResources, 2, LEADERBOARD, &SceneApp::IntervalUpdate, &SceneApp::IntervalRender },
+	{ "LEADERBOARD", kGameOverResources, 2, MENU, &SceneApp::IntervalUpdate, &SceneApp::IntervalRender },
+	{ "EXIT", NULL, 0, EXIT, &SceneApp::IntervalUpdate, &SceneApp::IntervalRender },
+};
 
 SceneApp::SceneApp(gef::Platform& platform) :
 	Application(platform),
@@ -17,19 +115,78 @@ SceneApp::SceneApp(gef::Platform& platform) :
 	primitive_builder_(NULL),
 	input_manager_(NULL),
 	font_(NULL),
+	flipperButtons(0),
 	world_(NULL),
-	crossButton(NULL),
-	squareButton(NULL),
-	circleButton(NULL),
-	triangleButton(NULL)
+	running(true),
+	allocBudget(false),
+	texture_loader_(NULL),
+	simpleBG(NULL),
+	resource_manager_(NULL),
+	ui_atlas_(NULL),
+	voice_backend_(NULL),
+	mixer_(NULL),
+	audio_output_(NULL),
+	audio_thread_(NULL),
+	music_(NULL),
+	job_system_(NULL),
+	crossButton(-1),
+	squareButton(-1),
+	circleButton(-1),
+	triangleButton(-1),
+	logo(-1),
+	spaceBG(NULL),
+	lastRank(-1),
+	score_store_(kScoresFile, kLegacyScoresFile),
+	leaderboard_sync_(NULL),
+	simStep(0),
+	tableBuildStep(0),
+	game_frame_time_(0.f),
+	game_arena_(kGameArenaBytes),
+	ghost_mesh_(NULL),
+	physicsStepMs(0.f),
+	meshDraws(0),
+	lastPhysicsAllocations(0)
 {
+	static_assert(sizeof(kStates) / sizeof(kStates[0]) == EXIT + 1, "kStates needs an entry for every GAMESTATE");
+	static_assert(EXIT < AllocTracker::kMaxPhases, "every GAMESTATE needs an allocation phase");
+
+	for (int state = 0; state <= EXIT; state++)
+	{
+		stateLeft[state] = false;
+		for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++)
+		{
+			stateLiveBytes[state][tag] = 0;
+		}
+	}
+
 	lives = 3;
+	flipperAngles[0] = flipperAngles[1] = 0.f;
+	for (int i = 0; i < kGhostCount; i++)
+	{
+		ghost_ball_count_[i] = 0;
+	}
 }
 
 
 void SceneApp::Init()
 {
+	Profiler::SetThreadName("main");
+	AllocTracker::SetFrameThread();
+
 	sprite_renderer_ = gef::SpriteRenderer::Create(platform_);
+
+	// loaders fall back to the loose files in media/ when there is no pack
+	if (asset_pack_.Open(kAssetPackFile))
+	{
+		gef::DebugOut("Asset pack %s mapped\n", kAssetPackFile);
+		SetBakedTexturePack(&asset_pack_);
+	}
+
+#if defined(TEXTURE_LOAD_BENCH)
+	BenchTextureLoads(kBenchTextureFiles, sizeof(kBenchTextureFiles) / sizeof(kBenchTextureFiles[0]), platform_, kTextureBenchIterations);
+#endif
+
+	InitAtlas();
 	InitFont();
 
 	// initialise input manager
@@ -37,14 +194,41 @@ void SceneApp::Init()
 
 	audio_manager_ = gef::AudioManager::Create();
 
+	voice_backend_ = new GefVoiceBackend(platform_, audio_manager_);
+	mixer_ = new AudioMixer(kSampleVoices, voice_backend_);
+	if (asset_pack_.is_open())
+		mixer_->SetSamplePack(&asset_pack_);
+	music_ = new MusicStream();
+	mixer_->SetMusic(music_);
+	audio_thread_ = new AudioThread(mixer_, music_);
+	audio_output_ = new AudioOutput(mixer_);
+	if (!audio_output_->Open())
+	{
+		gef::DebugOut("Audio output unavailable, playing without the software mix\n");
+	}
+
 	LoadScores();
 
-	spaceBG = CreateTextureFromPNG("spacedust.png", platform_);
-	simpleBG = CreateTextureFromPNG("simplebg.png", platform_);
+	leaderboard_sync_ = LeaderboardSync::CreateFromConfig(kSyncConfigFile, kSyncSpoolFile);
+	if (leaderboard_sync_)
+	{
+		gef::DebugOut("Sharing scores as configured in %s\n", kSyncConfigFile);
+	}
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	unsigned int workers = cores > 1 ? cores - 1 : 0;
+	job_system_ = new JobSystem(workers < kMaxJobWorkers ? workers : kMaxJobWorkers);
+	InitGameFrame();
 
-	soundFX[0] = audio_manager_->LoadSample("highSFX.ogg", platform_);
-	soundFX[1] = audio_manager_->LoadSample("mediumSFX.ogg", platform_);
-	soundFX[2] = audio_manager_->LoadSample("lowSFX.ogg", platform_);
+	texture_loader_ = new AsyncTextureLoader(platform_);
+	resource_manager_ = new ResourceManager(platform_, mixer_, texture_loader_, kResourceBudget);
+	spaceBG = resource_manager_->AcquireTexture(kSpaceBGFile);
+	simpleBG = resource_manager_->AcquireTexture(kSimpleBGFile);
+
+	for (int i = 0; i < 3; i++)
+	{
+		soundFX[i] = resource_manager_->AcquireSample(kSoundFXFiles[i]);
+	}
 
 	for (int i = 0; i < 26; i++)
 	{
@@ -58,113 +242,284 @@ void SceneApp::Init()
 	soundVol = 7;
 	musicVol = 7;
 
-	gameState = INIT;
+	ChangeState(INIT);
+	residentState = EXIT;
 	IntervalInit();
 }
 
 void SceneApp::CleanUp()
 {
+	GameDestroy();
+
+	// finish writing any scores still queued, and give the venue server one last chance at them
+	score_store_.Flush();
+	delete leaderboard_sync_;
+	leaderboard_sync_ = NULL;
+
+	delete job_system_;
+	job_system_ = NULL;
+
 	delete input_manager_;
 	input_manager_ = NULL;
 
 	CleanUpFont();
 
+	delete ui_atlas_;
+	ui_atlas_ = NULL;
+
+	resource_manager_->Release(kSpaceBGFile);
+	spaceBG = NULL;
+	resource_manager_->Release(kSimpleBGFile);
+	simpleBG = NULL;
+	delete resource_manager_;
+	resource_manager_ = NULL;
+	delete texture_loader_;
+	texture_loader_ = NULL;
+
+	delete audio_output_;
+	audio_output_ = NULL;
+	delete audio_thread_;
+	audio_thread_ = NULL;
+	delete mixer_;
+	mixer_ = NULL;
+	delete music_;
+	music_ = NULL;
+	delete voice_backend_;
+	voice_backend_ = NULL;
+
 	delete sprite_renderer_;
 	sprite_renderer_ = NULL;
+
+	SetBakedTexturePack(NULL);
+	asset_pack_.Close();
 }
 
 bool SceneApp::Update(float frame_time)
 {
+	PROFILE_SCOPE("SceneApp::Update");
+
+	// the frame ending here is the one just drawn
+	CountFrame(frame_time);
+	if (allocBudget)
+	{
+		CheckFrameBudget();
+	}
+	AllocTracker::BeginFrame();
+
 	fps_ = 1.0f / frame_time;
 
 	input_manager_->Update();
+	const gef::SonyController* controller = input_manager_->controller_input()->GetController(0);
+	input_events_.Capture(controller->buttons_down(), InputEventQueue::Now());
 
-	switch (gameState)
+	// START with left held on the d-pad writes the last few seconds of every thread's timings, with
+	// right it turns the allocation budget on or off, and alone it shows or hides the performance
+	// overlay. The shoulder buttons work the flippers, so they are kept out of it.
+	if ((controller->buttons_pressed() & gef_SONY_CTRL_START) && (controller->buttons_down() & gef_SONY_CTRL_LEFT))
 	{
-	case INIT:
-		IntervalUpdate(frame_time);
-		break;
-	case MENU:
-		FrontendUpdate(frame_time);
-		break;
-	case OPTIONS:
-		OptionsUpdate(frame_time);
-		break;
-	case CREDITS:
-		CreditsUpdate(frame_time);
-		break;
-	case INGAME:
-	case PAUSE:
-		GameUpdate(frame_time);
-		break;
-	case GAMEOVER:
-	case NEWSCORE:
-	case LEADERBOARD:
-	case EXIT:
-		return IntervalUpdate(frame_time);
-		break;
-	default:
-		break;
+		if (Profiler::Dump(kTraceFile))
+		{
+			gef::DebugOut("Trace written to %s\n", kTraceFile);
+		}
+	}
+	else if ((controller->buttons_pressed() & gef_SONY_CTRL_START) && (controller->buttons_down() & gef_SONY_CTRL_RIGHT))
+	{
+		allocBudget = !allocBudget;
+		gef::DebugOut("Allocation budget %s\n", allocBudget ? "on" : "off");
+	}
+	else if (controller->buttons_pressed() & gef_SONY_CTRL_START)
+	{
+		perf_overlay_.set_visible(!perf_overlay_.visible());
 	}
 
-	gef::VolumeInfo vol;
-	for (int i = 0; i < 3; i++)
+	// finish uploading any textures decoded in the background
+	texture_loader_->Update(2.f);
+	UpdateResidency();
+	resource_manager_->Update();
+	PrepareState(kStates[gameState].next);
+
+	(this->*kStates[gameState].update)(frame_time);
+
+	// only the game takes input events, the menus read the controller directly
+	if (gameState != INGAME && gameState != PAUSE)
 	{
-		audio_manager_->GetSampleVoiceVolumeInfo(i, vol);
-		vol.volume = soundVol*10;
-		audio_manager_->SetSampleVoiceVolumeInfo(i, vol);
+		input_events_.Discard();
 	}
-	audio_manager_->GetMusicVolumeInfo(vol);
-	vol.volume = musicVol*10;
-	audio_manager_->SetMusicVolumeInfo(vol);
 
-	return true;
+	// only queued when the options menu changed a volume
+	audio_thread_->SetBusGain(BUS_SFX, soundVol / 10.f);
+	audio_thread_->SetBusGain(BUS_MUSIC, musicVol / 10.f);
+
+	return running;
 }
 
 void SceneApp::Render()
 {
-	switch (gameState)
 	{
-	case SceneApp::INIT:
-		IntervalRender();
-		break;
-	case SceneApp::MENU:
-		FrontendRender();
-		break;
-	case SceneApp::OPTIONS:
-		OptionsRender();
-		break;
-	case SceneApp::CREDITS:
-		CreditsRender();
-		break;
-	case SceneApp::INGAME:
-	case SceneApp::PAUSE:
-		GameRender();
-		break;
-	case SceneApp::GAMEOVER:
-	case SceneApp::NEWSCORE:
-	case SceneApp::LEADERBOARD:
-	case SceneApp::EXIT:
-		IntervalRender();
-		break;
-	default:
-		break;
+		PROFILE_SCOPE("SceneApp::Render");
+		meshDraws = 0;
+		(this->*kStates[gameState].render)();
+
+		if (perf_overlay_.visible())
+		{
+			sprite_renderer_->Begin(false);
+			perf_overlay_.Draw(sprite_renderer_, font_, 10.f, platform_.height() - 10.f);
+			sprite_renderer_->End();
+		}
+	}
+	flipper_latency_.Rendered(InputEventQueue::Now());
+}
+
+void SceneApp::CountFrame(float frame_time)
+{
+	// called before the frame counters are zeroed, so they cover the last Update and Render
+	FrameCounters counters;
+	counters.physics_ms = physicsStepMs;
+	counters.contacts = 0;
+	counters.awake_bodies = 0;
+	counters.mesh_draws = meshDraws;
+	counters.allocations = 0;
+	counters.physics_allocations = 0;
+
+	for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++)
+	{
+		counters.allocations += (unsigned int)AllocTracker::Frame((AllocTag)tag).allocations;
+	}
+
+	if (world_)
+	{
+		counters.contacts = world_->GetContactCount();
+		for (b2Body* body = world_->GetBodyList(); body; body = body->GetNext())
+		{
+			if (body->IsAwake() && body->GetType() != b2_staticBody)
+			{
+				counters.awake_bodies++;
+			}
+		}
+	}
+
+	// b2Alloc calls, the pool counts from when it was made
+	uint64_t allocations = physics_pool_.stats().allocations;
+	counters.physics_allocations = (unsigned int)(allocations - lastPhysicsAllocations);
+	lastPhysicsAllocations = allocations;
+
+	physicsStepMs = 0.f;
+	perf_overlay_.AddFrame(frame_time, counters);
+}
+
+void SceneApp::ChangeState(GAMESTATE state)
+{
+	for (int i = (int)stateStack.size() - 1; i >= 0; i--)
+	{
+		LeaveState(stateStack[i]);
+	}
+	stateStack.assign(1, state);
+	gameState = state;
+	AllocTracker::SetPhase(gameState);
+}
+
+void SceneApp::PushState(GAMESTATE state)
+{
+	stateStack.push_back(state);
+	gameState = state;
+	AllocTracker::SetPhase(gameState);
+}
+
+void SceneApp::PopState()
+{
+	if (stateStack.size() > 1)
+	{
+		LeaveState(stateStack.back());
+		stateStack.pop_back();
+	}
+	gameState = stateStack.back();
+	AllocTracker::SetPhase(gameState);
+}
+
+void SceneApp::LeaveState(GAMESTATE state)
+{
+	char growth[256];
+	int length = 0;
+	size_t grown = 0;
+	for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++)
+	{
+		size_t live = AllocTracker::Phase(state, (AllocTag)tag).live_bytes;
+		if (stateLeft[state] && live > stateLiveBytes[state][tag])
+		{
+			grown += live - stateLiveBytes[state][tag];
+			length += sprintf(growth + length, " %s +%u", AllocTracker::TagName((AllocTag)tag), (unsigned int)(live - stateLiveBytes[state][tag]));
+		}
+		stateLiveBytes[state][tag] = live;
+	}
+	stateLeft[state] = true;
+
+	if (grown > 0)
+	{
+		gef::DebugOut("Memory: %s left %u more bytes live than last time,%s\n", kStates[state].name, (unsigned int)grown, growth);
+	}
+}
+
+void SceneApp::CheckFrameBudget()
+{
+	char tags[256];
+	int length = 0;
+	size_t allocations = 0;
+	size_t bytes = 0;
+	for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++)
+	{
+		AllocStats frame = AllocTracker::Frame((AllocTag)tag);
+		if (frame.allocations > 0)
+		{
+			allocations += frame.allocations;
+			bytes += frame.allocated_bytes;
+			length += sprintf(tags + length, " %s %u", AllocTracker::TagName((AllocTag)tag), (unsigned int)frame.allocations);
+		}
+	}
+
+	if (allocations > 0)
+	{
+		gef::DebugOut("Budget: a %s frame allocated %u times, %u bytes,%s\n", kStates[gameState].name, (unsigned int)allocations, (unsigned int)bytes, tags);
+	}
+}
+
+void SceneApp::UpdateResidency()
+{
+	if (residentState == gameState)
+		return;
+	residentState = gameState;
+
+	// pin what this state draws and prefetch the state the player most likely goes to next
+	const StateDesc& current = kStates[gameState];
+	const StateDesc& next = kStates[current.next];
+	resource_manager_->SetResidency(current.resources, current.resource_count, next.resources, next.resource_count);
+}
+
+void SceneApp::PrepareState(GAMESTATE state)
+{
+	// nothing is set up ahead until it can be without waiting on a load
+	const StateDesc& desc = kStates[state];
+	for (int i = 0; i < desc.resource_count; i++)
+	{
+		if (!resource_manager_->IsReady(desc.resources[i].filename))
+			return;
+	}
+
+	if (state == INGAME)
+	{
+		GameBuildStep();
 	}
 }
 
 void SceneApp::InitBall()
 {
-	int vecPos = ball_vec_.size();
-	// setup the mesh for the ball
-	ball_vec_.push_back(new Ball);
-	ball_vec_[vecPos]->set_mesh(primitive_builder_->GetDefaultSphereMesh());
+	Entity ball = entities_.Create(BALL);
 
 	// create a physics body for the ball
 	b2BodyDef ball_body_def;
 	ball_body_def.type = b2_dynamicBody;
 	ball_body_def.position = b2Vec2(4.5f, 4.0f);
 
-	ball_body_vec_.push_back(world_->CreateBody(&ball_body_def));
+	b2Body* ball_body = world_->CreateBody(&ball_body_def);
 
 	// create the shape for the ball
 	b2CircleShape ball_shape;
@@ -179,36 +534,21 @@ void SceneApp::InitBall()
 	ball_fixture_def.filter.categoryBits = BALL;
 
 	// create the fixture on the rigid body
-	ball_body_vec_[vecPos]->CreateFixture(&ball_fixture_def);
+	ball_body->CreateFixture(&ball_fixture_def);
 
-	// update visuals from simulation data
-	ball_vec_[vecPos]->UpdateFromSimulation(ball_body_vec_[vecPos]);
-
-	// create a connection between the rigid body and GameObject
-	ball_body_vec_[vecPos]->SetUserData(ball_vec_[vecPos]);
+	entities_.AttachBody(ball, ball_body);
+	entities_.AttachMesh(ball, primitive_builder_->GetDefaultSphereMesh(), &primitive_builder_->green_material());
 }
 
 void SceneApp::InitBoard()
 {
-	board_.set_type(BOARD);
-	// load the assets in from the .scn
-	const char* scene_asset_filename = "pinballFrame.scn";
-	scene_assets_ = LoadSceneAssets(platform_, scene_asset_filename);
-	if (scene_assets_)
-	{
-		board_.set_mesh(GetMeshFromSceneAssets(scene_assets_));
-		gef::DebugOut("Scene file loaded!\n");
-	}
-	else
-	{
-		gef::DebugOut("Scene file %s failed to load\n", scene_asset_filename);
-	}
+	Entity board = entities_.Create(BOARD);
 
 	// create a physics body
 	b2BodyDef body_def;
 	body_def.type = b2_staticBody;
 
-	board_body_ = world_->CreateBody(&body_def);
+	b2Body* board_body = world_->CreateBody(&body_def);
 
 	// create the shape
 	b2Vec2 frameVertices[19];
@@ -242,12 +582,21 @@ void SceneApp::InitBoard()
 	fixture_def.filter.maskBits = BALL;
 	
 	// create the fixture on the rigid body
-	board_body_->CreateFixture(&fixture_def);
-	// update visuals from simulation data
-	board_.UpdateFromSimulation(board_body_);
+	board_body->CreateFixture(&fixture_def);
+	entities_.AttachBody(board, board_body);
 
-	// create a connection between the rigid body and GameObject
-	board_body_->SetUserData(&board_);
+	// the scene is normally already resident, prefetched while the menu was up
+	const char* scene_asset_filename = kBoardSceneFile;
+	scene_assets_ = resource_manager_->AcquireScene(scene_asset_filename);
+	if (scene_assets_)
+	{
+		entities_.AttachMesh(board, GetMeshFromSceneAssets(scene_assets_), NULL);
+		gef::DebugOut("Scene file loaded!\n");
+	}
+	else
+	{
+		gef::DebugOut("Scene file %s failed to load\n", scene_asset_filename);
+	}
 }
 
 void SceneApp::InitBarriers()
@@ -257,24 +606,13 @@ void SceneApp::InitBarriers()
 	// barrier dimensions
 	gef::Vector4 barrier_half_dimensions(0.4f, 0.3f, 1.0f);
 	// setup the mesh for the barrier
-	barrier_mesh_ = primitive_builder_->CreateBoxMesh(barrier_half_dimensions);
-
-	for (int i = 0; i < barrierCount; i++)
-	{
-		barrier_vec_.push_back(new Barrier);
-		barrier_vec_[i]->set_mesh(barrier_mesh_);
-	}
+	gef::Mesh* barrier_mesh = primitive_builder_->CreateBoxMesh(barrier_half_dimensions);
+	table_meshes_.push_back(barrier_mesh);
 
 	// create a physics body for the barrier
 	b2BodyDef barrier_body_def;
 	barrier_body_def.type = b2_kinematicBody;
 
-	for (int i = 0; i < barrierCount; i++)
-	{
-		barrier_body_def.position = b2Vec2((-3.0f + i*1.5f), (1.5f + (i % 2) * 1.7f));
-		barrier_body_vec_.push_back(world_->CreateBody(&barrier_body_def));
-	}
-
 	// create the shape for the barrier
 	b2PolygonShape shape;
 	shape.SetAsBox(barrier_half_dimensions.x(), barrier_half_dimensions.y());
@@ -288,119 +626,64 @@ void SceneApp::InitBarriers()
 
 	for (int i = 0; i < barrierCount; i++)
 	{
-		// create the fixture on the rigid body
-		barrier_body_vec_[i]->CreateFixture(&fixture_def);
+		Entity barrier = entities_.Create(BARRIER);
 
-		// update visuals from simulation data
-		barrier_vec_[i]->UpdateFromSimulation(barrier_body_vec_[i]);
+		barrier_body_def.position = b2Vec2((-3.0f + i*1.5f), (1.5f + (i % 2) * 1.7f));
+		b2Body* barrier_body = world_->CreateBody(&barrier_body_def);
 
-		// create a connection between the rigid body and GameObject
-		barrier_body_vec_[i]->SetUserData(barrier_vec_[i]);
+		// create the fixture on the rigid body
+		barrier_body->CreateFixture(&fixture_def);
+
+		entities_.AttachBody(barrier, barrier_body);
+		entities_.AttachMesh(barrier, barrier_mesh, NULL);
+		entities_.AttachScore(barrier, kBarrierPoints, kBarrierPriority);
+		entities_.AttachBarrier(barrier);
 	}
 }
 
 void SceneApp::InitBumpers()
 {
-	// bumper dimensions
-	float bumper_radius = 1.5f;
-	std::vector<gef::Vector4*> bumper_centre_vec;
-	bumper_centre_vec.push_back(new gef::Vector4(0.f, 13.5f, 0.0f));
-	bumper_centre_vec.push_back(new gef::Vector4(-4.5f, 10.f, 0.0f));
-	bumper_centre_vec.push_back(new gef::Vector4(4.5f, 10.f, 0.0f));
-
-	for (int i = 0; i < bumper_centre_vec.size(); i++)
-	{
-		// setup the mesh for the bumper
-		bumper_mesh_ = primitive_builder_->CreateSphereMesh(bumper_radius, 40, 20);
-		bumper_vec_.push_back(new GameObject);
-		bumper_vec_[i]->set_mesh(bumper_mesh_);
-		bumper_vec_[i]->set_type(BUMPER);
-	}
-
 	// create a physics body for the bumper
 	b2BodyDef bumper_body_def;
 	bumper_body_def.type = b2_staticBody;
 
-	for (int i = 0; i < bumper_centre_vec.size(); i++)
-	{
-		bumper_body_def.position = b2Vec2(bumper_centre_vec[i]->x(), bumper_centre_vec[i]->y());
-		bumper_body_vec_.push_back(world_->CreateBody(&bumper_body_def));
-	}
-
-	// create the shape for the bumper
-	b2CircleShape shape;
-	shape.m_radius = bumper_radius;
+	gef::Mesh* bumper_mesh = NULL;
+	float mesh_radius = 0.f;
 
-	// create the fixture
-	b2FixtureDef fixture_def;
-	fixture_def.shape = &shape;
-	fixture_def.density = 1.0f;
-	fixture_def.restitution = 1.2f;
-	fixture_def.filter.categoryBits = BUMPER;
-	fixture_def.filter.maskBits = BALL;
-
-	for (int i = 0; i < bumper_centre_vec.size(); i++)
+	for (int i = 0; i < sizeof(kBumpers) / sizeof(kBumpers[0]); i++)
 	{
-		// create the fixture on the rigid body
-		bumper_body_vec_[i]->CreateFixture(&fixture_def);
+		const BumperDesc& desc = kBumpers[i];
+		Entity bumper = entities_.Create(BUMPER);
 
-		// update visuals from simulation data
-		bumper_vec_[i]->UpdateFromSimulation(bumper_body_vec_[i]);
-
-		// create a connection between the rigid body and GameObject
-		bumper_body_vec_[i]->SetUserData(bumper_vec_[i]);
-	}
-}
-
-void SceneApp::InitFlipperBumpers()
-{
-	// bumper dimensions
-	float bumper_radius = 2.5f;
-	std::vector<gef::Vector4*> bumper_centre_vec;
-	bumper_centre_vec.push_back(new gef::Vector4(-8.f, -19.3f, 0.0f));
-	bumper_centre_vec.push_back(new gef::Vector4(8.f, -19.3f, 0.0f));
-
-	for (int i = 0; i < bumper_centre_vec.size(); i++)
-	{
-		// setup the mesh for the bumper
-		bumper_mesh_ = primitive_builder_->CreateSphereMesh(bumper_radius, 40, 20);
-		bumper_vec_.push_back(new GameObject);
-		bumper_vec_[bumper_vec_.size() - 1]->set_mesh(bumper_mesh_);
-		bumper_vec_[bumper_vec_.size() - 1]->set_type(BUMPER);
-	}
-
-	// create a physics body for the bumper
-	b2BodyDef bumper_body_def;
-	bumper_body_def.type = b2_staticBody;
+		// bumpers of the same size share a mesh
+		if (!bumper_mesh || desc.radius != mesh_radius)
+		{
+			bumper_mesh = primitive_builder_->CreateSphereMesh(desc.radius, 40, 20);
+			table_meshes_.push_back(bumper_mesh);
+			mesh_radius = desc.radius;
+		}
 
-	for (int i = 0; i < bumper_centre_vec.size(); i++)
-	{
-		bumper_body_def.position = b2Vec2(bumper_centre_vec[i]->x(), bumper_centre_vec[i]->y());
-		bumper_body_vec_.push_back(world_->CreateBody(&bumper_body_def));
-	}
+		bumper_body_def.position = b2Vec2(desc.x, desc.y);
+		b2Body* bumper_body = world_->CreateBody(&bumper_body_def);
 
-	// create the shape for the bumper
-	b2CircleShape shape;
-	shape.m_radius = bumper_radius;
+		// create the shape for the bumper
+		b2CircleShape shape;
+		shape.m_radius = desc.radius;
 
-	// create the fixture
-	b2FixtureDef fixture_def;
-	fixture_def.shape = &shape;
-	fixture_def.density = 1.0f;
-	fixture_def.restitution = 0.4f;
-	fixture_def.filter.categoryBits = BUMPER;
-	fixture_def.filter.maskBits = BALL;
+		// create the fixture
+		b2FixtureDef fixture_def;
+		fixture_def.shape = &shape;
+		fixture_def.density = 1.0f;
+		fixture_def.restitution = desc.restitution;
+		fixture_def.filter.categoryBits = BUMPER;
+		fixture_def.filter.maskBits = BALL;
 
-	for (int i = bumper_vec_.size() - bumper_centre_vec.size(); i < bumper_vec_.size(); i++)
-	{
 		// create the fixture on the rigid body
-		bumper_body_vec_[i]->CreateFixture(&fixture_def);
-
-		// update visuals from simulation data
-		bumper_vec_[i]->UpdateFromSimulation(bumper_body_vec_[i]);
+		bumper_body->CreateFixture(&fixture_def);
 
-		// create a connection between the rigid body and GameObject
-		bumper_body_vec_[i]->SetUserData(bumper_vec_[i]);
+		entities_.AttachBody(bumper, bumper_body);
+		entities_.AttachMesh(bumper, bumper_mesh, &primitive_builder_->red_material());
+		entities_.AttachScore(bumper, kBumperPoints, kBumperPriority);
 	}
 }
 
@@ -409,15 +692,8 @@ void SceneApp::InitFlippers()
 	// flipper dimensions
 	gef::Vector4 flipper_half_dimensions(2.05f, 0.3f, 0.5f);
 	// setup the mesh for the flipper
-	flipper_mesh_ = primitive_builder_->CreateBoxMesh(flipper_half_dimensions);
-
-	flipper_vec_.push_back(new Flipper);
-	flipper_vec_[0]->set_mesh(flipper_mesh_);
-	flipper_vec_[0]->set_left(true);
-
-	flipper_vec_.push_back(new Flipper);
-	flipper_vec_[1]->set_mesh(flipper_mesh_);
-	flipper_vec_[1]->set_left(false);
+	gef::Mesh* flipper_mesh = primitive_builder_->CreateBoxMesh(flipper_half_dimensions);
+	table_meshes_.push_back(flipper_mesh);
 
 	// create a physics body
 	b2BodyDef flipper_def;
@@ -432,38 +708,8 @@ void SceneApp::InitFlippers()
 	flipper_joint_def.enableLimit = true;
 	flipper_joint_def.enableMotor = true;
 	flipper_joint_def.maxMotorTorque = 1000;
-
-	// flipper one
-
-	flipper_def.position = b2Vec2(-3.05f, -19.5f);
-	flipper_body_vec_.push_back(world_->CreateBody(&flipper_def));
-
-	flipper_pin_def.position = flipper_def.position - b2Vec2(1.8f, 0);
-	flipper_pin_body_vec_.push_back(world_->CreateBody(&flipper_pin_def));
-
-	flipper_joint_def.bodyA = flipper_pin_body_vec_[0];
-	flipper_joint_def.bodyB = flipper_body_vec_[0];
-	flipper_joint_def.localAnchorB.Set(-1.75f, 0);
 	flipper_joint_def.lowerAngle = gef::DegToRad(-30.f);
 	flipper_joint_def.upperAngle = gef::DegToRad(30.f);
-	flipper_joint_def.motorSpeed = -500.f;
-	flipper_joint_vec_.push_back((b2RevoluteJoint*)world_->CreateJoint(&flipper_joint_def));
-
-	// flipper two
-
-	flipper_def.position = b2Vec2(3.05f, -19.5f);
-	flipper_body_vec_.push_back(world_->CreateBody(&flipper_def));
-
-	flipper_pin_def.position = flipper_def.position + b2Vec2(1.8f, 0);
-	flipper_pin_body_vec_.push_back(world_->CreateBody(&flipper_pin_def));
-
-	flipper_joint_def.bodyA= flipper_pin_body_vec_[1];
-	flipper_joint_def.bodyB = flipper_body_vec_[1];
-	flipper_joint_def.localAnchorB.Set(1.75f, 0);
-	flipper_joint_def.lowerAngle = gef::DegToRad(-30.f);
-	flipper_joint_def.upperAngle = gef::DegToRad(30.f);
-	flipper_joint_def.motorSpeed = 500.f;
-	flipper_joint_vec_.push_back((b2RevoluteJoint*)world_->CreateJoint(&flipper_joint_def));
 
 	// create the shape
 	b2PolygonShape shape;
@@ -479,34 +725,45 @@ void SceneApp::InitFlippers()
 
 	for (int i = 0; i < 2; i++)
 	{
-		// create the fixture on the rigid body
-		flipper_body_vec_[i]->CreateFixture(&fixture_def);
+		// the left flipper, then the right mirrored across the table
+		bool left = i == 0;
+		float side = left ? -1.f : 1.f;
+		Entity flipper = entities_.Create(FLIPPER);
 
-		// update visuals from simulation data
-		flipper_vec_[i]->UpdateFromSimulation(flipper_body_vec_[i]);
+		flipper_def.position = b2Vec2(side * 3.05f, -19.5f);
+		b2Body* flipper_body = world_->CreateBody(&flipper_def);
 
-		// create a connection between the rigid body and GameObject
-		flipper_body_vec_[i]->SetUserData(flipper_vec_[i]);
-	}
+		flipper_pin_def.position = flipper_def.position + b2Vec2(side * 1.8f, 0);
+		b2Body* flipper_pin_body = world_->CreateBody(&flipper_pin_def);
+
+		flipper_joint_def.bodyA = flipper_pin_body;
+		flipper_joint_def.bodyB = flipper_body;
+		flipper_joint_def.localAnchorB.Set(side * 1.75f, 0);
+		flipper_joint_def.motorSpeed = side * 500.f;
+		b2RevoluteJoint* flipper_joint = (b2RevoluteJoint*)world_->CreateJoint(&flipper_joint_def);
+
+		// create the fixture on the rigid body
+		flipper_body->CreateFixture(&fixture_def);
 
+		entities_.AttachBody(flipper, flipper_body);
+		entities_.AttachMesh(flipper, flipper_mesh, NULL);
+		entities_.AttachScore(flipper, kFlipperPoints, kFlipperPriority);
+		entities_.AttachFlipper(flipper, flipper_joint, flipper_pin_body, left);
+	}
 }
 
 void SceneApp::InitLoseTrigger()
 {
-	lose_trigger_.set_type(LOSETRIGGER);
+	Entity lose_trigger = entities_.Create(LOSETRIGGER);
 	// lose trigger dimensions
 	gef::Vector4 lt_half_dimensions(8.5f, 0.2f, 0.5f);
 
-	// setup the mesh for the board
-	lose_trigger_mesh_ = primitive_builder_->CreateBoxMesh(lt_half_dimensions);
-	lose_trigger_.set_mesh(lose_trigger_mesh_);
-
 	// create a physics body
 	b2BodyDef body_def;
 	body_def.type = b2_staticBody;
 	body_def.position = b2Vec2(0.0f, -25.5f);
 
-	lose_trigger_body_ = world_->CreateBody(&body_def);
+	b2Body* lose_trigger_body = world_->CreateBody(&body_def);
 
 	// create the shape
 	b2PolygonShape shape;
@@ -519,20 +776,17 @@ void SceneApp::InitLoseTrigger()
 	fixture_def.filter.maskBits = BALL;
 
 	// create the fixture on the rigid body
-	lose_trigger_body_->CreateFixture(&fixture_def);
+	lose_trigger_body->CreateFixture(&fixture_def);
 
-	// update visuals from simulation data
-	lose_trigger_.UpdateFromSimulation(lose_trigger_body_);
-
-	// create a connection between the rigid body and GameObject
-	lose_trigger_body_->SetUserData(&lose_trigger_);
+	// never drawn, so it has no mesh
+	entities_.AttachBody(lose_trigger, lose_trigger_body);
 }
 
 bool SceneApp::CheckBarriers()
 {
-	for (int barrierCount = 0; barrierCount < barrier_vec_.size(); barrierCount++)
+	for (int row = 0; row < entities_.size(); row++)
 	{
-		if (!barrier_vec_[barrierCount]->get_hit())
+		if ((entities_.components(row) & COMPONENT_BARRIER) && !entities_.hit(row))
 		{
 			return false;
 		}
@@ -542,94 +796,86 @@ bool SceneApp::CheckBarriers()
 
 void SceneApp::LoadScores()
 {
-	std::ifstream scoresFile("scores.txt");
-
-	if (!scoresFile.good())
+	// the first run converts the old text table, a missing or ruined table starts over
+	if (!score_store_.Load(leaderboard_))
 	{
-		scoresFile.close();
-		std::ofstream newScoresFile("scores.txt");
-		newScoresFile << "AAA,0";
-		newScoresFile.close();
 		ResetScores();
 	}
-	else
-	{
-		std::string line, val;
-		bool pair = true;
+	leaderboard_.GetRange(0, kLeaderboardRows, topScores);
+}
 
-		// read data, line by line
-		while (scoresFile.good())
+void SceneApp::ResetScores()
+{
+	// the shown table's replays go with it, and sequences carry on so no new entry
+	// takes the name of a replay still being removed
+	if (kSaveReplays)
+	{
+		std::vector<LeaderboardEntry> shown;
+		leaderboard_.GetRange(0, kLeaderboardRows, shown);
+		for (size_t i = 0; i < shown.size(); i++)
 		{
-			std::getline(scoresFile, line);
-			// Create a stringstream of the current line
-			std::stringstream ss(line);
-
-			std::pair<std::string, unsigned int> temp;
-
-			// read every column data of a row and 
-			// store it in a string variable
-			// then fill the pair variable
-			while (std::getline(ss, val, ','))
-			{
-				if (pair)
-				{
-					temp.first = val;
-				}
-				else
-				{
-					temp.second = std::stoi(val);
-				}
-
-				pair = !pair;
-			}
-
-			scores.push_back(temp);
+			char replayFile[32];
+			sprintf(replayFile, kReplayFileFormat, shown[i].sequence);
+			score_store_.RemoveAttachment(replayFile);
 		}
+	}
 
-		scoresFile.close();
+	uint32_t nextSequence = leaderboard_.next_sequence();
+	leaderboard_.Clear();
+	leaderboard_.ReserveSequences(nextSequence);
+	for (int i = 10; i > 0; i--)
+	{
+		leaderboard_.Insert("AAA", i * 100);
 	}
+	score_store_.Rewrite(leaderboard_);
+
+	leaderboard_.GetRange(0, kLeaderboardRows, topScores);
+	lastRank = -1;
 }
 
-void SceneApp::SaveScores()
+bool SceneApp::CheckHighScore()
 {
-	std::ofstream scoresFile("scores.txt", std::ofstream::trunc);
-	scoresFile << scores[0].first << "," << std::to_string(scores[0].second);
+	return leaderboard_.RankForScore(points) < kLeaderboardRows;
+}
 
-	int endOfFile = scores.size();
-	if (endOfFile > 10) endOfFile = 10;
+void SceneApp::RecordScore(const char* name, bool publish)
+{
+	// whoever is last on the shown table now drops off it if the new score goes above them
+	std::vector<LeaderboardEntry> last;
+	leaderboard_.GetRange(kLeaderboardRows - 1, 1, last);
+
+	lastRank = (int)leaderboard_.Insert(name, points);
 
-	for (int i = 1; i < endOfFile; i++)
+	// only the new entry is written, appended to the store's journal
+	std::vector<LeaderboardEntry> entry;
+	leaderboard_.GetRange(lastRank, 1, entry);
+	score_store_.Append(entry[0]);
+	if (publish && leaderboard_sync_)
 	{
-		scoresFile << std::endl << scores[i].first << "," << std::to_string(scores[i].second);
+		leaderboard_sync_->Queue(entry[0]);
 	}
 
-	scoresFile.close();
-}
-
-void SceneApp::ResetScores()
-{
-	scores.clear();
-	std::pair<std::string, unsigned int> tempPair;
-	std::string name = "AAA";
-	tempPair.first = name;
-	for (int i = 10; i > 0; i--)
+	// the replay is named after the entry's sequence so the two can be matched up later
+	if (publish && kSaveReplays && replay_.recording())
 	{
-		tempPair.second = i * 100;
-		scores.push_back(tempPair);
+		char replayFile[32];
+		sprintf(replayFile, kReplayFileFormat, entry[0].sequence);
+
+		std::vector<unsigned char> replay;
+		replay_.Finish(simStep, entry[0], replay);
+		gef::DebugOut("Replay %s, %u bytes for %u steps\n", replayFile, (unsigned int)replay.size(), simStep);
+		score_store_.WriteAttachment(replayFile, replay);
 	}
-	SaveScores();
-}
 
-bool SceneApp::CheckHighScore()
-{
-	for (scorePos = scores.begin(); scorePos != scores.end(); ++scorePos)
+	// replays are only kept for the shown table, so the one dropped off it goes
+	if (kSaveReplays && !last.empty() && lastRank < (int)kLeaderboardRows)
 	{
-		if (points > scorePos->second)
-		{
-			return true;
-		}
+		char replayFile[32];
+		sprintf(replayFile, kReplayFileFormat, last[0].sequence);
+		score_store_.RemoveAttachment(replayFile);
 	}
-	return false;
+
+	leaderboard_.GetRange(0, kLeaderboardRows, topScores);
 }
 
 void SceneApp::RenderScores()
@@ -789,45 +1035,23 @@ void SceneApp::RenderScores()
 
 void SceneApp::RenderLeaderboard()
 {
-	for (int i = 0; i < scores.size(); i++)
+	for (int i = 0; i < topScores.size(); i++)
 	{
-		std::string tempStr = std::string(8 - std::to_string(scores[i].second).length(), '0') + std::to_string(scores[i].second);
-
 		font_->RenderText(
 			sprite_renderer_,
 			gef::Vector4(40.f + ((double)sin(leaderboardSway + i * 1.2f) * 20.f), 80.f + (i * 60.f), -0.99f),
 			3.f,
 			0xffffffff,
 			gef::TJ_LEFT,
-			"%s", scores[i].first.c_str());
+			"%s", topScores[i].name);
 		font_->RenderText(
 			sprite_renderer_,
-			gef::Vector4((platform_.width() - 40.f) + ((double)sin(leaderboardSway + i * 1.2f) * 20.f), 80.f + (i * 60.f), -0.99f),
-			3.f,
-			0xffffffff,
-			gef::TJ_RIGHT,
-			"%s", tempStr.c_str());
-	}
-}
-
-gef::Scene* SceneApp::LoadSceneAssets(gef::Platform& platform, const char* filename)
-{
-	gef::Scene* scene = new gef::Scene();
-
-	if (scene->ReadSceneFromFile(platform, filename))
-	{
-		// if scene file loads successful
-		// create material and mesh resources from the scene data
-		scene->CreateMaterials(platform);
-		scene->CreateMeshes(platform);
-	}
-	else
-	{
-		delete scene;
-		scene = NULL;
+			gef::Vector4((platform_.width() - 40.f) + ((double)sin(leaderboardSway + i * 1.2f) * 20.f), 80.f + (i * 60.f), -0.99f),
+			3.f,
+			0xffffffff,
+			gef::TJ_RIGHT,
+			"%08u", topScores[i].score);
 	}
-
-	return scene;
 }
 
 gef::Mesh* SceneApp::GetMeshFromSceneAssets(gef::Scene* scene)
@@ -844,8 +1068,25 @@ gef::Mesh* SceneApp::GetMeshFromSceneAssets(gef::Scene* scene)
 
 void SceneApp::InitFont()
 {
-	font_ = new gef::Font(platform_);
-	font_->Load("comic_sans");
+	font_ = new CachedFont(platform_);
+	font_->Load("comic_sans", ui_atlas_, &asset_pack_);
+}
+
+void SceneApp::InitAtlas()
+{
+	ui_atlas_ = new TextureAtlas(platform_);
+
+	crossButton = ui_atlas_->AddImage("playstation-cross-dark-icon.png");
+	squareButton = ui_atlas_->AddImage("playstation-square-dark-icon.png");
+	circleButton = ui_atlas_->AddImage("playstation-circle-dark-icon.png");
+	triangleButton = ui_atlas_->AddImage("playstation-triangle-dark-icon.png");
+	logo = ui_atlas_->AddImage("logo.png");
+	ui_atlas_->AddImage("comic_sans_0.png");
+
+	if (!ui_atlas_->Build())
+	{
+		gef::DebugOut("UI atlas failed to build\n");
+	}
 }
 
 void SceneApp::CleanUpFont()
@@ -873,11 +1114,11 @@ void SceneApp::DrawBG()
 	gef::Sprite background;
 	if (gameState == INGAME || gameState == PAUSE || gameState == GAMEOVER)
 	{
-		background.set_texture(spaceBG);
+		background.set_texture(spaceBG->texture());
 	}
 	else
 	{
-		background.set_texture(simpleBG);
+		background.set_texture(simpleBG->texture());
 	}
 	background.set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f, 1.f));
 	background.set_height(platform_.height());
@@ -904,26 +1145,25 @@ void SceneApp::SetupLights()
 
 void SceneApp::UpdateSimulation(float frame_time)
 {
+	PROFILE_SCOPE("SceneApp::UpdateSimulation");
+
 	// update physics world
 	float timeStep = 1.0f / 60.0f;
 
 	int32 velocityIterations = 6;
 	int32 positionIterations = 2;
 
-	world_->Step(timeStep, velocityIterations, positionIterations);
-
-	// update object visuals from simulation data
-	for (int ballCount = 0; ballCount < ball_vec_.size(); ballCount++)
-	{
-		ball_vec_[ballCount]->UpdateFromSimulation(ball_body_vec_[ballCount]);
-	}
+	// every flipper change captured so far has been applied to the motors by now
+	flipper_latency_.Stepped(InputEventQueue::Now());
 
-	for (int flipperCount = 0; flipperCount < flipper_vec_.size(); flipperCount++)
 	{
-		flipper_vec_[flipperCount]->UpdateFromSimulation(flipper_body_vec_[flipperCount]);
+		PROFILE_SCOPE("b2World::Step");
+		uint64_t stepStart = Profiler::Now();
+		world_->Step(timeStep, velocityIterations, positionIterations);
+		physicsStepMs += (Profiler::Now() - stepStart) / 1000000.f;
 	}
 
-	// don't have to update the board visuals as it is static
+	PROFILE_SCOPE("Contacts");
 
 	// collision detection
 	// get the head of the contact list
@@ -931,7 +1171,7 @@ void SceneApp::UpdateSimulation(float frame_time)
 	// get contact count
 	int contact_count = world_->GetContactCount();
 
-	if (contact_count == ball_vec_.size() - 1)
+	if (contact_count == entities_.Count(BALL) - 1)
 	{
 		contacted = false;
 	}
@@ -946,119 +1186,14 @@ void SceneApp::UpdateSimulation(float frame_time)
 			b2Filter filterA = contact->GetFixtureA()->GetFilterData();
 			b2Filter filterB = contact->GetFixtureB()->GetFilterData();
 
-			// DO COLLISION RESPONSE HERE
-			Barrier* barrier = NULL;
-
-			int sfx = std::rand() / ((RAND_MAX + 1) / 3);
-
-			switch (filterA.categoryBits)
-			{
-			case BARRIER:
-				barrier = (Barrier*)bodyA->GetUserData();
-				barrier->set_hit(true);
-				filterA.categoryBits = HITBARRIER;
-				filterA.maskBits = NULL;
-				bodyA->GetFixtureList()->SetFilterData(filterA);
-
-				if (!contacted)
-				{
-					audio_manager_->PlaySample(soundFX[sfx]);
-					points += 25;
-					contacted = true;
-				}
-				break;
-			case LOSETRIGGER:
-				LostLife((Ball*)bodyB->GetUserData());
-				contact = world_->GetContactList();
-				contact_count = world_->GetContactCount();
-				break;
-			case FLIPPER:
-				if (CheckBarriers())
-				{
-					for (int barrierCount = 0; barrierCount < barrier_vec_.size(); barrierCount++)
-					{
-						barrier_vec_[barrierCount]->set_hit(false);
-						b2Filter filter = barrier_body_vec_[barrierCount]->GetFixtureList()->GetFilterData();
-						filter.categoryBits = BARRIER;
-						filter.maskBits = BALL;
-						barrier_body_vec_[barrierCount]->GetFixtureList()->SetFilterData(filter);
-					}
-					InitBall();
-				}
-				
-				if (!contacted)
-				{
-					audio_manager_->PlaySample(soundFX[sfx]);
-					points += 10;
-					contacted = true;
-				}
-				break;
-			case BUMPER:
-				
-				if (!contacted)
-				{
-					audio_manager_->PlaySample(soundFX[sfx]);
-					points += 15;
-					contacted = true;
-				}
-				break;
-			default:
-				break;
-			}
+			int sfx = std::rand() % 3;
 
-			switch (filterB.categoryBits)
+			// a lost ball rebuilds the contact list
+			if (ContactResponse(contact->GetFixtureA(), filterA, bodyB, sfx) ||
+				ContactResponse(contact->GetFixtureB(), filterB, bodyA, sfx))
 			{
-			case BARRIER:
-				barrier = (Barrier*)bodyB->GetUserData();
-				barrier->set_hit(true);
-				filterB.categoryBits = HITBARRIER;
-				filterB.maskBits = NULL;
-				bodyB->GetFixtureList()->SetFilterData(filterB);
-				
-				if (!contacted)
-				{
-					audio_manager_->PlaySample(soundFX[sfx]);
-					points += 25;
-					contacted = true;
-				}
-				break;
-			case LOSETRIGGER:
-				LostLife((Ball*)bodyA->GetUserData());
 				contact = world_->GetContactList();
 				contact_count = world_->GetContactCount();
-				break;
-			case FLIPPER:
-				if (CheckBarriers())
-				{
-					for (int barrierCount = 0; barrierCount < barrier_vec_.size(); barrierCount++)
-					{
-						barrier_vec_[barrierCount]->set_hit(false);
-						b2Filter filter = barrier_body_vec_[barrierCount]->GetFixtureList()->GetFilterData();
-						filter.categoryBits = BARRIER;
-						filter.maskBits = BALL;
-						barrier_body_vec_[barrierCount]->GetFixtureList()->SetFilterData(filter);
-					}
-					InitBall();
-				}
-				
-				if (!contacted)
-				{
-					audio_manager_->PlaySample(soundFX[sfx]);
-					points += 10;
-					contacted = true;
-				}
-				break;
-			case BUMPER:
-				
-				if (!contacted)
-				{
-					audio_manager_->PlaySample(soundFX[sfx]);
-					points += 15;
-					contacted = true;
-				}
-				break;
-			default:
-				break;
 			}
 		}
 
@@ -1070,25 +1205,52 @@ void SceneApp::UpdateSimulation(float frame_time)
 	}
 }
 
-void SceneApp::LostLife(Ball* dead_ball)
+bool SceneApp::ContactResponse(b2Fixture* fixture, b2Filter filter, b2Body* other, int sfx)
 {
-	for (int i = 0; i < ball_body_vec_.size(); i++)
+	// what each kind does beyond scoring, the points themselves are data on the entity
+	int row = entities_.Row(EntityStore::FromBody(fixture->GetBody()));
+
+	switch (filter.categoryBits)
 	{
-		if (ball_body_vec_[i]->GetUserData() == dead_ball)
+	case BARRIER:
+		entities_.set_hit(row, true);
+		filter.categoryBits = HITBARRIER;
+		filter.maskBits = NULL;
+		fixture->SetFilterData(filter);
+		break;
+	case LOSETRIGGER:
+		LostLife(EntityStore::FromBody(other));
+		return true;
+	case FLIPPER:
+		if (CheckBarriers())
 		{
-			world_->DestroyBody(ball_body_vec_[i]);
-			ball_body_vec_.erase(ball_body_vec_.begin() + i);
+			ResetBarriers();
+			InitBall();
 		}
+		break;
+	default:
+		break;
 	}
-	for (int i = 0; i < ball_vec_.size(); i++)
+
+	if (row >= 0 && (entities_.components(row) & COMPONENT_SCORE) && !contacted)
 	{
-		if (ball_vec_[i] == dead_ball)
-		{
-			delete dead_ball;
-			ball_vec_.erase(ball_vec_.begin() + i);
-		}
+		const ScoreValue score = entities_.score(row);
+		audio_thread_->PlaySample(soundFX[sfx], score.priority);
+		points += score.points;
+		contacted = true;
+	}
+	return false;
+}
+
+void SceneApp::LostLife(Entity dead_ball)
+{
+	int row = entities_.Row(dead_ball);
+	if (row >= 0 && entities_.type(row) == BALL)
+	{
+		world_->DestroyBody(entities_.body(row));
+		entities_.Destroy(dead_ball);
 	}
-	if (ball_vec_.empty())
+	if (entities_.Count(BALL) == 0)
 	{
 		if (lives > 0)
 		{
@@ -1098,24 +1260,52 @@ void SceneApp::LostLife(Ball* dead_ball)
 	}
 }
 
+void SceneApp::InitGameFrame()
+{
+	// Contacts play sounds through the audio thread's single producer queue and draw on
+	// std::rand, so stepping the world stays on the main thread. The ghosts never touch
+	// the world and run alongside it; once the step is done the transforms are synced
+	// while the replay samples the balls, both only reading the bodies.
+	int physics = game_frame_.AddStage("physics", PhysicsStage, this, true);
+	int transforms = game_frame_.AddStage("transforms", TransformStage, this);
+	int replay = game_frame_.AddStage("replay", ReplayStage, this);
+	game_frame_.AddStage("ghosts", GhostStage, this);
+
+	game_frame_.AddDependency(physics, transforms);
+	game_frame_.AddDependency(physics, replay);
+}
+
+void SceneApp::PhysicsStage(void* app)
+{
+	SceneApp* scene = (SceneApp*)app;
+	scene->UpdateSimulation(scene->game_frame_time_);
+}
+
+void SceneApp::TransformStage(void* app)
+{
+	// update object visuals from simulation data, static bodies are skipped
+	((SceneApp*)app)->entities_.SyncTransforms();
+}
+
+void SceneApp::ReplayStage(void* app)
+{
+	AllocTagScope alloc_scope(ALLOC_GAME);
+	((SceneApp*)app)->RecordReplayBalls();
+}
+
+void SceneApp::GhostStage(void* app)
+{
+	AllocTagScope alloc_scope(ALLOC_GAME);
+	((SceneApp*)app)->UpdateGhosts();
+}
+
 void SceneApp::FrontendInit()
 {
-	crossButton = CreateTextureFromPNG("playstation-cross-dark-icon.png", platform_);
-	squareButton = CreateTextureFromPNG("playstation-square-dark-icon.png", platform_);
-	circleButton = CreateTextureFromPNG("playstation-circle-dark-icon.png", platform_);
-	triangleButton = CreateTextureFromPNG("playstation-triangle-dark-icon.png", platform_);
+	// button icons live in the UI atlas for the lifetime of the app
 }
 
 void SceneApp::FrontendRelease()
 {
-	delete crossButton;
-	crossButton = NULL;
-	delete squareButton;
-	squareButton = NULL;
-	delete circleButton;
-	circleButton = NULL;
-	delete triangleButton;
-	triangleButton = NULL;
 }
 
 void SceneApp::FrontendUpdate(float frame_time)
@@ -1125,20 +1315,20 @@ void SceneApp::FrontendUpdate(float frame_time)
 	{
 	case (gef_SONY_CTRL_CROSS):
 		FrontendRelease();
-		gameState = INGAME;
+		ChangeState(INGAME);
 		GameInit();
 		break;
 	case (gef_SONY_CTRL_CIRCLE):
 		FrontendRelease();
-		gameState = EXIT;
+		ChangeState(EXIT);
 		IntervalInit();
 		break;
 	case (gef_SONY_CTRL_TRIANGLE):
-		gameState = OPTIONS;
+		PushState(OPTIONS);
 		OptionsInit();
 		break;
 	case (gef_SONY_CTRL_SQUARE):
-		gameState = CREDITS;
+		PushState(CREDITS);
 		CreditsInit();
 		break;
 	default:
@@ -1163,25 +1353,25 @@ void SceneApp::FrontendRender()
 
 	// Render buttons
 	gef::Sprite button;
-	button.set_texture(crossButton);
+	ui_atlas_->SetSprite(button, crossButton);
 	button.set_position(gef::Vector4(platform_.width()*0.5f, platform_.height()*0.5f, -0.99f));
 	button.set_height(32.0f);
 	button.set_width(32.0f);
 	sprite_renderer_->DrawSprite(button);
 
-	button.set_texture(triangleButton);
+	ui_atlas_->SetSprite(button, triangleButton);
 	button.set_position(gef::Vector4(platform_.width()*0.05f, platform_.height()*0.1f, -0.99f));
 	button.set_height(32.0f);
 	button.set_width(32.0f);
 	sprite_renderer_->DrawSprite(button);
 
-	button.set_texture(squareButton);
+	ui_atlas_->SetSprite(button, squareButton);
 	button.set_position(gef::Vector4(platform_.width()*0.95f, platform_.height()*0.1f, -0.99f));
 	button.set_height(32.0f);
 	button.set_width(32.0f);
 	sprite_renderer_->DrawSprite(button);
 
-	button.set_texture(circleButton);
+	ui_atlas_->SetSprite(button, circleButton);
 	button.set_position(gef::Vector4(platform_.width()*0.5f, platform_.height()*0.85f, -0.99f));
 	button.set_height(32.0f);
 	button.set_width(32.0f);
@@ -1229,48 +1419,158 @@ void SceneApp::FrontendRender()
 
 void SceneApp::GameInit()
 {
-	// create the renderer for draw 3D geometry
-	renderer_3d_ = gef::Renderer3D::Create(platform_);
+	// building the table and the first ball allocate from the world's own pool
+	PhysicsPoolScope physics_scope(&physics_pool_);
+	AllocTagScope alloc_scope(ALLOC_GAME);
 
-	// initialise primitive builder to make create some 3D geometry easier
-	primitive_builder_ = new PrimitiveBuilder(platform_);
+	// seeded per game so a replay can reproduce everything the game chose at random
+	uint32_t seed = (uint32_t)time(NULL);
+	std::srand(seed);
+	replay_.Begin(seed);
+	simStep = 0;
+	LoadGhosts();
 
-	audio_manager_->StopMusic();
-	audio_manager_->UnloadMusic();
-	int sfx = std::rand() / ((RAND_MAX + 1) / 3);
-	switch (sfx)
+	// the stream opens the track on its own thread, so this never waits on the disk
+	int track = std::rand() % 3;
+	audio_thread_->PlayMusic(kMusicFiles[track]);
+
+	contacted = false;
+	lives = 3;
+	points = 0;
+	optSelected = 0;
+
+	// the table is normally built while the menu was up, only the pieces still missing are built now
+	while (!GameBuildStep())
+	{
+	}
+	GameReset();
+
+	// a flipper only rises for a press made during this game
+	input_events_.Discard();
+	flipperButtons = 0;
+
+	InitBall();
+	RecordReplayBalls();
+	UpdateGhosts();
+}
+
+bool SceneApp::GameBuildStep()
+{
+	// a piece a frame, so building the table ahead of the game never shows as one long frame
+	PROFILE_SCOPE("SceneApp::GameBuildStep");
+	PhysicsPoolScope physics_scope(&physics_pool_);
+	AllocTagScope alloc_scope(ALLOC_TABLE);
+
+	switch (tableBuildStep)
 	{
 	case 0:
-		musicSFX = audio_manager_->LoadMusic("Beauty-Flow.wav", platform_);
+		// create the renderer for draw 3D geometry
+		renderer_3d_ = gef::Renderer3D::Create(platform_);
+
+		// initialise primitive builder to make create some 3D geometry easier
+		primitive_builder_ = new PrimitiveBuilder(platform_);
+
+		SetupLights();
 		break;
 	case 1:
-		musicSFX = audio_manager_->LoadMusic("EDM-Detection-Mode.wav", platform_);
+		// initialise the physics world
+		world_ = new b2World(b2Vec2(0.0f, -5.f));
+		InitBoard();
 		break;
 	case 2:
-		musicSFX = audio_manager_->LoadMusic("Inspired.wav", platform_);
+		InitBarriers();
+		InitBumpers();
 		break;
-	default:
+	case 3:
+		InitFlippers();
+		InitLoseTrigger();
+
+		// a coarser sphere than the real ball, a ghost only has to read as a ball
+		ghost_mesh_ = primitive_builder_->CreateSphereMesh(0.5f, 10, 10);
+		ghost_.set_mesh(ghost_mesh_);
+		ghost_material_.set_colour(kGhostColour);
 		break;
+	default:
+		return true;
 	}
-	audio_manager_->PlayMusic();
 
-	SetupLights();
-	contacted = false;
-	lives = 3;
-	points = 0;
-	optSelected = 0;
+	tableBuildStep++;
+	return tableBuildStep == kTableBuildSteps;
+}
 
-	// initialise the physics world
-	b2Vec2 gravity(0.0f, -5.f);
-	world_ = new b2World(gravity);
+void SceneApp::GameReset()
+{
+	// put the dynamic parts of the table back to how InitBarriers and InitFlippers left them
+	ResetBarriers();
 
-	InitBall();
-	InitBoard();
-	InitBarriers();
-	InitBumpers();
-	InitFlipperBumpers();
-	InitFlippers();
-	InitLoseTrigger();
+	for (int row = 0; row < entities_.size(); row++)
+	{
+		if (!(entities_.components(row) & COMPONENT_FLIPPER))
+			continue;
+
+		const FlipperState& flipper = entities_.flipper(row);
+		b2Body* body = entities_.body(row);
+		body->SetTransform(flipper.rest, 0.f);
+		body->SetLinearVelocity(b2Vec2(0.f, 0.f));
+		body->SetAngularVelocity(0.f);
+		flipper.joint->SetMotorSpeed(flipper.left ? -500.f : 500.f);
+	}
+	entities_.SyncTransforms();
+}
+
+void SceneApp::ResetBarriers()
+{
+	for (int row = 0; row < entities_.size(); row++)
+	{
+		if (!(entities_.components(row) & COMPONENT_BARRIER))
+			continue;
+
+		entities_.set_hit(row, false);
+		b2Filter filter = entities_.body(row)->GetFixtureList()->GetFilterData();
+		filter.categoryBits = BARRIER;
+		filter.maskBits = BALL;
+		entities_.body(row)->GetFixtureList()->SetFilterData(filter);
+	}
+}
+
+void SceneApp::ApplyFlipperButtons()
+{
+	DriveFlippers(true, flipperButtons & kLeftFlipperButtons ? kFlipperSpeed : -kFlipperSpeed);
+	DriveFlippers(false, flipperButtons & kRightFlipperButtons ? -kFlipperSpeed : kFlipperSpeed);
+}
+
+void SceneApp::TrackFlipperMotion()
+{
+	for (int row = 0; row < entities_.size(); row++)
+	{
+		if (!(entities_.components(row) & COMPONENT_FLIPPER))
+			continue;
+
+		const FlipperState& flipper = entities_.flipper(row);
+		float angle = flipper.joint->GetJointAngle();
+		float& last = flipperAngles[flipper.left ? 0 : 1];
+
+		// only movement the way the motor is now driving counts, a flipper still swinging back
+		// from an earlier press or knocked by the ball has not started the commanded motion.
+		// A probe stays stepped until that motion shows, however many steps it takes.
+		float speed = flipper.joint->GetMotorSpeed();
+		if ((speed > 0.f && angle - last > kFlipperMotionAngle) || (speed < 0.f && last - angle > kFlipperMotionAngle))
+		{
+			flipper_latency_.Moved(flipper.left, InputEventQueue::Now());
+		}
+		last = angle;
+	}
+}
+
+void SceneApp::DriveFlippers(bool left, float speed)
+{
+	for (int row = 0; row < entities_.size(); row++)
+	{
+		if ((entities_.components(row) & COMPONENT_FLIPPER) && entities_.flipper(row).left == left)
+		{
+			entities_.flipper(row).joint->SetMotorSpeed(speed);
+		}
+	}
 }
 
 void SceneApp::GameRelease()
@@ -1280,49 +1580,66 @@ void SceneApp::GameRelease()
 	optSelected = NULL;
 	optSelected = NULL;
 
-	// destroy the ball objects and clear the vector
-	for (auto ball_obj : ball_vec_)
+	// only the balls belong to a single game, the rest of the table is reused
+	for (int row = (int)entities_.size() - 1; row >= 0; row--)
 	{
-		delete ball_obj;
+		if (entities_.type(row) == BALL)
+		{
+			world_->DestroyBody(entities_.body(row));
+			entities_.Destroy(entities_.entity(row));
+		}
 	}
-	ball_vec_.clear();
-	ball_body_vec_.clear();
 
-	// destroy the bumper objects and clear the vector
-	for (auto bumper_obj : bumper_vec_)
+	// the ghosts hold nothing of their own, so the whole game goes back with one reset
+	for (int i = 0; i < kGhostCount; i++)
 	{
-		delete bumper_obj;
+		ghosts_[i].Close();
+		ghost_ball_count_[i] = 0;
 	}
-	bumper_vec_.clear();
-	bumper_body_vec_.clear();
+	gef::DebugOut("Game arena: %u bytes used, %u peak, %u reserved\n",
+		(unsigned int)game_arena_.used_bytes(), (unsigned int)game_arena_.peak_bytes(), (unsigned int)game_arena_.reserved_bytes());
+	game_arena_.Reset();
 
-	// destroy the barrier objects and clear the vector
-	for (auto barrier_obj : barrier_vec_)
+	// written by the score store's thread like the replays, so game over does not wait on the disk
+	const LatencyHistogram& latency = flipper_latency_.histogram(LATENCY_TOTAL);
+	if (latency.count > 0)
 	{
-		delete barrier_obj;
+		std::vector<unsigned char> csv;
+		flipper_latency_.Export(csv);
+		score_store_.WriteAttachment(kLatencyFile, csv);
+		gef::DebugOut("Flipper latency: %u changes timed, %.1fms median, %.1fms p99, queued to %s\n",
+			latency.count, latency.Percentile(0.5f) / 1000.f, latency.Percentile(0.99f) / 1000.f, kLatencyFile);
 	}
-	barrier_vec_.clear();
-	barrier_body_vec_.clear();
 
-	// destroy the flipper objects and clear the vector
-	for (int jointCount = 0; jointCount < flipper_joint_vec_.size(); jointCount++)
-	{
-		world_->DestroyJoint(flipper_joint_vec_[jointCount]);
-	}
-	flipper_joint_vec_.clear();
-	for (auto flipper_obj : flipper_vec_)
+	PhysicsPoolStats physics = physics_pool_.stats();
+	gef::DebugOut("Physics pool: %u allocations, %u pooled, %u bytes live, %u peak, %u from the system\n",
+		(unsigned int)physics.allocations, (unsigned int)physics.pooled, (unsigned int)physics.live_bytes,
+		(unsigned int)physics.peak_bytes, (unsigned int)physics.system_bytes);
+}
+
+void SceneApp::GameDestroy()
+{
+	if (tableBuildStep == 0)
+		return;
+
+	GameRelease();
+
+	// the joints go with the world, the entities only referred to them
+	entities_.Clear();
+	for (auto mesh : table_meshes_)
 	{
-		delete flipper_obj;
+		delete mesh;
 	}
-	flipper_vec_.clear();
-	flipper_body_vec_.clear();
-	flipper_pin_body_vec_.clear();
+	table_meshes_.clear();
+
+	delete ghost_mesh_;
+	ghost_mesh_ = NULL;
 
 	// destroying the physics world also destroys all the objects within it
 	delete world_;
 	world_ = NULL;
 
-	delete scene_assets_;
+	resource_manager_->Release(kBoardSceneFile);
 	scene_assets_ = NULL;
 
 	delete primitive_builder_;
@@ -1330,103 +1647,47 @@ void SceneApp::GameRelease()
 
 	delete renderer_3d_;
 	renderer_3d_ = NULL;
+
+	tableBuildStep = 0;
 }
 
 void SceneApp::GameUpdate(float frame_time)
 {
+	AllocTagScope alloc_scope(ALLOC_GAME);
 	const gef::SonyController* controller = input_manager_->controller_input()->GetController(0);
 
-	float flipperSpeed = 1000.f;
-
-	if (controller->buttons_pressed() > 0)
-	{
-		gef::DebugOut("%i\n", controller->buttons_pressed());
-	}
-
-	if (gameState == INGAME)
+	// every change since the last step, in the order captured, so each lands on the step it precedes
+	InputEvent event;
+	while (input_events_.Pop(event))
 	{
-		switch (controller->buttons_released())
+		if (event.button & (kLeftFlipperButtons | kRightFlipperButtons))
 		{
-		case (gef_SONY_CTRL_SQUARE):
-		case (gef_SONY_CTRL_L1):
-			for (int i = 0; i < flipper_vec_.size(); i++)
-			{
-				if (flipper_vec_[i]->get_left())
-				{
-					flipper_joint_vec_[i]->SetMotorSpeed(-flipperSpeed);
-				}
-			}
-			break;
-		case (gef_SONY_CTRL_CIRCLE):
-		case (gef_SONY_CTRL_R1):
-			for (int i = 0; i < flipper_vec_.size(); i++)
-			{
-				if (!flipper_vec_[i]->get_left())
-				{
-					flipper_joint_vec_[i]->SetMotorSpeed(flipperSpeed);
-				}
-			}
-			break;
-		case (40960):
-		case (3072):
-			for (int i = 0; i < flipper_vec_.size(); i++)
+			uint32_t held = flipperButtons;
+			flipperButtons = event.down ? flipperButtons | event.button : flipperButtons & ~event.button;
+			if (gameState == INGAME)
 			{
-				if (flipper_vec_[i]->get_left())
+				ApplyFlipperButtons();
+
+				// only a change that moves a flipper up or down is timed
+				if (!(held & kLeftFlipperButtons) != !(flipperButtons & kLeftFlipperButtons))
 				{
-					flipper_joint_vec_[i]->SetMotorSpeed(-flipperSpeed);
+					flipper_latency_.Edge(true, event.time_us);
 				}
-				else
+				if (!(held & kRightFlipperButtons) != !(flipperButtons & kRightFlipperButtons))
 				{
-					flipper_joint_vec_[i]->SetMotorSpeed(flipperSpeed);
+					flipper_latency_.Edge(false, event.time_us);
 				}
 			}
-		default:
-			break;
 		}
-		switch (controller->buttons_pressed())
+		else if (event.button == gef_SONY_CTRL_SELECT && event.down && gameState == INGAME)
 		{
-		case (gef_SONY_CTRL_SELECT):
-			gameState = PAUSE;
+			// later changes wait in the queue, the flippers follow them once the game resumes
+			PushState(PAUSE);
 			return;
-			break;
-		case (gef_SONY_CTRL_SQUARE):
-		case (gef_SONY_CTRL_L1):
-			for (int i = 0; i < flipper_vec_.size(); i++)
-			{
-				if (flipper_vec_[i]->get_left())
-				{
-					flipper_joint_vec_[i]->SetMotorSpeed(flipperSpeed);
-				}
-			}
-			break;
-		case (gef_SONY_CTRL_CIRCLE):
-		case (gef_SONY_CTRL_R1):
-			for (int i = 0; i < flipper_vec_.size(); i++)
-			{
-				if (!flipper_vec_[i]->get_left())
-				{
-					flipper_joint_vec_[i]->SetMotorSpeed(-flipperSpeed);
-				}
-			}
-			break;
-		case (40960):
-		case (3072):
-			for (int i = 0; i < flipper_vec_.size(); i++)
-			{
-				if (flipper_vec_[i]->get_left())
-				{
-					flipper_joint_vec_[i]->SetMotorSpeed(flipperSpeed);
-				}
-				else
-				{
-					flipper_joint_vec_[i]->SetMotorSpeed(-flipperSpeed);
-				}
-			}
-		default:
-			break;
 		}
 	}
-	else
+
+	if (gameState == PAUSE)
 	{
 		switch (controller->buttons_pressed())
 		{
@@ -1465,19 +1726,21 @@ void SceneApp::GameUpdate(float frame_time)
 		case (gef_SONY_CTRL_CROSS):
 			if (optSelected == 0)
 			{
-				gameState = INGAME;
+				PopState();
+				ApplyFlipperButtons();
 				return;
 			}
 			else if (optSelected == 3)
 			{
 				GameRelease();
-				gameState = GAMEOVER;
+				ChangeState(GAMEOVER);
 				IntervalInit();
 				return;
 			}
 			break;
 		case (gef_SONY_CTRL_SELECT):
-			gameState = INGAME;
+			PopState();
+			ApplyFlipperButtons();
 			return;
 			break;
 		default:
@@ -1487,18 +1750,123 @@ void SceneApp::GameUpdate(float frame_time)
 
 	if (gameState == INGAME)
 	{
-		UpdateSimulation(frame_time);
+		// contacts, and any ball a contact adds, come from the world's pool
+		PhysicsPoolScope physics_scope(&physics_pool_);
+
+		// the step count moves on before the stages run, so they only ever read it
+		replay_.RecordInput(simStep, FlipperBits());
+		simStep++;
+		game_frame_time_ = frame_time;
+		game_frame_.Execute(*job_system_);
+		TrackFlipperMotion();
 	}
 	if (lives == 0)
 	{
 		GameRelease();
-		gameState = GAMEOVER;
+		ChangeState(GAMEOVER);
 		IntervalInit();
 	}
 }
 
+uint8_t SceneApp::FlipperBits() const
+{
+	// bit 0 while the left flippers are driven up, bit 1 for the right
+	uint8_t bits = 0;
+	for (int row = 0; row < entities_.size(); row++)
+	{
+		if (!(entities_.components(row) & COMPONENT_FLIPPER))
+			continue;
+
+		const FlipperState& flipper = entities_.flipper(row);
+		if (flipper.left && flipper.joint->GetMotorSpeed() > 0.f)
+		{
+			bits |= 1;
+		}
+		else if (!flipper.left && flipper.joint->GetMotorSpeed() < 0.f)
+		{
+			bits |= 2;
+		}
+	}
+	return bits;
+}
+
+void SceneApp::RecordReplayBalls()
+{
+	if (!replay_.SampleDue(simStep))
+		return;
+
+	ReplayBall balls[16];
+	unsigned int count = 0;
+	for (int row = 0; row < entities_.size() && count < 16; row++)
+	{
+		if (entities_.type(row) != BALL)
+			continue;
+
+		const b2Body* body = entities_.body(row);
+		balls[count].x = body->GetPosition().x;
+		balls[count].y = body->GetPosition().y;
+		balls[count].angle = body->GetAngle();
+		count++;
+	}
+	replay_.RecordBalls(simStep, balls, count);
+}
+
+void SceneApp::LoadGhosts()
+{
+	PROFILE_SCOPE("SceneApp::LoadGhosts");
+
+	// follow the best games that left a replay, each read into this game's arena
+	for (int i = 0; i < kGhostCount; i++)
+	{
+		ghost_ball_count_[i] = 0;
+		if (i >= topScores.size())
+			continue;
+
+		// a replay still being written by the store is picked up next game
+		char replayFile[32];
+		sprintf(replayFile, kReplayFileFormat, topScores[i].sequence);
+		if (ghosts_[i].Open(replayFile, game_arena_))
+		{
+			gef::DebugOut("Ghost %i follows %s, %u\n", i, ghosts_[i].header().name, ghosts_[i].header().score);
+		}
+	}
+}
+
+void SceneApp::UpdateGhosts()
+{
+	// ghosts run on the same step count as the live game, so a restart lines them up again
+	for (int i = 0; i < kGhostCount; i++)
+	{
+		ghost_ball_count_[i] = ghosts_[i].Update(simStep, ghost_balls_[i]);
+	}
+}
+
+int SceneApp::DrawGhosts()
+{
+	int draws = 0;
+	renderer_3d_->set_override_material(&ghost_material_);
+	for (int i = 0; i < kGhostCount; i++)
+	{
+		for (unsigned int ballCount = 0; ballCount < ghost_ball_count_[i]; ballCount++)
+		{
+			const ReplayBall& ball = ghost_balls_[i][ballCount];
+
+			gef::Matrix44 transform;
+			transform.RotationZ(ball.angle);
+			transform.SetTranslation(gef::Vector4(ball.x, ball.y, 0.0f));
+			ghost_.set_transform(transform);
+			renderer_3d_->DrawMesh(ghost_);
+			draws++;
+		}
+	}
+	renderer_3d_->set_override_material(NULL);
+	return draws;
+}
+
 void SceneApp::GameRender()
 {
+	PROFILE_SCOPE("SceneApp::GameRender");
+
 	// setup camera
 
 	// projection
@@ -1519,37 +1887,11 @@ void SceneApp::GameRender()
 	// draw 3d geometry
 	renderer_3d_->Begin();
 
-	// draw board
-	renderer_3d_->DrawMesh(board_);
-
-	// draw flippers
-	for (int flipperCount = 0; flipperCount < flipper_vec_.size(); flipperCount++)
-	{
-		renderer_3d_->DrawMesh(*flipper_vec_[flipperCount]);
-	}
-
-	renderer_3d_->set_override_material(&primitive_builder_->red_material());
-	for (int bumperCount = 0; bumperCount < bumper_vec_.size(); bumperCount++)
-	{
-		renderer_3d_->DrawMesh(*bumper_vec_[bumperCount]);
-	}
-	renderer_3d_->set_override_material(NULL);
-
-	for (int barrierCount = 0; barrierCount < barrier_vec_.size(); barrierCount++)
-	{
-		if (!barrier_vec_[barrierCount]->get_hit())
-		{
-			renderer_3d_->DrawMesh(*barrier_vec_[barrierCount]);
-		}
-	}
+	// draw the table and the balls
+	meshDraws += entities_.Draw(renderer_3d_);
 
-	// draw ball
-	renderer_3d_->set_override_material(&primitive_builder_->green_material());
-	for (int ballCount = 0; ballCount < ball_vec_.size(); ballCount++)
-	{
-		renderer_3d_->DrawMesh(*ball_vec_[ballCount]);
-	}
-	renderer_3d_->set_override_material(NULL);
+	// translucent, so drawn after everything solid
+	meshDraws += DrawGhosts();
 
 	renderer_3d_->End();
 
@@ -1641,9 +1983,6 @@ void SceneApp::IntervalInit()
 	char1 = 0;
 	char2 = 0;
 	leaderboardSway = 0;
-
-	logo = CreateTextureFromPNG("logo.png", platform_);
-	crossButton = CreateTextureFromPNG("playstation-cross-dark-icon.png", platform_);
 }
 
 void SceneApp::IntervalRelease()
@@ -1655,12 +1994,9 @@ void SceneApp::IntervalRelease()
 	char1 = NULL;
 	char2 = NULL;
 	leaderboardSway = NULL;
-
-	delete crossButton;
-	crossButton = NULL;
 }
 
-bool SceneApp::IntervalUpdate(float frame_time)
+void SceneApp::IntervalUpdate(float frame_time)
 {
 	timer += frame_time;
 
@@ -1672,7 +2008,7 @@ bool SceneApp::IntervalUpdate(float frame_time)
 		if (timer > 3)
 		{
 			IntervalRelease();
-			gameState = MENU;
+			ChangeState(MENU);
 			FrontendInit();
 		}
 		break;
@@ -1681,11 +2017,13 @@ bool SceneApp::IntervalUpdate(float frame_time)
 		{
 			if (CheckHighScore())
 			{
-				gameState = NEWSCORE;
+				ChangeState(NEWSCORE);
 			}
 			else
 			{
-				gameState = LEADERBOARD;
+				// off the board, but still part of the machine's history
+				RecordScore("---", false);
+				ChangeState(LEADERBOARD);
 			}
 		}
 		break;
@@ -1704,14 +2042,9 @@ bool SceneApp::IntervalUpdate(float frame_time)
 				tempStr.push_back(alph[char1]);
 				tempStr.push_back(alph[char2]);
 
-				std::pair<std::string, unsigned int> temp;
-				temp.first = tempStr;
-				temp.second = points;
-				scores.insert(scorePos, temp);
-
-				SaveScores();
+				RecordScore(tempStr.c_str(), true);
 				timer = 0;
-				gameState = LEADERBOARD;
+				ChangeState(LEADERBOARD);
 			}
 			break;
 		case (gef_SONY_CTRL_RIGHT):
@@ -1774,23 +2107,20 @@ bool SceneApp::IntervalUpdate(float frame_time)
 		if (controller->buttons_pressed() == gef_SONY_CTRL_CROSS)
 		{
 			IntervalRelease();
-			gameState = MENU;
+			ChangeState(MENU);
 			FrontendInit();
 		}
 		break;
 	case SceneApp::EXIT:
 		if (timer > 1)
 		{
-			SaveScores();
 			IntervalRelease();
-			return false;
+			running = false;
 		}
 		break;
 	default:
 		break;
 	}
-
-	return true;
 }
 
 void SceneApp::IntervalRender()
@@ -1811,7 +2141,7 @@ void SceneApp::IntervalRender()
 			0xffffffff,
 			gef::TJ_CENTRE,
 			"Initialising Game");
-		button.set_texture(logo);
+		ui_atlas_->SetSprite(button, logo);
 		button.set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.5f, -0.99f));
 		button.set_height(202.f);
 		button.set_width(342.f);
@@ -1833,7 +2163,7 @@ void SceneApp::IntervalRender()
 			gef::TJ_CENTRE,
 			"Your score: %i", points);
 
-		button.set_texture(crossButton);
+		ui_atlas_->SetSprite(button, crossButton);
 		button.set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.8f, -0.99f));
 		button.set_height(40.0f);
 		button.set_width(40.0f);
@@ -1866,7 +2196,7 @@ void SceneApp::IntervalRender()
 			gef::TJ_CENTRE,
 			"Enter your name below using the dpad:");
 
-		button.set_texture(crossButton);
+		ui_atlas_->SetSprite(button, crossButton);
 		button.set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.8f, -0.99f));
 		button.set_height(40.0f);
 		button.set_width(40.0f);
@@ -1883,7 +2213,18 @@ void SceneApp::IntervalRender()
 	case SceneApp::LEADERBOARD:
 		RenderLeaderboard();
 
-		button.set_texture(crossButton);
+		if (lastRank >= 0)
+		{
+			font_->RenderText(
+				sprite_renderer_,
+				gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.8f + 50.0f, -0.99f),
+				1.0f,
+				0xffffffff,
+				gef::TJ_CENTRE,
+				"Rank %i of %u", lastRank + 1, leaderboard_.size());
+		}
+
+		ui_atlas_->SetSprite(button, crossButton);
 		button.set_position(gef::Vector4(platform_.width() * 0.5f, platform_.height() * 0.8f, -0.99f));
 		button.set_height(40.0f);
 		button.set_width(40.0f);
@@ -1917,14 +2258,11 @@ void SceneApp::IntervalRender()
 
 void SceneApp::OptionsInit()
 {
-	circleButton = CreateTextureFromPNG("playstation-circle-dark-icon.png", platform_);
 	optSelected = 0;
 }
 
 void SceneApp::OptionsRelease()
 {
-	delete circleButton;
-	circleButton = NULL;
 	optSelected = NULL;
 }
 
@@ -1934,7 +2272,7 @@ void SceneApp::OptionsUpdate(float frame_time)
 	switch (controller->buttons_pressed())
 	{
 	case (gef_SONY_CTRL_CIRCLE):
-		gameState = MENU;
+		PopState();
 		FrontendInit();
 		break;
 	case (gef_SONY_CTRL_DOWN):
@@ -1977,7 +2315,7 @@ void SceneApp::OptionsUpdate(float frame_time)
 		else if (optSelected == 3)
 		{
 			IntervalInit();
-			gameState = LEADERBOARD;
+			ChangeState(LEADERBOARD);
 			OptionsRelease();
 		}
 		break;
@@ -2065,7 +2403,7 @@ void SceneApp::OptionsRender()
 
 	// Render buttons
 	gef::Sprite button;
-	button.set_texture(circleButton);
+	ui_atlas_->SetSprite(button, circleButton);
 	button.set_position(gef::Vector4(platform_.width()*0.5f, platform_.height()*0.8f, -0.99f));
 	button.set_height(32.0f);
 	button.set_width(32.0f);
@@ -2097,7 +2435,7 @@ void SceneApp::CreditsUpdate(float frame_time)
 	switch (controller->buttons_pressed())
 	{
 	case (1 << 14):
-		gameState = MENU;
+		PopState();
 		FrontendInit();
 		break;
 	default:
@@ -2143,7 +2481,7 @@ void SceneApp::CreditsRender()
 
 	// Render buttons
 	gef::Sprite button;
-	button.set_texture(crossButton);
+	ui_atlas_->SetSprite(button, crossButton);
 	button.set_position(gef::Vector4(platform_.width()*0.5f, platform_.height()*0.8f, -0.99f));
 	button.set_height(32.0f);
 	button.set_width(32.0f);
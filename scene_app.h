@@ -9,7 +9,30 @@
 #include <audio/audio_manager.h>
 #include "graphics/scene.h"
 #include <box2d/box2d.h>
-#include "game_object.h"
+#include "entity_store.h"
+#include "cached_font.h"
+#include "texture_atlas.h"
+#include "async_texture_loader.h"
+#include "resource_manager.h"
+#include "asset_pack.h"
+#include "music_stream.h"
+#include "audio_mixer.h"
+#include "gef_voice_backend.h"
+#include "audio_thread.h"
+#include "leaderboard.h"
+#include "score_store.h"
+#include "leaderboard_sync.h"
+#include "replay.h"
+#include "ghost_track.h"
+#include "arena.h"
+#include "physics_allocator.h"
+#include "job_system.h"
+#include "frame_graph.h"
+#include "input_events.h"
+#include "flipper_latency.h"
+#include "profiler.h"
+#include "perf_overlay.h"
+#include "alloc_tracker.h"
 #include <vector>
 #include <random>
 #include <iostream>
@@ -21,7 +44,6 @@ namespace gef
 {
 	class Platform;
 	class SpriteRenderer;
-	class Font;
 	class InputManager;
 	class Renderer3D;
 }
@@ -39,21 +61,30 @@ private:
 	void InitBoard();
 	void InitBarriers();
 	void InitBumpers();
-	void InitFlipperBumpers();
 	void InitFlippers();
 	void InitLoseTrigger();
 
 	bool CheckBarriers();
+	void ResetBarriers();
+	void DriveFlippers(bool left, float speed);
+	void ApplyFlipperButtons();
+	void TrackFlipperMotion();
 
 	void LoadScores();
-	void SaveScores();
 	void ResetScores();
 	bool CheckHighScore();
+	void RecordScore(const char* name, bool publish);
+
+	uint8_t FlipperBits() const;
+	void RecordReplayBalls();
+
+	void LoadGhosts();
+	void UpdateGhosts();
+	int DrawGhosts();
 
 	void RenderScores();
 	void RenderLeaderboard();
 
-	gef::Scene* LoadSceneAssets(gef::Platform& platform, const char* filename);
 	gef::Mesh* GetMeshFromSceneAssets(gef::Scene* scene);
 
 	void InitFont();
@@ -65,35 +96,110 @@ private:
 
 	bool contacted;
 	void UpdateSimulation(float frame_time);
-	void LostLife(Ball* dead_ball);
+	bool ContactResponse(b2Fixture* fixture, b2Filter filter, b2Body* other, int sfx);
+	void LostLife(Entity dead_ball);
+
+	// an in-game frame as stages on the job system, see InitGameFrame
+	void InitGameFrame();
+	static void PhysicsStage(void* app);
+	static void TransformStage(void* app);
+	static void ReplayStage(void* app);
+	static void GhostStage(void* app);
     
 	gef::SpriteRenderer* sprite_renderer_;
-	gef::Font* font_;
+	CachedFont* font_;
 	gef::InputManager* input_manager_;
+
+	// every button change since the game last looked, and the flipper buttons it has seen held
+	InputEventQueue input_events_;
+	uint32_t flipperButtons;
+
+	// how long a flipper button takes to reach the screen, exported after each game
+	FlipperLatency flipper_latency_;
+	float flipperAngles[2];
 	gef::AudioManager* audio_manager_;
 
 	enum GAMESTATE { INIT, MENU, OPTIONS, CREDITS, INGAME, PAUSE, GAMEOVER, NEWSCORE, LEADERBOARD, EXIT };
 	GAMESTATE gameState;
 
-	gef::Texture* simpleBG;
+	// States are a stack, only the top one is updated and drawn. Menus and the pause screen
+	// are pushed over the state they return to, everything else replaces the whole stack.
+	std::vector<GAMESTATE> stateStack;
+	void ChangeState(GAMESTATE state);
+	void PushState(GAMESTATE state);
+	void PopState();
+	bool running;
+
+	// Live bytes each state had allocated when it was last left, by tag. Some of what a state
+	// allocates is meant to outlive it, so a leak is what grows from one visit to the next.
+	size_t stateLiveBytes[EXIT + 1][ALLOC_TAG_COUNT];
+	bool stateLeft[EXIT + 1];
+	void LeaveState(GAMESTATE state);
+
+	// flags every frame that allocated anything, toggled with START and d-pad right
+	bool allocBudget;
+	void CheckFrameBudget();
+
+	// what each state runs, draws and needs resident, and the state it most likely leads to
+	struct StateDesc
+	{
+		const char* name;
+		const ResourceDesc* resources;
+		int resource_count;
+		GAMESTATE next;
+		void (SceneApp::*update)(float frame_time);
+		void (SceneApp::*render)();
+	};
+	static const StateDesc kStates[];
+
+	// sets up a piece of the likely next state each frame, once its resources are resident
+	void PrepareState(GAMESTATE state);
+
+	// decodes PNGs in the background so state transitions never block on them
+	AsyncTextureLoader* texture_loader_;
+	TextureHandle* simpleBG;
+
+	// reference counts textures, scenes and samples and keeps each state's set resident
+	ResourceManager* resource_manager_;
+	GAMESTATE residentState;
+	void UpdateResidency();
+
+	// baked media built by tools/asset_packer, mapped once for the lifetime of the app
+	AssetPack asset_pack_;
+
+	// UI icons and font page, packed into one texture so menus share a single bind
+	TextureAtlas* ui_atlas_;
+	void InitAtlas();
 
 	int soundFX[3];
-	int musicSFX;
+
+	// sound effects share a fixed voice pool with the streamed music in one software mix
+	GefVoiceBackend* voice_backend_;
+	AudioMixer* mixer_;
+	AudioOutput* audio_output_;
+
+	// every audio request from the game goes through here and never waits on the backend
+	AudioThread* audio_thread_;
+
+	// music is streamed from disk in small chunks rather than loaded whole each game
+	MusicStream* music_;
+
+	// runs frame stages across the spare cores, the main thread taking part
+	JobSystem* job_system_;
 
 	//
 	// FRONTEND DECLARATIONS
 	//
-	gef::Texture* crossButton;
-	gef::Texture* squareButton;
-	gef::Texture* circleButton;
-	gef::Texture* triangleButton;
+	int crossButton;
+	int squareButton;
+	int circleButton;
+	int triangleButton;
 
 	//
 	// INTERVAL DECLARATIONS
 	//
-	gef::Texture* logo;
+	int logo;
 	float timer;
-	std::vector<std::pair<std::string, unsigned int>>::iterator scorePos;
 	std::vector<char> alph;
 	int charSelected, char0, char1, char2;
 	float leaderboardSway;
@@ -110,46 +216,57 @@ private:
 	//
 	gef::Renderer3D* renderer_3d_;
 	PrimitiveBuilder* primitive_builder_;
-	gef::Texture* spaceBG;
+	TextureHandle* spaceBG;
 
 	int lives;
 	int points;
-	std::vector<std::pair<std::string, unsigned int>> scores;
+
+	// every game played on this machine, ranked, with the rows on screen copied out
+	Leaderboard leaderboard_;
+	std::vector<LeaderboardEntry> topScores;
+	int lastRank;
+
+	// checksummed index and journal, written in the background
+	ScoreStore score_store_;
+
+	// uploads named scores to the venue server, NULL when the table is not configured for one
+	LeaderboardSync* leaderboard_sync_;
+
+	// the game in progress, saved alongside its entry if it makes the board
+	ReplayWriter replay_;
+	uint32_t simStep;
 
 	// create the physics world
 	b2World* world_;
 
-	// ball variables
-	std::vector<Ball*> ball_vec_;
-	std::vector<b2Body*> ball_body_vec_;
+	// what Box2D allocates for world_, see PhysicsPoolScope
+	PhysicsPool physics_pool_;
+
+	// how far building the table has got, it is built once and kept for every game
+	int tableBuildStep;
+
+	// the stages of one step of the game, and the frame time they are stepping
+	FrameGraph game_frame_;
+	float game_frame_time_;
 
-	// board variables
+	// every element of the table, the balls included
+	EntityStore entities_;
 	gef::Scene* scene_assets_;
-	GameObject board_;
-	b2Body* board_body_;
-
-	// barrier variables
-	gef::Mesh* barrier_mesh_;
-	std::vector<Barrier*> barrier_vec_;
-	std::vector<b2Body*> barrier_body_vec_;
-	b2Fixture* barrier_fixture;
-
-	// bumper variables
-	gef::Mesh* bumper_mesh_;
-	std::vector<GameObject*> bumper_vec_;
-	std::vector<b2Body*> bumper_body_vec_;
-
-	// flipper variables
-	gef::Mesh* flipper_mesh_;
-	std::vector<Flipper*> flipper_vec_;
-	std::vector<b2Body*> flipper_body_vec_;
-	std::vector<b2Body*> flipper_pin_body_vec_;
-	std::vector<b2RevoluteJoint*> flipper_joint_vec_;
-
-	// lose trigger variables
-	gef::Mesh* lose_trigger_mesh_;
-	GameObject lose_trigger_;
-	b2Body* lose_trigger_body_;
+
+	// meshes built for the table, freed with it
+	std::vector<gef::Mesh*> table_meshes_;
+
+	// everything allocated for the game in progress, reset in one go by GameRelease
+	Arena game_arena_;
+
+	// ghost variables, the best games replayed alongside this one without touching world_
+	static const int kGhostCount = 3;
+	GhostTrack ghosts_[kGhostCount];
+	ReplayBall ghost_balls_[kGhostCount][GhostTrack::kMaxBalls];
+	unsigned int ghost_ball_count_[kGhostCount];
+	gef::Mesh* ghost_mesh_;
+	gef::Material ghost_material_;
+	gef::MeshInstance ghost_;
 
 	// audio variables
 	int sfx_id_;
@@ -157,19 +274,29 @@ private:
 
 	float fps_;
 
+	// frame times and counters, shown over every state with START
+	PerfOverlay perf_overlay_;
+	float physicsStepMs;
+	int meshDraws;
+	uint64_t lastPhysicsAllocations;
+	void CountFrame(float frame_time);
+
 	void FrontendInit();
 	void FrontendRelease();
 	void FrontendUpdate(float frame_time);
 	void FrontendRender();
 
 	void GameInit();
+	bool GameBuildStep();
+	void GameReset();
 	void GameRelease();
+	void GameDestroy();
 	void GameUpdate(float frame_time);
 	void GameRender();
 
 	void IntervalInit();
 	void IntervalRelease();
-	bool IntervalUpdate(float frame_time);
+	void IntervalUpdate(float frame_time);
 	void IntervalRender();
 
 	void OptionsInit();
@@ -0,0 +1,612 @@
+#include "score_store.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
+#include <system/debug_log.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define SCORE_STORE_FSYNC
+#endif
+
+namespace
+{
+	const uint32_t kScoreMagic = 0x31524353;	// "SCR1"
+	const uint32_t kScoreVersion = 2;
+
+	struct ScoreHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t record_count;
+		// every entry with a lower sequence is in the index, so the journal replays the rest
+		uint32_t next_sequence;
+	};
+
+	// version 1 table of at most 10 entries, read once to convert it
+	struct RecordVersion1
+	{
+		char name[16];
+		uint32_t score;
+		uint32_t crc;
+	};
+
+	uint32_t Crc32(const void* data, size_t size)
+	{
+		static uint32_t table[256];
+		static bool tableBuilt = false;
+		if (!tableBuilt)
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+					value = value & 1 ? 0xedb88320 ^ (value >> 1) : value >> 1;
+				table[i] = value;
+			}
+			tableBuilt = true;
+		}
+
+		const unsigned char* bytes = (const unsigned char*)data;
+		uint32_t crc = 0xffffffff;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	// FNV-1a over whole words, several times quicker than a byte-wise CRC on a large index
+	uint32_t EntryCheck(const LeaderboardEntry& entry)
+	{
+		uint32_t words[sizeof(LeaderboardEntry) / 4];
+		memcpy(words, &entry, sizeof(words));
+
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < sizeof(words) / 4; i++)
+			hash = (hash ^ words[i]) * 16777619u;
+		return hash;
+	}
+
+	bool RanksBefore(const LeaderboardEntry& a, const LeaderboardEntry& b)
+	{
+		return a.score > b.score || (a.score == b.score && a.sequence < b.sequence);
+	}
+
+	bool FileExists(const std::string& filename)
+	{
+		FILE* file = fopen(filename.c_str(), "rb");
+		if (file)
+			fclose(file);
+		return file != NULL;
+	}
+
+	// flush and close a file, with its data on the disk rather than in the OS cache, so a
+	// power cut after it is renamed into place cannot leave the new name on an empty file
+	bool CloseSynced(FILE* file)
+	{
+		bool written = fflush(file) == 0 && ferror(file) == 0;
+#if defined(_WIN32)
+		written = written && _commit(_fileno(file)) == 0;
+#elif defined(SCORE_STORE_FSYNC)
+		written = written && fsync(fileno(file)) == 0;
+#endif
+		return fclose(file) == 0 && written;
+	}
+
+#if defined(SCORE_STORE_FSYNC)
+	// a rename is only durable once the directory holding it is synced
+	void SyncDirectory(const char* filename)
+	{
+		std::string directory = filename;
+		size_t slash = directory.find_last_of('/');
+		directory = slash == std::string::npos ? "." : directory.substr(0, slash + 1);
+
+		int fd = open(directory.c_str(), O_RDONLY);
+		if (fd != -1)
+		{
+			fsync(fd);
+			close(fd);
+		}
+	}
+#endif
+
+	// replace the index in one step, so readers see the old file or the new one
+	bool ReplaceFile(const char* source, const char* target)
+	{
+#if defined(_WIN32)
+		return MoveFileExA(source, target, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		bool replaced = rename(source, target) == 0;
+		if (!replaced)
+		{
+			// filesystems that refuse to rename over a file; Load falls back to the
+			// temporary if the index goes missing between these two calls
+			remove(target);
+			replaced = rename(source, target) == 0;
+		}
+#if defined(SCORE_STORE_FSYNC)
+		if (replaced)
+			SyncDirectory(target);
+#endif
+		return replaced;
+#endif
+	}
+}
+
+//
+// ScoreStore
+//
+ScoreStore::ScoreStore(const char* filename, const char* legacy_filename) :
+	filename_(filename),
+	journal_filename_(std::string(filename) + ".log"),
+	temp_filename_(std::string(filename) + ".tmp"),
+	legacy_filename_(legacy_filename),
+	writing_(false),
+	quit_(false),
+	retire_legacy_(false),
+	journal_count_(0),
+	failed_writes_(0)
+{
+	// built here so the I/O thread never races to build it
+	Crc32(NULL, 0);
+
+	thread_ = std::thread(&ScoreStore::IoThread, this);
+}
+
+//
+// ~ScoreStore
+//
+ScoreStore::~ScoreStore()
+{
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	condition_.notify_all();
+	thread_.join();
+}
+
+//
+// Load
+//
+bool ScoreStore::Load(Leaderboard& leaderboard)
+{
+	Flush();
+
+	std::vector<LeaderboardEntry> entries;
+	uint32_t nextSequence = 0;
+	bool indexed = ReadIndex(filename_, entries, nextSequence) || ReadIndex(temp_filename_, entries, nextSequence);
+
+	if (indexed)
+	{
+		// damaged records that were dropped may have held the highest sequences, and the
+		// journal is only read from the header's, so new entries must not go below it
+		leaderboard.BuildSorted(entries.empty() ? NULL : &entries[0], (unsigned int)entries.size());
+		leaderboard.ReserveSequences(nextSequence);
+	}
+	else if (!FileExists(filename_) && !FileExists(temp_filename_) && !FileExists(journal_filename_) && ReadLegacy(entries))
+	{
+		// the rewrite empties the journal and a damaged index must not be replaced by the
+		// old table, so it is only converted before the store has written anything at all;
+		// the first rewrite renames it out of the way
+		gef::DebugOut("ScoreStore: converting %s\n", legacy_filename_.c_str());
+		leaderboard.Clear();
+		for (size_t i = 0; i < entries.size(); i++)
+			leaderboard.Insert(entries[i].name, entries[i].score);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			retire_legacy_ = true;
+		}
+		Rewrite(leaderboard);
+		return true;
+	}
+	else
+	{
+		leaderboard.Clear();
+	}
+
+	std::vector<LeaderboardEntry> journal;
+	unsigned int journalCount = ReadJournal(nextSequence, journal);
+	for (size_t i = 0; i < journal.size(); i++)
+	{
+		leaderboard.Insert(journal[i]);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		journal_count_ = journalCount;
+	}
+	return leaderboard.size() > 0;
+}
+
+//
+// Append
+//
+void ScoreStore::Append(const LeaderboardEntry& entry)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!jobs_.empty() && jobs_.back().type == JOB_APPEND)
+		{
+			jobs_.back().entries.push_back(entry);
+		}
+		else
+		{
+			Job job;
+			job.type = JOB_APPEND;
+			job.entries.push_back(entry);
+			jobs_.push_back(job);
+		}
+	}
+	condition_.notify_all();
+}
+
+//
+// Rewrite
+//
+void ScoreStore::Rewrite(const Leaderboard& leaderboard)
+{
+	Job job;
+	job.type = JOB_REWRITE;
+	leaderboard.GetRange(0, leaderboard.size(), job.entries);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(job);
+	}
+	condition_.notify_all();
+}
+
+//
+// WriteAttachment
+//
+void ScoreStore::WriteAttachment(const char* filename, std::vector<unsigned char>& data)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(Job());
+		jobs_.back().type = JOB_ATTACHMENT;
+		jobs_.back().filename = filename;
+		jobs_.back().data.swap(data);
+	}
+	condition_.notify_all();
+}
+
+//
+// RemoveAttachment
+//
+void ScoreStore::RemoveAttachment(const char* filename)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(Job());
+		jobs_.back().type = JOB_REMOVE;
+		jobs_.back().filename = filename;
+	}
+	condition_.notify_all();
+}
+
+//
+// Flush
+//
+void ScoreStore::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	condition_.wait(lock, [this] { return jobs_.empty() && !writing_; });
+}
+
+//
+// ReadIndex
+//
+bool ScoreStore::ReadIndex(const std::string& filename, std::vector<LeaderboardEntry>& entries, uint32_t& next_sequence) const
+{
+	entries.clear();
+
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (!file)
+		return false;
+
+	ScoreHeader header;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == kScoreMagic;
+	if (valid && header.version == 1)
+	{
+		// record_count sits where version 1 kept it, the rest of its header is a checksum
+		fseek(file, sizeof(header), SEEK_SET);
+		valid = ReadVersion1(file, entries) && entries.size() <= header.record_count;
+		fclose(file);
+		next_sequence = (uint32_t)entries.size();
+		return valid && !entries.empty();
+	}
+
+	// a file cut short keeps the whole records before the cut
+	std::vector<Record> records;
+	valid = valid && header.version == kScoreVersion;
+	if (valid && header.record_count > 0)
+	{
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, sizeof(header), SEEK_SET);
+		size_t present = size > (long)sizeof(header) ? (size_t)(size - sizeof(header)) / sizeof(Record) : 0;
+		records.resize(std::min((size_t)header.record_count, present));
+		if (!records.empty())
+			records.resize(fread(&records[0], sizeof(Record), records.size(), file));
+	}
+	fclose(file);
+
+	if (!valid)
+		return false;
+
+	// keep the records that survived even if the file as a whole did not
+	entries.reserve(records.size());
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		if (EntryCheck(records[i].entry) != records[i].check)
+			continue;
+
+		records[i].entry.name[sizeof(records[i].entry.name) - 1] = '\0';
+		entries.push_back(records[i].entry);
+	}
+
+	if (entries.size() != header.record_count)
+		gef::DebugOut("ScoreStore: %s damaged, kept %i of %u records\n", filename.c_str(), (int)entries.size(), header.record_count);
+
+	next_sequence = header.next_sequence;
+	return true;
+}
+
+//
+// ReadVersion1
+//
+bool ScoreStore::ReadVersion1(FILE* file, std::vector<LeaderboardEntry>& entries) const
+{
+	RecordVersion1 record;
+	while (fread(&record, sizeof(record), 1, file) == 1)
+	{
+		if (Crc32(&record, offsetof(RecordVersion1, crc)) != record.crc)
+			continue;
+
+		LeaderboardEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		strncpy(entry.name, record.name, sizeof(entry.name) - 1);
+		entry.score = record.score;
+		entry.sequence = (uint32_t)entries.size();
+		entries.push_back(entry);
+	}
+	return true;
+}
+
+//
+// ReadJournal
+//
+// Returns how many records the journal holds, replayed or not
+//
+unsigned int ScoreStore::ReadJournal(uint32_t first_sequence, std::vector<LeaderboardEntry>& entries) const
+{
+	FILE* file = fopen(journal_filename_.c_str(), "rb");
+	if (!file)
+		return 0;
+
+	// a record cut short by a crash is simply not read
+	unsigned int count = 0;
+	Record record;
+	while (fread(&record, sizeof(record), 1, file) == 1)
+	{
+		count++;
+		if (EntryCheck(record.entry) != record.check || record.entry.sequence < first_sequence)
+			continue;
+
+		record.entry.name[sizeof(record.entry.name) - 1] = '\0';
+		entries.push_back(record.entry);
+	}
+	fclose(file);
+	return count;
+}
+
+//
+// ReadLegacy
+//
+// name,score per line; lines that do not parse are skipped
+//
+bool ScoreStore::ReadLegacy(std::vector<LeaderboardEntry>& entries) const
+{
+	FILE* file = fopen(legacy_filename_.c_str(), "r");
+	if (!file)
+		return false;
+
+	char line[128];
+	while (fgets(line, sizeof(line), file))
+	{
+		char* comma = strchr(line, ',');
+		if (!comma || comma == line)
+			continue;
+
+		char* end = NULL;
+		unsigned long score = strtoul(comma + 1, &end, 10);
+		if (end == comma + 1)
+			continue;
+
+		LeaderboardEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		strncpy(entry.name, std::string(line, comma).c_str(), sizeof(entry.name) - 1);
+		entry.score = (uint32_t)score;
+		entries.push_back(entry);
+	}
+	fclose(file);
+
+	return !entries.empty();
+}
+
+//
+// WriteIndex
+//
+// Entries must already be in rank order
+//
+bool ScoreStore::WriteIndex(const std::vector<LeaderboardEntry>& entries)
+{
+	ScoreHeader header;
+	header.magic = kScoreMagic;
+	header.version = kScoreVersion;
+	header.record_count = (uint32_t)entries.size();
+	header.next_sequence = 0;
+
+	std::vector<Record> records(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		records[i].entry = entries[i];
+		records[i].check = EntryCheck(entries[i]);
+		header.next_sequence = std::max(header.next_sequence, entries[i].sequence + 1);
+	}
+
+	FILE* file = fopen(temp_filename_.c_str(), "wb");
+	if (!file)
+		return false;
+
+	fwrite(&header, sizeof(header), 1, file);
+	if (!records.empty())
+		fwrite(&records[0], sizeof(Record), records.size(), file);
+
+	if (!CloseSynced(file) || !ReplaceFile(temp_filename_.c_str(), filename_.c_str()))
+		return false;
+
+	// everything in the journal is in the index now; if this is lost to a crash
+	// the stale records are skipped by sequence
+	FILE* journal = fopen(journal_filename_.c_str(), "wb");
+	if (journal)
+		fclose(journal);
+	return true;
+}
+
+//
+// WriteWholeFile
+//
+bool ScoreStore::WriteWholeFile(const std::string& filename, const std::vector<unsigned char>& data)
+{
+	// written beside the target and renamed, so a reader never finds half a file
+	std::string tempFilename = filename + ".tmp";
+	FILE* file = fopen(tempFilename.c_str(), "wb");
+	if (!file)
+		return false;
+
+	if (!data.empty())
+		fwrite(&data[0], 1, data.size(), file);
+
+	return CloseSynced(file) && ReplaceFile(tempFilename.c_str(), filename.c_str());
+}
+
+//
+// AppendJournal
+//
+bool ScoreStore::AppendJournal(const std::vector<LeaderboardEntry>& entries)
+{
+	FILE* file = fopen(journal_filename_.c_str(), "ab");
+	if (!file)
+		return false;
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		Record record;
+		record.entry = entries[i];
+		record.check = EntryCheck(entries[i]);
+		fwrite(&record, sizeof(record), 1, file);
+	}
+
+	return CloseSynced(file);
+}
+
+//
+// Compact
+//
+// Merge the journal into the index
+//
+bool ScoreStore::Compact()
+{
+	std::vector<LeaderboardEntry> index, journal;
+	uint32_t nextSequence = 0;
+	if (!ReadIndex(filename_, index, nextSequence))
+		ReadIndex(temp_filename_, index, nextSequence);
+	ReadJournal(nextSequence, journal);
+
+	std::sort(journal.begin(), journal.end(), RanksBefore);
+	std::vector<LeaderboardEntry> merged(index.size() + journal.size());
+	std::merge(index.begin(), index.end(), journal.begin(), journal.end(), merged.begin(), RanksBefore);
+
+	return WriteIndex(merged);
+}
+
+//
+// IoThread
+//
+void ScoreStore::IoThread()
+{
+	Profiler::SetThreadName("score io");
+	AllocTagScope alloc_scope(ALLOC_SCORES);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;)
+	{
+		condition_.wait(lock, [this] { return quit_ || !jobs_.empty(); });
+		if (jobs_.empty())
+			return;
+
+		Job job;
+		job.type = jobs_.front().type;
+		job.entries.swap(jobs_.front().entries);
+		job.filename.swap(jobs_.front().filename);
+		job.data.swap(jobs_.front().data);
+		jobs_.pop_front();
+		writing_ = true;
+
+		bool compact = job.type == JOB_APPEND && journal_count_ + job.entries.size() >= kCompactEntries;
+		bool retire = job.type == JOB_REWRITE && retire_legacy_;
+		lock.unlock();
+
+		bool written = false;
+		switch (job.type)
+		{
+		case JOB_APPEND:
+			written = AppendJournal(job.entries);
+			if (written && compact)
+				written = Compact();
+			break;
+		case JOB_REWRITE:
+			written = WriteIndex(job.entries);
+			if (written && retire && !ReplaceFile(legacy_filename_.c_str(), (legacy_filename_ + ".converted").c_str()))
+				gef::DebugOut("ScoreStore: could not rename %s\n", legacy_filename_.c_str());
+			break;
+		case JOB_ATTACHMENT:
+			written = WriteWholeFile(job.filename, job.data);
+			break;
+		case JOB_REMOVE:
+			written = remove(job.filename.c_str()) == 0 || errno == ENOENT;
+			break;
+		}
+
+		lock.lock();
+		if (!written)
+		{
+			failed_writes_++;
+			gef::DebugOut("ScoreStore: could not %s %s\n", job.type == JOB_REMOVE ? "remove" : "write",
+				job.type == JOB_ATTACHMENT || job.type == JOB_REMOVE ? job.filename.c_str() : filename_.c_str());
+		}
+		else if (job.type == JOB_REWRITE || compact)
+		{
+			journal_count_ = 0;
+			retire_legacy_ = retire_legacy_ && !retire;
+		}
+		else if (job.type == JOB_APPEND)
+			journal_count_ += (unsigned int)job.entries.size();
+
+		writing_ = false;
+		condition_.notify_all();
+	}
+}
@@ -0,0 +1,108 @@
+#ifndef _SCORE_STORE_H
+#define _SCORE_STORE_H
+
+#include "leaderboard.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Persists the leaderboard as a rank-ordered index of fixed, checksummed records plus a
+// journal of the entries added since. New scores are appended to the journal on a background
+// thread; once enough pile up the thread merges them into a new index written to a temporary
+// file and renamed over the old one, so a crash part way through never loses the table.
+class ScoreStore
+{
+public:
+	/// @brief Constructor. Starts the I/O thread.
+	/// @param[in] filename		The index. The journal and temporary files are named after it.
+	/// @param[in] legacy_filename	The old comma separated table, read once if the store has no files
+	/// yet and renamed with a .converted suffix once the index replacing it is written.
+	ScoreStore(const char* filename, const char* legacy_filename);
+
+	/// @brief Default destructor. Finishes any pending write.
+	~ScoreStore();
+
+	/// @brief Reads the index and replays the journal, dropping any record whose checksum does not match.
+	/// @return false if nothing valid was found and the leaderboard was left empty
+	/// @param[out] leaderboard	Replaced with the stored entries.
+	bool Load(Leaderboard& leaderboard);
+
+	/// @brief Queues an entry to be appended to the journal. Returns immediately.
+	void Append(const LeaderboardEntry& entry);
+
+	/// @brief Queues the whole table to replace the index and empty the journal.
+	void Rewrite(const Leaderboard& leaderboard);
+
+	/// @brief Queues a file that belongs with an entry, such as its replay, to be written.
+	/// @param[in] filename		The file to write.
+	/// @param[in,out] data		The contents, taken by swapping so the caller is left with an empty vector.
+	void WriteAttachment(const char* filename, std::vector<unsigned char>& data);
+
+	/// @brief Queues a file that belonged with an entry to be deleted, after any write to it still queued.
+	/// A file that is already gone counts as deleted.
+	void RemoveAttachment(const char* filename);
+
+	/// @brief Blocks until every queued write has finished.
+	void Flush();
+
+	/// @brief Get the number of writes that failed.
+	inline unsigned int failed_writes() const { return failed_writes_; }
+
+	// journal entries merged into the index at once
+	static const unsigned int kCompactEntries = 256;
+
+private:
+	struct Record
+	{
+		LeaderboardEntry entry;
+		uint32_t check;
+	};
+
+	enum JOB_TYPE
+	{
+		JOB_APPEND,
+		JOB_REWRITE,
+		JOB_ATTACHMENT,
+		JOB_REMOVE,
+	};
+
+	struct Job
+	{
+		JOB_TYPE type;
+		std::vector<LeaderboardEntry> entries;
+		std::string filename;
+		std::vector<unsigned char> data;
+	};
+
+	bool ReadIndex(const std::string& filename, std::vector<LeaderboardEntry>& entries, uint32_t& next_sequence) const;
+	bool ReadVersion1(FILE* file, std::vector<LeaderboardEntry>& entries) const;
+	unsigned int ReadJournal(uint32_t first_sequence, std::vector<LeaderboardEntry>& entries) const;
+	bool ReadLegacy(std::vector<LeaderboardEntry>& entries) const;
+	bool WriteIndex(const std::vector<LeaderboardEntry>& entries);
+	bool AppendJournal(const std::vector<LeaderboardEntry>& entries);
+	bool WriteWholeFile(const std::string& filename, const std::vector<unsigned char>& data);
+	bool Compact();
+	void IoThread();
+
+	std::string filename_;
+	std::string journal_filename_;
+	std::string temp_filename_;
+	std::string legacy_filename_;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::deque<Job> jobs_;
+	bool writing_;
+	bool quit_;
+	// the legacy table was converted and is renamed once the index is written
+	bool retire_legacy_;
+	unsigned int journal_count_;
+	unsigned int failed_writes_;
+};
+
+#endif // _SCORE_STORE_H
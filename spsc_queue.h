@@ -0,0 +1,60 @@
+#ifndef _SPSC_QUEUE_H
+#define _SPSC_QUEUE_H
+
+#include <atomic>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer thread.
+// Neither side ever waits: Push fails when the ring is full and Pop when it is empty.
+template <typename T, unsigned int Capacity>
+class SpscQueue
+{
+public:
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	SpscQueue() :
+		head_(0),
+		tail_(0)
+	{
+	}
+
+	/// @brief Adds an item. Producer thread only.
+	/// @return false if the ring is full and the item was not added
+	bool Push(const T& item)
+	{
+		unsigned int tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		items_[tail & (Capacity - 1)] = item;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// @brief Removes the oldest item. Consumer thread only.
+	/// @return false if the ring is empty
+	bool Pop(T& item)
+	{
+		unsigned int head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return false;
+
+		item = items_[head & (Capacity - 1)];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// @brief Get an estimate of the number of queued items, exact only on the consumer thread.
+	unsigned int size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+private:
+	// keep the two indices on separate cache lines so the threads do not share one
+	static const int kCacheLine = 64;
+
+	T items_[Capacity];
+	std::atomic<unsigned int> head_;
+	char head_padding_[kCacheLine - sizeof(std::atomic<unsigned int>)];
+	std::atomic<unsigned int> tail_;
+	char tail_padding_[kCacheLine - sizeof(std::atomic<unsigned int>)];
+};
+
+#endif // _SPSC_QUEUE_H
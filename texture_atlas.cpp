@@ -0,0 +1,198 @@
+#include "texture_atlas.h"
+#include "load_texture.h"
+#include <graphics/image_data.h>
+#include <graphics/texture.h>
+#include <graphics/sprite.h>
+#include <system/debug_log.h>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// one pixel gap stops bilinear filtering bleeding between neighbours
+	const int kPadding = 1;
+
+	struct TallestFirst
+	{
+		TallestFirst(const std::vector<int>& heights) : heights_(heights) {}
+		bool operator()(int a, int b) const { return heights_[a] > heights_[b]; }
+		const std::vector<int>& heights_;
+	};
+}
+
+//
+// TextureAtlas
+//
+TextureAtlas::TextureAtlas(gef::Platform& platform) :
+	platform_(platform),
+	texture_(NULL)
+{
+}
+
+//
+// ~TextureAtlas
+//
+TextureAtlas::~TextureAtlas()
+{
+	delete texture_;
+	texture_ = NULL;
+}
+
+//
+// AddImage
+//
+int TextureAtlas::AddImage(const char* png_filename)
+{
+	int existing = FindRegion(png_filename);
+	if (existing != -1)
+		return existing;
+
+	gef::ImageData image_data;
+	if (!LoadImageData(png_filename, platform_, image_data))
+	{
+		gef::DebugOut("Atlas image %s failed to load\n", png_filename);
+		return -1;
+	}
+
+	PendingImage image;
+	image.name = png_filename;
+	image.width = image_data.width();
+	image.height = image_data.height();
+	image.x = 0;
+	image.y = 0;
+	image.pixels.assign(image_data.image(), image_data.image() + image.width * image.height * 4);
+	images_.push_back(image);
+
+	AtlasRegion region;
+	region.uv_position = gef::Vector2(0.f, 0.f);
+	region.uv_width = 1.f;
+	region.uv_height = 1.f;
+	region.width = (float)image.width;
+	region.height = (float)image.height;
+	regions_.push_back(region);
+
+	return (int)images_.size() - 1;
+}
+
+//
+// Build
+//
+bool TextureAtlas::Build(int max_size)
+{
+	if (images_.empty())
+		return false;
+
+	// grow the atlas until every image fits on a shelf
+	int size = 256;
+	while (!Pack(size))
+	{
+		size *= 2;
+		if (size > max_size)
+		{
+			gef::DebugOut("Atlas images do not fit in %ix%i\n", max_size, max_size);
+			return false;
+		}
+	}
+
+	// the image data takes ownership of the buffer
+	UInt8* buffer = new UInt8[size * size * 4];
+	memset(buffer, 0, size * size * 4);
+
+	for (size_t i = 0; i < images_.size(); i++)
+	{
+		const PendingImage& image = images_[i];
+		for (int row = 0; row < image.height; row++)
+		{
+			memcpy(&buffer[((image.y + row) * size + image.x) * 4], &image.pixels[row * image.width * 4], image.width * 4);
+		}
+
+		AtlasRegion& region = regions_[i];
+		region.uv_position = gef::Vector2((float)image.x / size, (float)image.y / size);
+		region.uv_width = (float)image.width / size;
+		region.uv_height = (float)image.height / size;
+	}
+
+	gef::ImageData image_data;
+	image_data.set_width(size);
+	image_data.set_height(size);
+	image_data.set_image(buffer);
+
+	delete texture_;
+	texture_ = gef::Texture::Create(platform_, image_data);
+
+	// the decoded source pixels are no longer needed
+	for (size_t i = 0; i < images_.size(); i++)
+	{
+		std::vector<unsigned char>().swap(images_[i].pixels);
+	}
+
+	gef::DebugOut("Packed %i images into a %ix%i atlas\n", (int)images_.size(), size, size);
+	return texture_ != NULL;
+}
+
+//
+// FindRegion
+//
+int TextureAtlas::FindRegion(const char* name) const
+{
+	for (size_t i = 0; i < images_.size(); i++)
+	{
+		if (images_[i].name == name)
+			return (int)i;
+	}
+	return -1;
+}
+
+//
+// SetSprite
+//
+void TextureAtlas::SetSprite(gef::Sprite& sprite, int region) const
+{
+	if (region < 0 || region >= (int)regions_.size())
+		return;
+
+	sprite.set_texture(texture_);
+	sprite.set_uv_position(regions_[region].uv_position);
+	sprite.set_uv_width(regions_[region].uv_width);
+	sprite.set_uv_height(regions_[region].uv_height);
+}
+
+//
+// Pack
+//
+// Shelf packing, tallest images first
+//
+bool TextureAtlas::Pack(int size)
+{
+	std::vector<int> heights, order;
+	for (size_t i = 0; i < images_.size(); i++)
+	{
+		heights.push_back(images_[i].height);
+		order.push_back((int)i);
+	}
+	std::stable_sort(order.begin(), order.end(), TallestFirst(heights));
+
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		PendingImage& image = images_[order[i]];
+
+		if (shelfX + image.width > size)
+		{
+			// start a new shelf below the current one
+			shelfY += shelfHeight + kPadding;
+			shelfX = 0;
+			shelfHeight = 0;
+		}
+
+		if (image.width > size || shelfY + image.height > size)
+			return false;
+
+		image.x = shelfX;
+		image.y = shelfY;
+		shelfX += image.width + kPadding;
+		shelfHeight = std::max(shelfHeight, image.height);
+	}
+
+	return true;
+}
@@ -0,0 +1,81 @@
+#ifndef _TEXTURE_ATLAS_H
+#define _TEXTURE_ATLAS_H
+
+#include <maths/vector2.h>
+#include <vector>
+#include <string>
+
+// FRAMEWORK FORWARD DECLARATIONS
+namespace gef
+{
+	class Platform;
+	class Texture;
+	class Sprite;
+}
+
+struct AtlasRegion
+{
+	gef::Vector2 uv_position;
+	float uv_width;
+	float uv_height;
+	float width;
+	float height;
+};
+
+class TextureAtlas
+{
+public:
+	/// @brief Constructor.
+	/// @param[in] platform		The platform the atlas texture is being created on.
+	TextureAtlas(gef::Platform& platform);
+
+	/// @brief Default destructor.
+	~TextureAtlas();
+
+	/// @brief Decodes a PNG and queues it for packing.
+	/// @return The region index, or -1 if the image failed to load
+	/// @param[in] png_filename	The PNG file to add. Also used as the region name.
+	int AddImage(const char* png_filename);
+
+	/// @brief Packs every queued image into a single texture and builds the UV lookup table.
+	/// @return true if all images fit and the texture was created
+	/// @param[in] max_size		The largest width and height the atlas may grow to.
+	bool Build(int max_size = 2048);
+
+	/// @brief Finds a region by the filename it was added with.
+	/// @return The region index, or -1 if not found
+	/// @param[in] name			The filename passed to AddImage.
+	int FindRegion(const char* name) const;
+
+	/// @brief Sets the texture and UVs of a sprite to an atlas region.
+	/// @param[in] sprite		The sprite to set up.
+	/// @param[in] region		The region index.
+	void SetSprite(gef::Sprite& sprite, int region) const;
+
+	/// @brief Get a packed region.
+	/// @return The region UVs and size in pixels
+	inline const AtlasRegion& region(int index) const { return regions_[index]; }
+
+	/// @brief Get the atlas texture.
+	/// @return The texture, NULL before Build
+	inline const gef::Texture* texture() const { return texture_; }
+
+private:
+	struct PendingImage
+	{
+		std::string name;
+		int width, height;
+		int x, y;
+		std::vector<unsigned char> pixels;
+	};
+
+	bool Pack(int size);
+
+	gef::Platform& platform_;
+	gef::Texture* texture_;
+
+	std::vector<PendingImage> images_;
+	std::vector<AtlasRegion> regions_;
+};
+
+#endif // _TEXTURE_ATLAS_H
@@ -0,0 +1,142 @@
+//
+// asset_packer
+//
+// Bakes loose media files into a single indexed pack read by AssetPack.
+//
+// usage: asset_packer <output.pak> <file> [file ...]
+//
+// Each file is stored unchanged under its filename without the directory, so the runtime
+// looks assets up with the same names it passes to the loose-file loaders.
+//
+
+#include "../asset_pack_format.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct PackFile
+	{
+		std::string path;
+		std::string name;
+		std::vector<unsigned char> data;
+	};
+
+	bool ByName(const PackFile& a, const PackFile& b)
+	{
+		return a.name < b.name;
+	}
+
+	std::string BaseName(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+
+	bool ReadFile(const std::string& path, std::vector<unsigned char>& data)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		data.resize(size > 0 ? (size_t)size : 0);
+		bool ok = data.empty() || fread(&data[0], 1, data.size(), file) == data.size();
+		fclose(file);
+		return ok;
+	}
+
+	uint32_t Align(uint32_t offset)
+	{
+		return (offset + kAssetPackAlignment - 1) & ~(kAssetPackAlignment - 1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s <output.pak> <file> [file ...]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<PackFile> files;
+	for (int i = 2; i < argc; i++)
+	{
+		PackFile file;
+		file.path = argv[i];
+		file.name = BaseName(file.path);
+
+		if (file.name.length() >= (size_t)kAssetPackMaxName)
+		{
+			fprintf(stderr, "%s: name longer than %i characters\n", file.path.c_str(), kAssetPackMaxName - 1);
+			return 1;
+		}
+		if (!ReadFile(file.path, file.data))
+		{
+			fprintf(stderr, "%s: could not be read\n", file.path.c_str());
+			return 1;
+		}
+		files.push_back(file);
+	}
+
+	std::sort(files.begin(), files.end(), ByName);
+	for (size_t i = 1; i < files.size(); i++)
+	{
+		if (files[i].name == files[i - 1].name)
+		{
+			fprintf(stderr, "%s: packed twice\n", files[i].name.c_str());
+			return 1;
+		}
+	}
+
+	AssetPackHeader header;
+	header.magic = kAssetPackMagic;
+	header.version = kAssetPackVersion;
+	header.entry_count = (uint32_t)files.size();
+	header.data_offset = Align((uint32_t)(sizeof(AssetPackHeader) + files.size() * sizeof(AssetPackEntry)));
+
+	std::vector<AssetPackEntry> entries(files.size());
+	uint32_t offset = header.data_offset;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		memset(&entries[i], 0, sizeof(AssetPackEntry));
+		strncpy(entries[i].name, files[i].name.c_str(), kAssetPackMaxName - 1);
+		entries[i].offset = offset;
+		entries[i].size = (uint32_t)files[i].data.size();
+		offset = Align(offset + entries[i].size);
+	}
+
+	FILE* output = fopen(argv[1], "wb");
+	if (!output)
+	{
+		fprintf(stderr, "%s: could not be created\n", argv[1]);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(header), 1, output);
+	if (!entries.empty())
+		fwrite(&entries[0], sizeof(AssetPackEntry), entries.size(), output);
+
+	const unsigned char padding[kAssetPackAlignment] = { 0 };
+	uint32_t written = (uint32_t)(sizeof(header) + entries.size() * sizeof(AssetPackEntry));
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		fwrite(padding, 1, entries[i].offset - written, output);
+		if (!files[i].data.empty())
+			fwrite(&files[i].data[0], 1, files[i].data.size(), output);
+		written = entries[i].offset + entries[i].size;
+	}
+
+	bool ok = ferror(output) == 0;
+	fclose(output);
+
+	printf("packed %i files into %s (%u bytes)\n", (int)files.size(), argv[1], written);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,317 @@
+//
+// leaderboard_server
+//
+// Loopback stand-in for a venue score server. Accepts batches from LeaderboardSync, merges
+// every table's scores into one Leaderboard and prints the top of it on exit.
+//
+// usage: leaderboard_server [--port port] [--any] [--fail percent]
+//        leaderboard_server --venue [tables] [scores] [--fail percent]
+//
+// --any accepts other machines, not just this one. --fail drops the reply to that share of
+// batches after accepting them, so clients have to back off and resend. The venue mode runs
+// the server and a sync client per table in one process and checks every score arrives once.
+//
+// build on Linux: g++ -O2 -std=c++11 tools/leaderboard_server.cpp leaderboard_sync.cpp leaderboard.cpp net_socket.cpp profiler.cpp -lpthread
+//
+
+#include "../leaderboard_sync.h"
+#include "../leaderboard_sync_format.h"
+#include "../net_socket.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const unsigned short kDefaultPort = 7777;
+	const int kAcceptPollMs = 100;
+	const int kConnectionTimeoutMs = 2000;
+
+	typedef std::chrono::steady_clock Clock;
+
+	class LoopbackServer
+	{
+	public:
+		LoopbackServer() :
+			fail_percent_(0),
+			quit_(false),
+			verbose_(false),
+			batches_(0),
+			duplicates_(0),
+			rejected_(0),
+			dropped_replies_(0),
+			packed_bytes_(0)
+		{
+		}
+
+		~LoopbackServer()
+		{
+			Stop();
+		}
+
+		bool Start(unsigned short port, bool loopback_only, int fail_percent, bool verbose)
+		{
+			if (!listener_.Listen(port, loopback_only))
+				return false;
+
+			fail_percent_ = fail_percent;
+			verbose_ = verbose;
+			quit_ = false;
+			thread_ = std::thread(&LoopbackServer::ServerThread, this);
+			return true;
+		}
+
+		void Stop()
+		{
+			quit_ = true;
+			if (thread_.joinable())
+				thread_.join();
+			listener_.Close();
+		}
+
+		void PrintSummary()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			printf("%u batches, %u entries from %u sessions, %u duplicates, %u rejected, %u replies dropped, %u bytes packed\n",
+				batches_, leaderboard_.size(), (unsigned int)last_batch_.size(), duplicates_, rejected_, dropped_replies_, packed_bytes_);
+
+			std::vector<LeaderboardEntry> top;
+			leaderboard_.GetRange(0, 10, top);
+			for (size_t i = 0; i < top.size(); i++)
+				printf("%2u. %-11s %08u\n", (unsigned int)i + 1, top[i].name, top[i].score);
+		}
+
+		unsigned int entry_count()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return leaderboard_.size();
+		}
+
+		unsigned int duplicates() const { return duplicates_; }
+		unsigned int packed_bytes() const { return packed_bytes_; }
+
+	private:
+		void ServerThread()
+		{
+			TcpSocket client;
+			while (!quit_)
+			{
+				if (listener_.Accept(client, kAcceptPollMs, kConnectionTimeoutMs))
+				{
+					HandleConnection(client);
+					client.Close();
+				}
+			}
+		}
+
+		void HandleConnection(TcpSocket& client)
+		{
+			SyncBatchHeader header;
+			if (!client.ReceiveAll(&header, sizeof(header)) || header.magic != kSyncMagic)
+				return;
+
+			SyncBatchReply reply;
+			reply.magic = kSyncMagic;
+			reply.batch = header.batch;
+			reply.status = SYNC_REJECTED;
+
+			std::vector<unsigned char> payload;
+			std::vector<LeaderboardEntry> entries;
+			if (header.version == kSyncVersion && header.payload_size <= kSyncMaxPayload)
+			{
+				payload.resize(header.payload_size);
+				if (!client.ReceiveAll(payload.empty() ? NULL : &payload[0], payload.size()))
+					return;
+
+				const unsigned char* data = payload.empty() ? NULL : &payload[0];
+				if (LeaderboardSync::PayloadCheck(data, payload.size()) == header.payload_check &&
+					LeaderboardSync::UnpackEntries(data, payload.size(), header.entry_count, entries))
+				{
+					reply.status = Merge(header, entries);
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				batches_++;
+				packed_bytes_ += header.payload_size;
+				if (reply.status == SYNC_REJECTED)
+					rejected_++;
+				else if (reply.status == SYNC_DUPLICATE)
+					duplicates_++;
+			}
+
+			if (verbose_)
+				printf("table %u batch %u: %u entries in %u bytes, status %u\n", header.table_id, header.batch, header.entry_count, header.payload_size, reply.status);
+
+			// pretend the reply was lost on the way back, after the batch was kept
+			if (fail_percent_ > 0 && rand() % 100 < fail_percent_)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				dropped_replies_++;
+				return;
+			}
+
+			client.SendAll(&reply, sizeof(reply));
+		}
+
+		uint32_t Merge(const SyncBatchHeader& header, const std::vector<LeaderboardEntry>& entries)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			// each session sends its batches in order, one at a time
+			uint64_t key = ((uint64_t)header.table_id << 32) | header.session;
+			std::map<uint64_t, uint32_t>::iterator last = last_batch_.find(key);
+			if (last != last_batch_.end() && header.batch <= last->second)
+				return SYNC_DUPLICATE;
+			last_batch_[key] = header.batch;
+
+			// the venue table orders its own arrivals, table sequences are only unique per table
+			for (size_t i = 0; i < entries.size(); i++)
+				leaderboard_.Insert(entries[i].name, entries[i].score);
+
+			return SYNC_ACCEPTED;
+		}
+
+		TcpSocket listener_;
+		std::thread thread_;
+		int fail_percent_;
+		std::atomic<bool> quit_;
+		bool verbose_;
+
+		std::mutex mutex_;
+		Leaderboard leaderboard_;
+		std::map<uint64_t, uint32_t> last_batch_;
+		unsigned int batches_;
+		unsigned int duplicates_;
+		unsigned int rejected_;
+		unsigned int dropped_replies_;
+		unsigned int packed_bytes_;
+	};
+
+	// a table finishing games as fast as it can, timing how long handing each score over takes
+	void PlayTable(LeaderboardSync* sync, unsigned int table, unsigned int scores, double* worstQueueUs)
+	{
+		*worstQueueUs = 0.0;
+		for (unsigned int i = 0; i < scores; i++)
+		{
+			LeaderboardEntry entry;
+			memset(&entry, 0, sizeof(entry));
+			sprintf(entry.name, "T%02u", table % 100);
+			entry.score = (table * 7919u + i * 104729u) % 1000000u;
+			entry.sequence = i;
+
+			Clock::time_point start = Clock::now();
+			sync->Queue(entry);
+			double queueUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+			if (queueUs > *worstQueueUs)
+				*worstQueueUs = queueUs;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1 + (table + i * 37) % 5));
+		}
+	}
+
+	int RunVenue(unsigned int tables, unsigned int scores, int fail_percent)
+	{
+		LoopbackServer server;
+		if (!server.Start(kDefaultPort, true, fail_percent, false))
+		{
+			fprintf(stderr, "could not listen on port %u\n", kDefaultPort);
+			return 1;
+		}
+
+		Clock::time_point start = Clock::now();
+		std::vector<LeaderboardSync*> syncs;
+		std::vector<std::thread> threads;
+		std::vector<double> worstQueueUs(tables);
+		for (unsigned int i = 0; i < tables; i++)
+			syncs.push_back(new LeaderboardSync("127.0.0.1", kDefaultPort, i));
+		for (unsigned int i = 0; i < tables; i++)
+			threads.push_back(std::thread(PlayTable, syncs[i], i, scores, &worstQueueUs[i]));
+		for (unsigned int i = 0; i < tables; i++)
+			threads[i].join();
+
+		// wait for every table to drain, retries included
+		unsigned int pending = 1;
+		while (pending > 0 && Clock::now() - start < std::chrono::seconds(120))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			pending = 0;
+			for (unsigned int i = 0; i < tables; i++)
+				pending += syncs[i]->pending_entries();
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		unsigned int failed = 0, dropped = 0;
+		double worstUs = 0.0;
+		for (unsigned int i = 0; i < tables; i++)
+		{
+			failed += syncs[i]->failed_attempts();
+			dropped += syncs[i]->dropped_entries();
+			worstUs = worstQueueUs[i] > worstUs ? worstQueueUs[i] : worstUs;
+			delete syncs[i];
+		}
+		server.Stop();
+
+		unsigned int expected = tables * scores;
+		unsigned int received = server.entry_count();
+		printf("%u tables x %u scores in %.2f s: %u of %u received, %u retried attempts, %u duplicate batches, %u dropped\n",
+			tables, scores, seconds, received, expected, failed, server.duplicates(), dropped);
+		printf("%.1f bytes per entry on the wire, worst Queue() %.1f us\n",
+			received ? (double)server.packed_bytes() / received : 0.0, worstUs);
+		server.PrintSummary();
+
+		return received == expected ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned short port = kDefaultPort;
+	bool loopbackOnly = true;
+	bool venue = false;
+	int failPercent = 0;
+	std::vector<unsigned int> counts;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			port = (unsigned short)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--any") == 0)
+			loopbackOnly = false;
+		else if (strcmp(argv[i], "--fail") == 0 && i + 1 < argc)
+			failPercent = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--venue") == 0)
+			venue = true;
+		else if (venue && atoi(argv[i]) > 0)
+			counts.push_back((unsigned int)atoi(argv[i]));
+		else
+		{
+			fprintf(stderr, "usage: %s [--port port] [--any] [--fail percent]\n", argv[0]);
+			fprintf(stderr, "       %s --venue [tables] [scores] [--fail percent]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (venue)
+		return RunVenue(counts.size() > 0 ? counts[0] : 40, counts.size() > 1 ? counts[1] : 50, failPercent);
+
+	LoopbackServer server;
+	if (!server.Start(port, loopbackOnly, failPercent, true))
+	{
+		fprintf(stderr, "could not listen on port %u\n", port);
+		return 1;
+	}
+
+	printf("listening on port %u, press enter to stop\n", port);
+	getchar();
+	server.Stop();
+	server.PrintSummary();
+	return 0;
+}
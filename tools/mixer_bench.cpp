@@ -0,0 +1,136 @@
+//
+// mixer_bench
+//
+// Measures the cost of AudioMixer per voice, then runs a full pool against the audio output
+// (the null output on platforms without a device) to check it keeps up in real time.
+//
+// usage: mixer_bench [max_voices] [blocks]
+//
+// build on Linux: g++ -O2 -std=c++11 tools/mixer_bench.cpp audio_mixer.cpp asset_pack.cpp audio_output.cpp wav_file.cpp profiler.cpp -lpthread
+//
+
+#include "../audio_mixer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const char* kBenchSample = "mixer_bench.wav";
+
+	void WriteU32(FILE* file, unsigned int value)
+	{
+		unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+		fwrite(bytes, 1, 4, file);
+	}
+
+	void WriteU16(FILE* file, unsigned int value)
+	{
+		unsigned char bytes[2] = { (unsigned char)value, (unsigned char)(value >> 8) };
+		fwrite(bytes, 1, 2, file);
+	}
+
+	// ten seconds of 44.1kHz mono tone, long enough that no voice ends during a run
+	bool WriteBenchSample(const char* filename)
+	{
+		const unsigned int rate = 44100, frames = rate * 10;
+		FILE* file = fopen(filename, "wb");
+		if (!file)
+			return false;
+
+		fwrite("RIFF", 1, 4, file);
+		WriteU32(file, 36 + frames * 2);
+		fwrite("WAVEfmt ", 1, 8, file);
+		WriteU32(file, 16);
+		WriteU16(file, 1);
+		WriteU16(file, 1);
+		WriteU32(file, rate);
+		WriteU32(file, rate * 2);
+		WriteU16(file, 2);
+		WriteU16(file, 16);
+		fwrite("data", 1, 4, file);
+		WriteU32(file, frames * 2);
+
+		std::vector<short> samples(frames);
+		for (unsigned int i = 0; i < frames; i++)
+			samples[i] = (short)(8000.0 * sin(i * 0.0627));
+		fwrite(&samples[0], sizeof(short), samples.size(), file);
+
+		bool ok = ferror(file) == 0;
+		fclose(file);
+		return ok;
+	}
+
+	void StartVoices(AudioMixer& mixer, int sample, int count)
+	{
+		// one trigger per update, or they would be coalesced into a single voice
+		for (int i = 0; i < count; i++)
+		{
+			mixer.PlaySample(sample);
+			mixer.Update(0.f);
+		}
+	}
+
+	double TimeBlocks(AudioMixer& mixer, int blocks)
+	{
+		typedef std::chrono::steady_clock Clock;
+		std::vector<float> output(AudioOutput::kBlockFrames * 2);
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < blocks; i++)
+			mixer.Render(&output[0], AudioOutput::kBlockFrames, AudioOutput::kSampleRate);
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / blocks;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int maxVoices = argc >= 2 ? atoi(argv[1]) : 32;
+	int blocks = argc >= 3 ? atoi(argv[2]) : 200;
+	if (maxVoices < 1 || blocks < 1)
+	{
+		fprintf(stderr, "usage: %s [max_voices] [blocks]\n", argv[0]);
+		return 1;
+	}
+
+	if (!WriteBenchSample(kBenchSample))
+	{
+		fprintf(stderr, "%s: could not be written\n", kBenchSample);
+		return 1;
+	}
+
+	printf("%i frame blocks at %i Hz\n", AudioOutput::kBlockFrames, AudioOutput::kSampleRate);
+	double emptyUs = 0.0;
+	for (int voices = 0; voices <= maxVoices; voices = voices ? voices * 2 : 1)
+	{
+		AudioMixer mixer(voices > 0 ? voices : 1);
+		int sample = mixer.LoadSample(kBenchSample);
+		StartVoices(mixer, sample, voices);
+
+		double blockUs = TimeBlocks(mixer, blocks);
+		if (voices == 0)
+			emptyUs = blockUs;
+
+		printf("%3i voices: %8.2f us per block", voices, blockUs);
+		if (voices > 0)
+			printf(", %6.3f us per voice", (blockUs - emptyUs) / voices);
+		printf("\n");
+	}
+
+	AudioMixer mixer(maxVoices);
+	StartVoices(mixer, mixer.LoadSample(kBenchSample), maxVoices);
+	AudioOutput output(&mixer);
+	if (output.Open())
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		output.Close();
+		printf("output: %u blocks in 1 s (%i expected), %.2f us per block with %i voices\n",
+			output.blocks_rendered(), AudioOutput::kSampleRate / AudioOutput::kBlockFrames, output.render_us(), maxVoices);
+	}
+
+	remove(kBenchSample);
+	return 0;
+}
@@ -0,0 +1,205 @@
+//
+// physics_alloc_bench
+//
+// Measures what b2Alloc costs the game. First it replays an allocation churn at the sizes
+// Box2D asks for against PhysicsPool and against malloc. Then it drops balls through a field
+// of pegs, so contacts are made and broken all the time, and steps the world with Box2D
+// allocating from the shared pool, from a pool of its own, and with one world per thread
+// each on its own pool.
+//
+// usage: physics_alloc_bench [steps] [threads]
+//
+// build on Linux: g++ -O2 -std=c++11 -I<box2d>/include tools/physics_alloc_bench.cpp physics_allocator.cpp
+//                     box2d_settings.cpp <box2d sources except b2_settings.cpp> -lpthread
+//
+
+#include "../physics_allocator.h"
+#include <box2d/box2d.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const int kBalls = 200;
+	const int kPegRows = 12;
+	const int kPegColumns = 16;
+
+	double Seconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	class ContactCounter : public b2ContactListener
+	{
+	public:
+		ContactCounter() : begun(0), ended(0) {}
+		void BeginContact(b2Contact* contact) { begun++; }
+		void EndContact(b2Contact* contact) { ended++; }
+
+		unsigned int begun;
+		unsigned int ended;
+	};
+
+	struct ChurnResult
+	{
+		double seconds;
+		unsigned int steps;
+		unsigned int begun;
+		unsigned int ended;
+		PhysicsPoolStats stats;
+	};
+
+	// an open box full of pegs, balls falling through it are put back at the top
+	void RunWorld(PhysicsPool* pool, unsigned int steps, ChurnResult& result)
+	{
+		PhysicsPoolScope scope(pool);
+		PhysicsPoolStats before = PhysicsPool::Current()->stats();
+
+		b2World* world = new b2World(b2Vec2(0.f, -10.f));
+		ContactCounter counter;
+		world->SetContactListener(&counter);
+
+		b2BodyDef staticDef;
+		b2Body* walls = world->CreateBody(&staticDef);
+		b2PolygonShape wall;
+		wall.SetAsBox(0.5f, 40.f, b2Vec2(-20.5f, 0.f), 0.f);
+		walls->CreateFixture(&wall, 0.f);
+		wall.SetAsBox(0.5f, 40.f, b2Vec2(20.5f, 0.f), 0.f);
+		walls->CreateFixture(&wall, 0.f);
+
+		b2CircleShape peg;
+		peg.m_radius = 0.3f;
+		for (int row = 0; row < kPegRows; row++)
+		{
+			for (int column = 0; column < kPegColumns; column++)
+			{
+				staticDef.position.Set(-18.f + column * 2.4f + (row % 2) * 1.2f, -20.f + row * 3.f);
+				world->CreateBody(&staticDef)->CreateFixture(&peg, 0.f);
+			}
+		}
+
+		b2BodyDef ballDef;
+		ballDef.type = b2_dynamicBody;
+		b2CircleShape ball;
+		ball.m_radius = 0.5f;
+		b2FixtureDef ballFixture;
+		ballFixture.shape = &ball;
+		ballFixture.density = 0.7f;
+		ballFixture.restitution = 0.5f;
+		std::vector<b2Body*> balls;
+		for (int i = 0; i < kBalls; i++)
+		{
+			ballDef.position.Set(-19.f + (i % 38), 20.f + (i / 38) * 1.2f);
+			balls.push_back(world->CreateBody(&ballDef));
+			balls.back()->CreateFixture(&ballFixture);
+		}
+
+		Clock::time_point start = Clock::now();
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			world->Step(1.f / 60.f, 6, 2);
+			for (size_t i = 0; i < balls.size(); i++)
+			{
+				if (balls[i]->GetPosition().y < -30.f)
+				{
+					balls[i]->SetTransform(b2Vec2(balls[i]->GetPosition().x, 25.f), 0.f);
+					balls[i]->SetLinearVelocity(b2Vec2(0.f, 0.f));
+				}
+			}
+		}
+		result.seconds = Seconds(start);
+
+		delete world;
+
+		PhysicsPoolStats after = PhysicsPool::Current()->stats();
+		result.steps = steps;
+		result.begun = counter.begun;
+		result.ended = counter.ended;
+		result.stats = after;
+		result.stats.allocations = after.allocations - before.allocations;
+		result.stats.pooled = after.pooled - before.pooled;
+		result.stats.frees = after.frees - before.frees;
+	}
+
+	void PrintWorld(const char* label, const ChurnResult& result)
+	{
+		printf("%-18s %8.0f steps/s %10.0f contacts/s  %6u b2Alloc, %6u pooled, %7u KB peak, %7u KB from system\n",
+			label, result.steps / result.seconds, (result.begun + result.ended) / result.seconds,
+			(unsigned int)result.stats.allocations, (unsigned int)result.stats.pooled,
+			(unsigned int)(result.stats.peak_bytes / 1024), (unsigned int)(result.stats.system_bytes / 1024));
+	}
+
+	// sizes Box2D passes to b2Alloc: block allocator chunks, tree and pair buffers as they grow
+	const size_t kChurnSizes[] = { 16 * 1024, 640, 1280, 2560, 5120, 10240, 96, 192, 384, 768, 1536, 3072 };
+
+	template <typename Alloc, typename Free>
+	double Churn(Alloc allocate, Free release, unsigned int rounds)
+	{
+		const unsigned int kLive = 256;
+		void* live[kLive] = {};
+		unsigned int seed = 12345;
+
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < rounds; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			unsigned int slot = (seed >> 8) % kLive;
+			release(live[slot]);
+			live[slot] = allocate(kChurnSizes[(seed >> 20) % (sizeof(kChurnSizes) / sizeof(kChurnSizes[0]))]);
+		}
+		double seconds = Seconds(start);
+
+		for (unsigned int i = 0; i < kLive; i++)
+			release(live[i]);
+		return seconds * 1e9 / rounds;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int steps = argc > 1 ? (unsigned int)atoi(argv[1]) : 3000;
+	unsigned int threads = argc > 2 ? (unsigned int)atoi(argv[2]) : 4;
+
+	PhysicsPool churnPool;
+	const unsigned int kRounds = 2000000;
+	double poolNs = Churn([&](size_t size) { return churnPool.Allocate(size); }, [](void* mem) { PhysicsPool::Free(mem); }, kRounds);
+	double mallocNs = Churn([](size_t size) { return malloc(size); }, [](void* mem) { free(mem); }, kRounds);
+	printf("alloc + free at Box2D sizes: pool %.1f ns, malloc %.1f ns\n", poolNs, mallocNs);
+
+	ChurnResult result;
+	RunWorld(NULL, steps, result);
+	PrintWorld("shared pool", result);
+
+	PhysicsPool worldPool;
+	RunWorld(&worldPool, steps, result);
+	PrintWorld("world pool", result);
+
+	// one world per thread, each on a pool of its own
+	std::vector<PhysicsPool*> pools;
+	std::vector<ChurnResult> results(threads);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threads; i++)
+		pools.push_back(new PhysicsPool);
+	Clock::time_point start = Clock::now();
+	for (unsigned int i = 0; i < threads; i++)
+		workers.push_back(std::thread(RunWorld, pools[i], steps, std::ref(results[i])));
+	for (unsigned int i = 0; i < threads; i++)
+		workers[i].join();
+	double seconds = Seconds(start);
+
+	unsigned int contacts = 0;
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		contacts += results[i].begun + results[i].ended;
+		delete pools[i];
+	}
+	printf("%u worlds, %u threads: %.0f steps/s, %.0f contacts/s in total\n",
+		threads, threads, threads * steps / seconds, contacts / seconds);
+	return 0;
+}
@@ -0,0 +1,102 @@
+//
+// replay_info
+//
+// Prints what a replay holds and checks every step of it decodes, for sorting through an
+// archive of replays without starting the game. Also times following it as a ghost.
+//
+// usage: replay_info <replay.rpl> [replay.rpl ...]
+//
+// build on Linux: g++ -O2 -std=c++11 tools/replay_info.cpp replay.cpp ghost_track.cpp arena.cpp leaderboard.cpp -lz
+//
+
+#include "../replay.h"
+#include "../ghost_track.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	bool PrintReplay(const char* filename)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (!file)
+		{
+			fprintf(stderr, "%s: could not be read\n", filename);
+			return false;
+		}
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fclose(file);
+
+		ReplayReader reader;
+		if (!reader.Open(filename))
+		{
+			fprintf(stderr, "%s: not a replay, or damaged\n", filename);
+			return false;
+		}
+
+		const ReplayHeader& header = reader.header();
+		double minutes = header.step_count / (header.steps_per_second * 60.0);
+		printf("%s: %.11s %u (entry %u), seed %u\n", filename, header.name, header.score, header.entry_sequence, header.seed);
+		printf("  %u steps (%.1f s) in %u blocks, %ld bytes, %.0f bytes per minute\n",
+			header.step_count, minutes * 60.0, header.block_count, size, minutes > 0.0 ? size / minutes : 0.0);
+
+		// walking every step inflates every block once and checks the samples chain up
+		std::vector<ReplayBall> balls;
+		unsigned int maxBalls = 0, presses = 0;
+		unsigned char flippers = 0;
+		for (uint32_t step = 0; step < header.step_count; step++)
+		{
+			if (!reader.GetBalls(step, balls))
+			{
+				fprintf(stderr, "%s: step %u does not decode\n", filename, step);
+				return false;
+			}
+			if (balls.size() > maxBalls)
+				maxBalls = (unsigned int)balls.size();
+
+			unsigned char now = reader.GetFlippers(step);
+			if (now & ~flippers)
+				presses++;
+			flippers = now;
+		}
+		printf("  up to %u balls at once, %u flipper presses\n", maxBalls, presses);
+
+		Arena arena(256 * 1024);
+		GhostTrack ghost;
+		if (!ghost.Open(filename, arena))
+		{
+			fprintf(stderr, "%s: could not be followed as a ghost\n", filename);
+			return false;
+		}
+
+		typedef std::chrono::steady_clock Clock;
+		ReplayBall ghostBalls[GhostTrack::kMaxBalls];
+		unsigned int drawn = 0;
+		Clock::time_point start = Clock::now();
+		for (uint32_t step = 0; step < header.step_count; step++)
+			drawn += ghost.Update(step, ghostBalls);
+		double ghostUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		printf("  as a ghost: %.3f us per step, %u balls followed, %u bytes held\n",
+			ghostUs / header.step_count, drawn, (unsigned int)arena.peak_bytes());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <replay.rpl> [replay.rpl ...]\n", argv[0]);
+		return 1;
+	}
+
+	int failed = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!PrintReplay(argv[i]))
+			failed++;
+	}
+	return failed > 0 ? 1 : 0;
+}
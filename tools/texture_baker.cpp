@@ -0,0 +1,235 @@
+//
+// texture_baker
+//
+// Converts PNGs into the pre-decoded texture container so the game can skip PNG decoding.
+//
+// usage: texture_baker [--no-mips] <input.png> <output.tex>
+//        texture_baker --bench <input.png> <input.tex> [iterations]
+//
+// The bench mode times PNG decode against reading the baked file for one asset. It cannot
+// create textures, so for decode plus upload of every asset build the game with
+// TEXTURE_LOAD_BENCH defined, which reports each one at startup.
+//
+
+#include "../baked_texture_format.h"
+#include <png.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Image
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<unsigned char> pixels;
+	};
+
+	// decode any PNG colour type to 8 bit RGBA
+	bool DecodePNG(const char* filename, Image& image)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (!file)
+			return false;
+
+		png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+		png_infop info = png ? png_create_info_struct(png) : NULL;
+		if (!info)
+		{
+			png_destroy_read_struct(&png, NULL, NULL);
+			fclose(file);
+			return false;
+		}
+
+		std::vector<png_bytep> rows;
+		if (setjmp(png_jmpbuf(png)))
+		{
+			png_destroy_read_struct(&png, &info, NULL);
+			fclose(file);
+			return false;
+		}
+
+		png_init_io(png, file);
+		png_read_info(png, info);
+
+		png_byte colourType = png_get_color_type(png, info);
+		if (png_get_bit_depth(png, info) == 16)
+			png_set_strip_16(png);
+		if (colourType == PNG_COLOR_TYPE_PALETTE)
+			png_set_palette_to_rgb(png);
+		if (colourType == PNG_COLOR_TYPE_GRAY || colourType == PNG_COLOR_TYPE_GRAY_ALPHA)
+			png_set_gray_to_rgb(png);
+		if (png_get_bit_depth(png, info) < 8)
+			png_set_packing(png);
+		if (png_get_valid(png, info, PNG_INFO_tRNS))
+			png_set_tRNS_to_alpha(png);
+		if (!(colourType & PNG_COLOR_MASK_ALPHA))
+			png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+		png_read_update_info(png, info);
+
+		image.width = png_get_image_width(png, info);
+		image.height = png_get_image_height(png, info);
+		image.pixels.resize(image.width * image.height * 4);
+
+		rows.resize(image.height);
+		for (uint32_t y = 0; y < image.height; y++)
+			rows[y] = &image.pixels[y * image.width * 4];
+
+		png_read_image(png, &rows[0]);
+		png_read_end(png, NULL);
+		png_destroy_read_struct(&png, &info, NULL);
+		fclose(file);
+		return true;
+	}
+
+	// 2x2 box filter, clamping at odd edges
+	void Downsample(const Image& source, Image& target)
+	{
+		target.width = source.width > 1 ? source.width / 2 : 1;
+		target.height = source.height > 1 ? source.height / 2 : 1;
+		target.pixels.resize(target.width * target.height * 4);
+
+		for (uint32_t y = 0; y < target.height; y++)
+		{
+			uint32_t y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+			for (uint32_t x = 0; x < target.width; x++)
+			{
+				uint32_t x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					unsigned int sum = source.pixels[(y0 * source.width + x0) * 4 + c] + source.pixels[(y0 * source.width + x1) * 4 + c] +
+						source.pixels[(y1 * source.width + x0) * 4 + c] + source.pixels[(y1 * source.width + x1) * 4 + c];
+					target.pixels[(y * target.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	bool WriteBaked(const char* filename, const Image& image, bool mips)
+	{
+		std::vector<Image> levels(1, image);
+		while (mips && (levels.back().width > 1 || levels.back().height > 1))
+		{
+			Image next;
+			Downsample(levels.back(), next);
+			levels.push_back(next);
+		}
+
+		BakedTextureHeader header;
+		header.magic = kBakedTextureMagic;
+		header.version = kBakedTextureVersion;
+		header.width = image.width;
+		header.height = image.height;
+		header.format = BAKED_RGBA8;
+		header.mip_count = (uint32_t)levels.size();
+
+		FILE* file = fopen(filename, "wb");
+		if (!file)
+			return false;
+
+		fwrite(&header, sizeof(header), 1, file);
+		for (size_t i = 0; i < levels.size(); i++)
+			fwrite(&levels[i].pixels[0], 1, levels[i].pixels.size(), file);
+
+		bool ok = ferror(file) == 0;
+		fclose(file);
+		return ok;
+	}
+
+	// the same work the game does on its fast path: read the header and level 0
+	bool ReadBaked(const char* filename, Image& image)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (!file)
+			return false;
+
+		BakedTextureHeader header;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == kBakedTextureMagic && header.format == BAKED_RGBA8;
+		if (ok)
+		{
+			image.width = header.width;
+			image.height = header.height;
+			image.pixels.resize(header.width * header.height * 4);
+			ok = fread(&image.pixels[0], 1, image.pixels.size(), file) == image.pixels.size();
+		}
+		fclose(file);
+		return ok;
+	}
+
+	int Bench(const char* png_filename, const char* tex_filename, int iterations)
+	{
+		typedef std::chrono::steady_clock Clock;
+		Image image;
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			if (!DecodePNG(png_filename, image))
+			{
+				fprintf(stderr, "%s: could not be decoded\n", png_filename);
+				return 1;
+			}
+		}
+		double pngMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+		start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			if (!ReadBaked(tex_filename, image))
+			{
+				fprintf(stderr, "%s: could not be read\n", tex_filename);
+				return 1;
+			}
+		}
+		double bakedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+		printf("%s %ux%u: png decode %.3f ms, baked read %.3f ms (%.1fx)\n",
+			png_filename, image.width, image.height, pngMs, bakedMs, bakedMs > 0.0 ? pngMs / bakedMs : 0.0);
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 4 && strcmp(argv[1], "--bench") == 0)
+	{
+		int iterations = argc >= 5 ? atoi(argv[4]) : 20;
+		return Bench(argv[2], argv[3], iterations > 0 ? iterations : 1);
+	}
+
+	bool mips = true;
+	int arg = 1;
+	if (argc > arg && strcmp(argv[arg], "--no-mips") == 0)
+	{
+		mips = false;
+		arg++;
+	}
+
+	if (argc - arg != 2)
+	{
+		fprintf(stderr, "usage: %s [--no-mips] <input.png> <output.tex>\n", argv[0]);
+		fprintf(stderr, "       %s --bench <input.png> <input.tex> [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	Image image;
+	if (!DecodePNG(argv[arg], image))
+	{
+		fprintf(stderr, "%s: could not be decoded\n", argv[arg]);
+		return 1;
+	}
+
+	if (!WriteBaked(argv[arg + 1], image, mips))
+	{
+		fprintf(stderr, "%s: could not be written\n", argv[arg + 1]);
+		return 1;
+	}
+
+	printf("baked %s (%ux%u) to %s\n", argv[arg], image.width, image.height, argv[arg + 1]);
+	return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef _VARINT_H
+#define _VARINT_H
+
+// LEB128 style variable length integers, 7 bits a byte, shared by the packed file and wire formats.
+
+#include <stdint.h>
+#include <vector>
+
+inline void WriteVarint(std::vector<unsigned char>& bytes, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+inline bool ReadVarint(const unsigned char*& read, const unsigned char* end, uint32_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35 && read < end; shift += 7)
+	{
+		unsigned char byte = *read++;
+		value |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// maps small negative and positive values alike to small varints
+inline uint32_t ZigZag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+inline int32_t UnZigZag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+#endif // _VARINT_H
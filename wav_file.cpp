@@ -0,0 +1,92 @@
+#include "wav_file.h"
+#include <cstring>
+
+namespace
+{
+	unsigned int ReadU32(const unsigned char* data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+	}
+
+	unsigned int ReadU16(const unsigned char* data)
+	{
+		return data[0] | (data[1] << 8);
+	}
+}
+
+bool ReadWavHeader(FILE* file, WavFormat& format)
+{
+	unsigned char header[12];
+	bool valid = fread(header, 1, 12, file) == 12 && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0;
+	bool hasFormat = false;
+	format.data_size = 0;
+
+	while (valid)
+	{
+		unsigned char chunk[8];
+		if (fread(chunk, 1, 8, file) != 8)
+			break;
+
+		// chunks are padded to an even size
+		unsigned int chunkSize = ReadU32(chunk + 4);
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			unsigned char fmt[16];
+			valid = fread(fmt, 1, 16, file) == 16;
+			format.channels = (int)ReadU16(fmt + 2);
+			format.sample_rate = (int)ReadU32(fmt + 4);
+			valid = valid && ReadU16(fmt) == 1 && ReadU16(fmt + 14) == 16 && (format.channels == 1 || format.channels == 2) && format.sample_rate > 0;
+			hasFormat = true;
+			fseek(file, (long)(chunkSize - 16 + (chunkSize & 1)), SEEK_CUR);
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			format.data_offset = ftell(file);
+			format.data_size = (long)chunkSize;
+			break;
+		}
+		else
+		{
+			fseek(file, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR);
+		}
+	}
+
+	return valid && hasFormat && format.data_size > 0;
+}
+
+bool ParseWavHeader(const unsigned char* data, size_t size, WavFormat& format)
+{
+	bool valid = size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0;
+	bool hasFormat = false;
+	format.data_size = 0;
+
+	size_t offset = 12;
+	while (valid && offset + 8 <= size)
+	{
+		const unsigned char* chunk = data + offset;
+		unsigned int chunkSize = ReadU32(chunk + 4);
+		offset += 8;
+		if (chunkSize > size - offset)
+			break;
+
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			const unsigned char* fmt = chunk + 8;
+			format.channels = (int)ReadU16(fmt + 2);
+			format.sample_rate = (int)ReadU32(fmt + 4);
+			valid = ReadU16(fmt) == 1 && ReadU16(fmt + 14) == 16 && (format.channels == 1 || format.channels == 2) && format.sample_rate > 0;
+			hasFormat = true;
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			format.data_offset = (long)offset;
+			format.data_size = (long)chunkSize;
+			break;
+		}
+
+		// chunks are padded to an even size
+		offset += (size_t)chunkSize + (chunkSize & 1);
+	}
+
+	return valid && hasFormat && format.data_size > 0;
+}
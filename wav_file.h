@@ -0,0 +1,22 @@
+#ifndef _WAV_FILE_H
+#define _WAV_FILE_H
+
+#include <cstdio>
+#include <cstddef>
+
+struct WavFormat
+{
+	int channels;
+	int sample_rate;
+	long data_offset;
+	long data_size;
+};
+
+// Finds the fmt and data chunks of a 16 bit PCM mono or stereo RIFF WAVE file,
+// leaving the file positioned at the first sample
+bool ReadWavHeader(FILE* file, WavFormat& format);
+
+// Finds the same chunks in a file already in memory, data_offset counting from the start of data
+bool ParseWavHeader(const unsigned char* data, size_t size, WavFormat& format);
+
+#endif // _WAV_FILE_H